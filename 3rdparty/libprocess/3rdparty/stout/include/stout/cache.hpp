@@ -45,7 +45,7 @@ public:
   typedef boost::unordered_map<
     Key, std::pair<Value, typename list::iterator> > map;
 
-  explicit cache(int _capacity) : capacity(_capacity) {}
+  explicit cache(size_t _capacity) : capacity(_capacity) {}
 
   void put(const Key& key, const Value& value)
   {
@@ -67,7 +67,21 @@ public:
       return (*i).second.first;
     }
 
-    return None();
+    return Option<Value>::none();
+  }
+
+  Option<Value> erase(const Key& key)
+  {
+    typename map::iterator i = values.find(key);
+
+    if (i != values.end()) {
+      Value value = (*i).second.first;
+      keys.erase((*i).second.second);
+      values.erase(i);
+      return value;
+    }
+
+    return Option<Value>::none();
   }
 
 private:
@@ -114,7 +128,7 @@ private:
   }
 
   // Size of the cache.
-  int capacity;
+  size_t capacity;
 
   // Cache of values and "pointers" into the least-recently used list.
   map values;
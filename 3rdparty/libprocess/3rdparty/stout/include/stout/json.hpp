@@ -20,6 +20,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/variant.hpp>
 
@@ -99,6 +100,54 @@ struct False {};
 struct Null {};
 
 
+// Renders 'value' as a (quoted and escaped) JSON string.
+inline void renderString(std::ostream& out, const std::string& value)
+{
+  // TODO(benh): This escaping DOES NOT handle unicode, it encodes as ASCII.
+  // See RFC4627 for the JSON string specificiation.
+  out << "\"";
+  foreach (unsigned char c, value) {
+    switch (c) {
+      case '"':  out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '/':  out << "\\/";  break;
+      case '\b': out << "\\b";  break;
+      case '\f': out << "\\f";  break;
+      case '\n': out << "\\n";  break;
+      case '\r': out << "\\r";  break;
+      case '\t': out << "\\t";  break;
+      default:
+        // See RFC4627 for these ranges.
+        if ((c >= 0x20 && c <= 0x21) ||
+            (c >= 0x23 && c <= 0x5B) ||
+            (c >= 0x5D && c < 0x7F)) {
+          out << c;
+        } else {
+          // NOTE: We also escape all bytes > 0x7F since they imply more than
+          // 1 byte in UTF-8. This is why we don't escape UTF-8 properly.
+          // See RFC4627 for the escaping format: \uXXXX (X is a hex digit).
+          // Each byte here will be of the form: \u00XX (this is why we need
+          // setw and the cast to unsigned int).
+          out << "\\u" << std::setfill('0') << std::setw(4)
+              << std::hex << std::uppercase << (unsigned int) c;
+        }
+        break;
+    }
+  }
+  out << "\"";
+}
+
+
+// Renders 'value' as a JSON number.
+inline void renderNumber(std::ostream& out, double value)
+{
+  // Use the guaranteed accurate precision, see:
+  // http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2006/n2005.pdf
+  out << std::setprecision(std::numeric_limits<double>::digits10)
+      << value;
+}
+
+
 // Implementation of rendering JSON objects built above using standard
 // C++ output streams. The visitor pattern is used thanks to to build
 // a "renderer" with boost::static_visitor and two top-level render
@@ -110,46 +159,12 @@ struct Renderer : boost::static_visitor<>
 
   void operator () (const String& string) const
   {
-    // TODO(benh): This escaping DOES NOT handle unicode, it encodes as ASCII.
-    // See RFC4627 for the JSON string specificiation.
-    out << "\"";
-    foreach (unsigned char c, string.value) {
-      switch (c) {
-        case '"':  out << "\\\""; break;
-        case '\\': out << "\\\\"; break;
-        case '/':  out << "\\/";  break;
-        case '\b': out << "\\b";  break;
-        case '\f': out << "\\f";  break;
-        case '\n': out << "\\n";  break;
-        case '\r': out << "\\r";  break;
-        case '\t': out << "\\t";  break;
-        default:
-          // See RFC4627 for these ranges.
-          if ((c >= 0x20 && c <= 0x21) ||
-              (c >= 0x23 && c <= 0x5B) ||
-              (c >= 0x5D && c < 0x7F)) {
-            out << c;
-          } else {
-            // NOTE: We also escape all bytes > 0x7F since they imply more than
-            // 1 byte in UTF-8. This is why we don't escape UTF-8 properly.
-            // See RFC4627 for the escaping format: \uXXXX (X is a hex digit).
-            // Each byte here will be of the form: \u00XX (this is why we need
-            // setw and the cast to unsigned int).
-            out << "\\u" << std::setfill('0') << std::setw(4)
-                << std::hex << std::uppercase << (unsigned int) c;
-          }
-          break;
-      }
-    }
-    out << "\"";
+    renderString(out, string.value);
   }
 
   void operator () (const Number& number) const
   {
-    // Use the guaranteed accurate precision, see:
-    // http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2006/n2005.pdf
-    out << std::setprecision(std::numeric_limits<double>::digits10)
-        << number.value;
+    renderNumber(out, number.value);
   }
 
   void operator () (const Object& object) const
@@ -213,6 +228,128 @@ inline std::ostream& operator<<(std::ostream& out, const JSON::Value& value)
   return out;
 }
 
+
+// A writer that renders JSON directly to an output stream, for when
+// building a complete tree of Objects and Arrays before rendering it
+// would be too expensive (e.g., for large documents). For example:
+//
+//   JSON::Writer writer(&out);
+//   writer.beginObject();
+//   writer.field("name", "value");
+//   writer.key("values");
+//   writer.beginArray();
+//   writer.value(1);
+//   writer.endArray();
+//   writer.endObject();
+//
+// renders {"name":"value","values":[1]}.
+//
+// NOTE: The writer does not check that the document is well formed
+// (e.g., that every object gets ended or that a key is written before
+// each value of an object).
+class Writer
+{
+public:
+  explicit Writer(std::ostream* _out) : out(_out), keyed(false) {}
+
+  void beginObject()
+  {
+    separate();
+    *out << "{";
+    first.push_back(true);
+  }
+
+  void endObject()
+  {
+    first.pop_back();
+    *out << "}";
+  }
+
+  void beginArray()
+  {
+    separate();
+    *out << "[";
+    first.push_back(true);
+  }
+
+  void endArray()
+  {
+    first.pop_back();
+    *out << "]";
+  }
+
+  // Writes the key for the next value in the current object.
+  void key(const std::string& name)
+  {
+    separate();
+    renderString(*out, name);
+    *out << ":";
+    keyed = true;
+  }
+
+  void value(const std::string& value)
+  {
+    separate();
+    renderString(*out, value);
+  }
+
+  void value(const char* value)
+  {
+    separate();
+    renderString(*out, value);
+  }
+
+  void value(double value)
+  {
+    separate();
+    renderNumber(*out, value);
+  }
+
+  void value(const Value& value)
+  {
+    separate();
+    render(*out, value);
+  }
+
+  // Writes a value that has already been rendered as JSON.
+  void rendered(const std::string& json)
+  {
+    separate();
+    *out << json;
+  }
+
+  template <typename T>
+  void field(const std::string& name, const T& t)
+  {
+    key(name);
+    value(t);
+  }
+
+private:
+  // Writes the separator needed before the next key or value.
+  void separate()
+  {
+    if (keyed) {
+      keyed = false;
+    } else if (!first.empty()) {
+      if (first.back()) {
+        first.back() = false;
+      } else {
+        *out << ",";
+      }
+    }
+  }
+
+  std::ostream* out;
+
+  // Whether the next key or value is the first in each enclosing
+  // object or array.
+  std::vector<bool> first;
+
+  // Whether a key has been written without its value yet.
+  bool keyed;
+};
+
 } // namespace JSON {
 
 #endif // __STOUT_JSON__
@@ -2,6 +2,7 @@
 
 #include <gmock/gmock.h>
 
+#include <sstream>
 #include <string>
 
 #include <stout/json.hpp>
@@ -31,3 +32,54 @@ TEST(JsonTest, NumberFormat)
   // Expect at least 15 digits of precision.
   EXPECT_EQ("1234567890.12345", stringify(JSON::Number(1234567890.12345)));
 }
+
+
+TEST(JsonTest, Writer)
+{
+  std::ostringstream out;
+
+  JSON::Writer writer(&out);
+  writer.beginObject();
+  writer.field("string", "\"value\"");
+  writer.field("number", 1.5);
+  writer.key("array");
+  writer.beginArray();
+  writer.value(1);
+  writer.beginObject();
+  writer.endObject();
+  writer.rendered("[true]");
+  writer.endArray();
+  writer.key("empty");
+  writer.beginArray();
+  writer.endArray();
+
+  JSON::Object object;
+  object.values["key"] = "value";
+  writer.field("object", object);
+  writer.endObject();
+
+  EXPECT_EQ("{\"string\":\"\\\"value\\\"\","
+            "\"number\":1.5,"
+            "\"array\":[1,{},[true]],"
+            "\"empty\":[],"
+            "\"object\":{\"key\":\"value\"}}",
+            out.str());
+}
+
+
+TEST(JsonTest, WriterMatchesRender)
+{
+  JSON::Object object;
+  object.values["a"] = 1234567890.12345;
+  object.values["b"] = string("\n\x7F", 2);
+
+  std::ostringstream out;
+
+  JSON::Writer writer(&out);
+  writer.beginObject();
+  writer.field("a", 1234567890.12345);
+  writer.field("b", string("\n\x7F", 2));
+  writer.endObject();
+
+  EXPECT_EQ(stringify(object), out.str());
+}
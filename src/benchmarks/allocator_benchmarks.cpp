@@ -0,0 +1,296 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <list>
+#include <string>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/gtest.hpp>
+#include <process/pid.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/option.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+
+#include "benchmarks/flags.hpp"
+#include "benchmarks/utils.hpp"
+
+#include "master/allocator.hpp"
+#include "master/flags.hpp"
+#include "master/hierarchical_allocator_process.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::benchmarks;
+
+using mesos::internal::master::Master;
+
+using mesos::internal::master::allocator::Allocator;
+using mesos::internal::master::allocator::HierarchicalDRFAllocatorProcess;
+
+using process::Future;
+using process::PID;
+
+using std::cout;
+using std::endl;
+using std::list;
+using std::string;
+
+
+// Resources allocated to a simulated framework on a simulated slave,
+// either as an outstanding offer or as a running task.
+struct Allocation
+{
+  Allocation(
+      const FrameworkID& _frameworkId,
+      const SlaveID& _slaveId,
+      const Resources& _resources)
+    : frameworkId(_frameworkId),
+      slaveId(_slaveId),
+      resources(_resources) {}
+
+  FrameworkID frameworkId;
+  SlaveID slaveId;
+  Resources resources;
+};
+
+
+// Result of a single measured allocation cycle.
+struct Cycle
+{
+  Duration elapsed;
+  size_t offers; // One per (framework, slave) pair.
+};
+
+
+// A hierarchical DRF allocator that, instead of sending offers to a
+// master, plays the part of the frameworks itself: outstanding offers
+// are either declined (installing a refusal filter) or used to launch
+// a task, and running tasks finish over time.
+class BenchmarkAllocatorProcess : public HierarchicalDRFAllocatorProcess
+{
+public:
+  BenchmarkAllocatorProcess(const Resources& _task)
+    : task(_task), offers(0) {}
+
+  virtual ~BenchmarkAllocatorProcess() {}
+
+  // Responds to all outstanding offers, finishes some of the running
+  // tasks and then performs (and measures) a full allocation cycle.
+  Cycle cycle()
+  {
+    respond();
+
+    offers = 0;
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    allocate();
+
+    Cycle cycle;
+    cycle.elapsed = stopwatch.elapsed();
+    cycle.offers = offers;
+    return cycle;
+  }
+
+  size_t tasks() { return running.size(); }
+
+protected:
+  virtual void offer(
+      const FrameworkID& frameworkId,
+      const hashmap<SlaveID, Resources>& resources)
+  {
+    foreachpair (const SlaveID& slaveId, const Resources& offered, resources) {
+      outstanding.push_back(Allocation(frameworkId, slaveId, offered));
+      offers++;
+    }
+  }
+
+private:
+  static bool chance(double ratio)
+  {
+    return ::random() < ratio * RAND_MAX;
+  }
+
+  void respond()
+  {
+    Filters refuse;
+    refuse.set_refuse_seconds(benchmarks::flags.refuse_seconds);
+
+    Filters none;
+    none.set_refuse_seconds(0);
+
+    foreach (const Allocation& offer, outstanding) {
+      if (chance(benchmarks::flags.decline_ratio) ||
+          !(task <= offer.resources)) {
+        resourcesUnused(
+            offer.frameworkId, offer.slaveId, offer.resources, refuse);
+      } else {
+        running.push_back(Allocation(offer.frameworkId, offer.slaveId, task));
+        resourcesUnused(
+            offer.frameworkId, offer.slaveId, offer.resources - task, none);
+      }
+    }
+
+    outstanding.clear();
+
+    list<Allocation>::iterator iterator = running.begin();
+    while (iterator != running.end()) {
+      if (chance(benchmarks::flags.finish_ratio)) {
+        resourcesRecovered(
+            iterator->frameworkId, iterator->slaveId, iterator->resources);
+        iterator = running.erase(iterator);
+      } else {
+        ++iterator;
+      }
+    }
+  }
+
+  const Resources task;
+
+  list<Allocation> outstanding;
+  list<Allocation> running;
+
+  size_t offers;
+};
+
+
+// Measures the latency of full allocation cycles of the hierarchical
+// DRF allocator for a cluster of '--slaves' slaves and '--frameworks'
+// frameworks (spread across '--roles' roles) with offer declines,
+// refusal filters and task churn between the cycles.
+TEST(AllocatorBenchmark, AllocationCycle)
+{
+  // The frameworks are assigned to the roles round-robin.
+  ASSERT_LT(0u, benchmarks::flags.roles) << "Expecting at least one role";
+
+  ::srandom(benchmarks::flags.seed);
+
+  printMemory("before setup");
+
+  master::Flags masterFlags;
+
+  // The benchmark drives the allocation cycles itself, so make sure
+  // that batch allocations do not interfere.
+  masterFlags.allocation_interval = Weeks(1);
+
+  hashmap<string, RoleInfo> roles;
+  for (uint32_t i = 0; i < benchmarks::flags.roles; i++) {
+    RoleInfo info;
+    info.set_name("role" + stringify(i));
+    info.set_weight(1.0);
+    roles[info.name()] = info;
+  }
+
+  BenchmarkAllocatorProcess process(
+      Resources::parse("cpus:1;mem:512").get());
+
+  Allocator allocator(&process);
+
+  allocator.initialize(masterFlags, PID<Master>(), roles);
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // NOTE: We add the frameworks before the slaves since adding
+  // frameworks triggers an allocation across all slaves (coalesced
+  // for frameworks added back to back) while adding a slave only
+  // allocates that slave's resources.
+  for (uint32_t i = 0; i < benchmarks::flags.frameworks; i++) {
+    FrameworkID frameworkId;
+    frameworkId.set_value("framework" + stringify(i));
+
+    FrameworkInfo frameworkInfo;
+    frameworkInfo.set_user("user");
+    frameworkInfo.set_name("framework" + stringify(i));
+    frameworkInfo.mutable_id()->MergeFrom(frameworkId);
+    frameworkInfo.set_role("role" + stringify(i % benchmarks::flags.roles));
+
+    allocator.frameworkAdded(frameworkId, frameworkInfo, Resources());
+  }
+
+  Resources resources = Resources::parse(
+      "cpus:16;mem:65536;disk:1048576;ports:[31000-32000]").get();
+
+  for (uint32_t i = 0; i < benchmarks::flags.slaves; i++) {
+    SlaveID slaveId;
+    slaveId.set_value("slave" + stringify(i));
+
+    SlaveInfo slaveInfo;
+    slaveInfo.set_hostname("host" + stringify(i));
+    slaveInfo.mutable_resources()->MergeFrom(resources);
+    slaveInfo.mutable_id()->MergeFrom(slaveId);
+
+    allocator.slaveAdded(
+        slaveId, slaveInfo, hashmap<FrameworkID, Resources>());
+  }
+
+  PID<BenchmarkAllocatorProcess> pid(process);
+
+  // Wait for the setup to be processed by running a first (not
+  // measured) cycle.
+  Future<Cycle> cycle = dispatch(pid, &BenchmarkAllocatorProcess::cycle);
+  AWAIT_READY_FOR(cycle, Hours(1));
+
+  cout << "Added " << benchmarks::flags.slaves << " slaves and "
+       << benchmarks::flags.frameworks << " frameworks in "
+       << benchmarks::flags.roles << " roles in "
+       << stopwatch.elapsed() << endl;
+
+  printMemory("after setup");
+
+  Samples samples;
+  size_t offers = 0;
+
+  for (uint32_t i = 0; i < benchmarks::flags.cycles; i++) {
+    cycle = dispatch(pid, &BenchmarkAllocatorProcess::cycle);
+    AWAIT_READY_FOR(cycle, Hours(1));
+
+    samples.add(cycle.get().elapsed);
+    offers += cycle.get().offers;
+  }
+
+  samples.print("Allocation cycle latency");
+
+  Duration total = samples.total();
+
+  cout << "Made " << offers << " offers in " << total << " of allocation ("
+       << (total > Duration::zero() ? offers / total.secs() : 0.0)
+       << " offers/second)" << endl;
+
+  Future<size_t> tasks = dispatch(pid, &BenchmarkAllocatorProcess::tasks);
+  AWAIT_READY(tasks);
+
+  cout << "Running " << tasks.get() << " simulated tasks" << endl;
+
+  printMemory("after " + stringify(benchmarks::flags.cycles) + " cycles");
+}
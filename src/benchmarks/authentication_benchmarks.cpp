@@ -0,0 +1,160 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include <process/collect.hpp>
+#include <process/future.hpp>
+#include <process/gtest.hpp>
+#include <process/http.hpp>
+#include <process/pid.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "benchmarks/flags.hpp"
+#include "benchmarks/utils.hpp"
+
+#include "master/flags.hpp"
+#include "master/master.hpp"
+
+#include "sasl/authenticatee.hpp"
+
+#include "tests/cluster.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::benchmarks;
+
+using mesos::internal::master::Master;
+
+using mesos::internal::sasl::Authenticatee;
+
+using mesos::internal::tests::Cluster;
+
+using process::Future;
+using process::PID;
+using process::UPID;
+
+using std::cout;
+using std::endl;
+using std::list;
+using std::string;
+using std::vector;
+
+
+// Measures how many frameworks the master authenticates per second
+// when '--frameworks' frameworks (each with its own credential)
+// authenticate at once, as they do after a master failover. This is
+// repeated '--cycles' times.
+TEST(AuthenticationBenchmark, Authenticate)
+{
+  Try<string> directory = os::mkdtemp();
+  ASSERT_SOME(directory);
+
+  vector<Credential> credentials;
+  string contents;
+
+  for (uint32_t i = 0; i < benchmarks::flags.frameworks; i++) {
+    Credential credential;
+    credential.set_principal("principal" + stringify(i));
+    credential.set_secret("secret" + stringify(i));
+    credentials.push_back(credential);
+
+    contents += credential.principal() + " " + credential.secret() + "\n";
+  }
+
+  const string path = path::join(directory.get(), "credentials");
+  ASSERT_SOME(os::write(path, contents));
+
+  Cluster cluster;
+
+  master::Flags masterFlags;
+  masterFlags.work_dir = directory.get();
+  masterFlags.authenticate = true;
+  masterFlags.credentials = "file://" + path;
+
+  Try<PID<Master> > master = cluster.masters.start(masterFlags);
+  ASSERT_SOME(master);
+
+  ASSERT_NO_FATAL_FAILURE(awaitElected(master.get()));
+
+  Samples samples;
+  Duration total = Duration::zero();
+
+  for (uint32_t cycle = 0; cycle < benchmarks::flags.cycles; cycle++) {
+    vector<Authenticatee*> authenticatees;
+    list<Future<bool> > authenticated;
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    for (uint32_t i = 0; i < credentials.size(); i++) {
+      // The master only uses the framework's PID for bookkeeping, so
+      // it doesn't have to belong to an actual process.
+      UPID client("framework" + stringify(i), master.get().ip, 0);
+
+      Authenticatee* authenticatee =
+        new Authenticatee(credentials[i], client);
+
+      authenticatees.push_back(authenticatee);
+      authenticated.push_back(authenticatee->authenticate(master.get()));
+    }
+
+    Future<list<bool> > all = process::collect(authenticated);
+    AWAIT_READY_FOR(all, Hours(1));
+
+    Duration elapsed = stopwatch.elapsed();
+    samples.add(elapsed);
+    total += elapsed;
+
+    foreach (bool result, all.get()) {
+      EXPECT_TRUE(result);
+    }
+
+    foreach (Authenticatee* authenticatee, authenticatees) {
+      delete authenticatee;
+    }
+  }
+
+  samples.print("Authenticating " + stringify(credentials.size()) +
+                " frameworks at once");
+
+  cout << "Authenticated "
+       << (credentials.size() * samples.count()) / total.secs()
+       << " frameworks per second" << endl;
+
+  cluster.masters.shutdown();
+
+  ASSERT_SOME(os::rmdir(directory.get()));
+}
@@ -0,0 +1,114 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BENCHMARKS_FLAGS_HPP__
+#define __BENCHMARKS_FLAGS_HPP__
+
+#include <stdint.h>
+
+#include <stout/flags.hpp>
+
+#include "logging/logging.hpp"
+
+namespace mesos {
+namespace internal {
+namespace benchmarks {
+
+class Flags : public logging::Flags
+{
+public:
+  Flags()
+  {
+    // Like the tests, we'd prefer less junk to fly by while
+    // benchmarking (logging also skews the numbers), so force one to
+    // specify the verbosity.
+    add(&Flags::verbose,
+        "verbose",
+        "Log all severity levels to stderr",
+        false);
+
+    add(&Flags::slaves,
+        "slaves",
+        "Number of simulated slaves",
+        1000);
+
+    add(&Flags::frameworks,
+        "frameworks",
+        "Number of simulated frameworks",
+        100);
+
+    add(&Flags::tasks_per_slave,
+        "tasks_per_slave",
+        "Number of tasks running on each simulated slave",
+        10);
+
+    add(&Flags::roles,
+        "roles",
+        "Number of roles the simulated frameworks are spread across",
+        5);
+
+    add(&Flags::cycles,
+        "cycles",
+        "Number of measured iterations (e.g., allocation cycles)",
+        50);
+
+    add(&Flags::decline_ratio,
+        "decline_ratio",
+        "Fraction of offers a simulated framework declines with a\n"
+        "refusal filter rather than launching a task",
+        0.5);
+
+    add(&Flags::refuse_seconds,
+        "refuse_seconds",
+        "Duration of the refusal filter a simulated framework\n"
+        "installs when it declines an offer",
+        5.0);
+
+    add(&Flags::finish_ratio,
+        "finish_ratio",
+        "Fraction of running simulated tasks that finish between\n"
+        "two measured iterations",
+        0.1);
+
+    add(&Flags::seed,
+        "seed",
+        "Seed for the pseudo random decisions made by simulated\n"
+        "frameworks, so that runs are comparable",
+        42);
+  }
+
+  bool verbose;
+  uint32_t slaves;
+  uint32_t frameworks;
+  uint32_t tasks_per_slave;
+  uint32_t roles;
+  uint32_t cycles;
+  double decline_ratio;
+  double refuse_seconds;
+  double finish_ratio;
+  uint32_t seed;
+};
+
+// Global flags for running the benchmarks.
+extern Flags flags;
+
+} // namespace benchmarks {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __BENCHMARKS_FLAGS_HPP__
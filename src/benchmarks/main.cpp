@@ -0,0 +1,98 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <string>
+
+#include <process/process.hpp>
+
+#include <stout/flags.hpp>
+#include <stout/nothing.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include "benchmarks/flags.hpp"
+
+#include "logging/logging.hpp"
+
+#include "messages/messages.hpp" // For GOOGLE_PROTOBUF_VERIFY_VERSION.
+
+using namespace mesos::internal;
+using namespace mesos::internal::benchmarks;
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+
+void usage(const char* argv0, const flags::FlagsBase& flags)
+{
+  cerr << "Usage: " << os::basename(argv0).get() << " [...]" << endl
+       << endl
+       << "Supported options:" << endl
+       << flags.usage();
+}
+
+
+int main(int argc, char** argv)
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  using mesos::internal::benchmarks::flags; // Needed to disambiguate.
+
+  bool help;
+  flags.add(&help,
+            "help",
+            "Prints this help message",
+            false);
+
+  // Load flags from environment and command line but allow unknown
+  // flags (since we might have gtest flags as well).
+  Try<Nothing> load = flags.load("MESOS_BENCHMARK_", argc, argv, true);
+
+  if (load.isError()) {
+    cerr << load.error() << endl;
+    usage(argv[0], flags);
+    exit(1);
+  }
+
+  if (help) {
+    usage(argv[0], flags);
+    cerr << endl;
+    testing::InitGoogleTest(&argc, argv); // Get usage from gtest too.
+    exit(1);
+  }
+
+  // Initialize libprocess.
+  process::initialize();
+
+  // Be quiet by default!
+  if (!flags.verbose) {
+    flags.quiet = true;
+  }
+
+  // Initialize logging.
+  logging::initialize(argv[0], flags);
+
+  // Initialize gtest (used to select and run the benchmarks).
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,243 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+#include <process/collect.hpp>
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/gtest.hpp>
+#include <process/http.hpp>
+#include <process/id.hpp>
+#include <process/pid.hpp>
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/gtest.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "benchmarks/flags.hpp"
+#include "benchmarks/utils.hpp"
+
+#include "master/flags.hpp"
+#include "master/master.hpp"
+
+#include "messages/messages.hpp"
+
+#include "tests/cluster.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::benchmarks;
+
+using mesos::internal::master::Master;
+
+using mesos::internal::tests::Cluster;
+
+using process::Future;
+using process::PID;
+using process::Promise;
+using process::UPID;
+
+using std::cout;
+using std::endl;
+using std::list;
+using std::string;
+using std::vector;
+
+
+// A simulated slave that only re-registers with a (failed over)
+// master and answers the master's health checks.
+class SimulatedSlave : public ProtobufProcess<SimulatedSlave>
+{
+public:
+  SimulatedSlave(
+      const SlaveInfo& slaveInfo,
+      const vector<ExecutorInfo>& executorInfos,
+      const vector<Task>& tasks)
+    : ProcessBase(process::ID::generate("simulated-slave"))
+  {
+    message.mutable_slave_id()->MergeFrom(slaveInfo.id());
+    message.mutable_slave()->MergeFrom(slaveInfo);
+
+    foreach (const ExecutorInfo& executorInfo, executorInfos) {
+      message.add_executor_infos()->MergeFrom(executorInfo);
+    }
+
+    foreach (const Task& task, tasks) {
+      message.add_tasks()->MergeFrom(task);
+    }
+
+    install<SlaveReregisteredMessage>(&SimulatedSlave::reregistered);
+    install("PING", &SimulatedSlave::ping);
+  }
+
+  virtual ~SimulatedSlave() {}
+
+  // Returns a future that is satisfied once the master acknowledged
+  // the re-registration.
+  Future<Nothing> reregister(const UPID& master)
+  {
+    send(master, message);
+    return promise.future();
+  }
+
+private:
+  void reregistered(const SlaveReregisteredMessage&)
+  {
+    promise.set(Nothing());
+  }
+
+  void ping(const UPID& from, const string& body)
+  {
+    send(from, "PONG");
+  }
+
+  ReregisterSlaveMessage message;
+  Promise<Nothing> promise;
+};
+
+
+// Measures how long it takes a newly elected (i.e., failed over)
+// master to re-register '--slaves' slaves, each running
+// '--tasks_per_slave' tasks (with an executor per task) of
+// '--frameworks' frameworks that have yet to re-register. All of the
+// slaves re-register at once, as they do after a failover.
+TEST(MasterBenchmark, FailoverReregistration)
+{
+  // The tasks are assigned to the frameworks round-robin.
+  ASSERT_LT(0u, benchmarks::flags.frameworks)
+    << "Expecting at least one framework";
+
+  Try<string> directory = os::mkdtemp();
+  ASSERT_SOME(directory);
+
+  Resources resources = Resources::parse(
+      "cpus:16;mem:65536;disk:1048576;ports:[31000-32000]").get();
+
+  Resources task =
+    Resources::parse("cpus:0.1;mem:128;ports:[31000-31000]").get();
+
+  vector<SimulatedSlave*> slaves;
+
+  for (uint32_t i = 0; i < benchmarks::flags.slaves; i++) {
+    SlaveInfo slaveInfo;
+    slaveInfo.mutable_id()->set_value("slave" + stringify(i));
+    slaveInfo.set_hostname("host" + stringify(i));
+    slaveInfo.mutable_resources()->MergeFrom(resources);
+
+    vector<ExecutorInfo> executorInfos;
+    vector<Task> tasks;
+
+    for (uint32_t j = 0; j < benchmarks::flags.tasks_per_slave; j++) {
+      FrameworkID frameworkId;
+      frameworkId.set_value(
+          "framework" + stringify((i + j) % benchmarks::flags.frameworks));
+
+      ExecutorID executorId;
+      executorId.set_value("executor" + stringify(j));
+
+      ExecutorInfo executorInfo;
+      executorInfo.mutable_executor_id()->MergeFrom(executorId);
+      executorInfo.mutable_framework_id()->MergeFrom(frameworkId);
+      executorInfo.mutable_command()->set_value("exit 1");
+      executorInfo.mutable_resources()->MergeFrom(task);
+      executorInfos.push_back(executorInfo);
+
+      Task t;
+      t.set_name("task" + stringify(j));
+      t.mutable_task_id()->set_value("task" + stringify(j));
+      t.mutable_framework_id()->MergeFrom(frameworkId);
+      t.mutable_executor_id()->MergeFrom(executorId);
+      t.mutable_slave_id()->MergeFrom(slaveInfo.id());
+      t.set_state(TASK_RUNNING);
+      t.mutable_resources()->MergeFrom(task);
+      tasks.push_back(t);
+    }
+
+    SimulatedSlave* slave =
+      new SimulatedSlave(slaveInfo, executorInfos, tasks);
+    process::spawn(slave);
+    slaves.push_back(slave);
+  }
+
+  printMemory("before failover");
+
+  Cluster cluster;
+
+  master::Flags masterFlags;
+  masterFlags.work_dir = directory.get();
+
+  Try<PID<Master> > master = cluster.masters.start(masterFlags);
+  ASSERT_SOME(master);
+
+  ASSERT_NO_FATAL_FAILURE(awaitElected(master.get()));
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  list<Future<Nothing> > reregistered;
+  foreach (SimulatedSlave* slave, slaves) {
+    reregistered.push_back(
+        dispatch(slave, &SimulatedSlave::reregister, master.get()));
+  }
+
+  Future<list<Nothing> > all = process::collect(reregistered);
+  AWAIT_READY_FOR(all, Hours(1));
+
+  Duration elapsed = stopwatch.elapsed();
+
+  // The master is recovered once it can serve requests again, i.e.,
+  // once it got through all of the re-registrations.
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "health");
+  AWAIT_READY_FOR(response, Hours(1));
+
+  cout << "Re-registered " << benchmarks::flags.slaves << " slaves with "
+       << benchmarks::flags.tasks_per_slave << " tasks each in " << elapsed
+       << " (recovered after " << stopwatch.elapsed() << ")" << endl;
+
+  printMemory("after failover");
+
+  cluster.masters.shutdown();
+
+  foreach (SimulatedSlave* slave, slaves) {
+    process::terminate(slave);
+    process::wait(slave);
+    delete slave;
+  }
+
+  ASSERT_SOME(os::rmdir(directory.get()));
+}
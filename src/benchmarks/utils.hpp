@@ -0,0 +1,160 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BENCHMARKS_UTILS_HPP__
+#define __BENCHMARKS_UTILS_HPP__
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <process/gtest.hpp>
+#include <process/http.hpp>
+#include <process/pid.hpp>
+#include <process/timeout.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "master/master.hpp"
+
+namespace mesos {
+namespace internal {
+namespace benchmarks {
+
+// Collects the durations of the measured iterations of a benchmark
+// and summarizes them as percentiles.
+class Samples
+{
+public:
+  Samples() : sorted(true) {}
+
+  void add(const Duration& duration)
+  {
+    samples.push_back(duration);
+    sorted = false;
+  }
+
+  size_t count() const { return samples.size(); }
+
+  Duration total() const
+  {
+    Duration total = Duration::zero();
+    foreach (const Duration& duration, samples) {
+      total += duration;
+    }
+    return total;
+  }
+
+  // Returns the sample below which the given fraction (in [0, 1]) of
+  // all samples fall, using the nearest-rank method.
+  Duration percentile(double fraction)
+  {
+    if (samples.empty()) {
+      return Duration::zero();
+    }
+
+    if (!sorted) {
+      std::sort(samples.begin(), samples.end());
+      sorted = true;
+    }
+
+    size_t rank = static_cast<size_t>(fraction * samples.size());
+    return samples[std::min(rank, samples.size() - 1)];
+  }
+
+  void print(const std::string& name, std::ostream& stream = std::cout)
+  {
+    stream << name << " (" << count() << " samples):"
+           << " min=" << percentile(0.0)
+           << " p50=" << percentile(0.5)
+           << " p90=" << percentile(0.9)
+           << " p99=" << percentile(0.99)
+           << " max=" << percentile(1.0)
+           << std::endl;
+  }
+
+private:
+  std::vector<Duration> samples;
+  bool sorted;
+};
+
+
+// Returns the resident set size of the benchmark process, if known.
+inline Option<Bytes> rss()
+{
+  Result<os::Process> process = os::process(::getpid());
+
+  if (!process.isSome()) {
+    return None();
+  }
+
+  return process.get().rss;
+}
+
+
+// Prints the resident set size of the benchmark process at the
+// given point of the benchmark.
+inline void printMemory(const std::string& when)
+{
+  Option<Bytes> memory = rss();
+  std::cout << "RSS " << when << ": "
+            << (memory.isSome() ? stringify(memory.get()) : "unknown")
+            << std::endl;
+}
+
+
+// Waits until the master got elected, since it ignores (most)
+// messages until then (or fails if that takes too long).
+inline void awaitElected(const process::PID<master::Master>& master)
+{
+  const Duration duration = Seconds(15);
+  const process::Timeout timeout = process::Timeout::in(duration);
+
+  while (!timeout.expired()) {
+    process::Future<process::http::Response> response =
+      process::http::get(master, "state.json");
+
+    AWAIT_READY(response);
+
+    if (strings::contains(response.get().body, "\"leader\"")) {
+      return;
+    }
+
+    os::sleep(Milliseconds(10));
+  }
+
+  FAIL() << "The master did not get elected within " << duration;
+}
+
+} // namespace benchmarks {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __BENCHMARKS_UTILS_HPP__
@@ -0,0 +1,53 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COMMON_HTTP_HPP__
+#define __COMMON_HTTP_HPP__
+
+#include <string>
+
+#include <process/http.hpp>
+
+#include <stout/option.hpp>
+
+namespace mesos {
+namespace internal {
+namespace http {
+
+// Returns a response for an already rendered JSON 'body', optionally
+// wrapped in a 'jsonp' callback (like OK(JSON::Value, jsonp)).
+inline process::http::OK json(
+    const std::string& body,
+    const Option<std::string>& jsonp)
+{
+  if (jsonp.isSome()) {
+    process::http::OK ok(jsonp.get() + "(" + body + ");");
+    ok.headers["Content-Type"] = "text/javascript";
+    return ok;
+  }
+
+  process::http::OK ok(body);
+  ok.headers["Content-Type"] = "application/json";
+  return ok;
+}
+
+} // namespace http {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __COMMON_HTTP_HPP__
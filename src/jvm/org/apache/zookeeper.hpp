@@ -131,6 +131,16 @@ public:
     return Jvm::get()->invoke<int>(object, method);
   }
 
+  int getTickTime()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ZooKeeperServer")
+        .method("getTickTime")
+        .returns(Jvm::get()->intClass));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
   int getClientPort()
   {
     static Jvm::Method method = Jvm::get()->findMethod(
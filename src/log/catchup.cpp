@@ -18,10 +18,14 @@
 
 #include <list>
 
-#include <process/collect.hpp>
+#include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/id.hpp>
 #include <process/process.hpp>
+#include <process/timer.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
 #include <stout/stringify.hpp>
 
@@ -161,10 +165,19 @@ static Future<uint64_t> catchup(
 }
 
 
-// TODO(jieyu): Our current implementation catches-up each position in
-// the set sequentially. In the future, we may want to parallelize it
-// to improve the performance. Also, we may want to implement rate
-// control here so that we don't saturate the network or disk.
+// Catches-up a set of positions in two phases. First, the learned
+// actions are read from the other replicas in chunks of consecutive
+// positions (see 'transfer'): the other replicas are asked one at a
+// time until a VOTING replica responds with the learned actions it
+// has within the chunk, which get persisted in the local replica
+// with a single write. Then, each of the positions that are still
+// missing (i.e., unlearned or not known to the replica that
+// responded) gets caught-up with Paxos.
+//
+// TODO(jieyu): We catch-up the remaining positions sequentially. In
+// the future, we may want to parallelize it to improve the
+// performance. Also, we may want to implement rate control here so
+// that we don't saturate the network or disk.
 class BulkCatchUpProcess : public Process<BulkCatchUpProcess>
 {
 public:
@@ -192,21 +205,228 @@ protected:
     promise.future().onDiscarded(lambda::bind(
         static_cast<void(*)(const UPID&, bool)>(terminate), self(), true));
 
-    // Catch-up each position in the set sequentially.
+    // Read the learned actions in chunks, starting with the lowest
+    // position.
     it = positions.begin();
 
-    catchup();
+    transfer();
   }
 
   virtual void finalize()
   {
+    response.discard();
+    learning.discard();
     catching.discard();
   }
 
 private:
-  void catchup()
+  void transfer()
   {
     if (it == positions.end()) {
+      // Catch-up each of the remaining positions sequentially.
+      it = remaining.begin();
+      catchup();
+      return;
+    }
+
+    // The chunk starts at the lowest position that is yet to be read
+    // and ends at the highest position within the chunk that needs
+    // to be read (i.e., we don't read beyond what is needed).
+    static const uint64_t CHUNK = 1024;
+
+    const uint64_t from = *it;
+
+    set<uint64_t>::const_iterator last = it;
+    for (set<uint64_t>::const_iterator next = it;
+         next != positions.end() && *next - from < CHUNK;
+         ++next) {
+      last = next;
+    }
+
+    reading.set_from(from);
+    reading.set_to(*last);
+
+    network->members()
+      .onAny(defer(self(), &Self::_transfer, lambda::_1));
+  }
+
+  void _transfer(const Future<set<UPID> >& members)
+  {
+    if (!members.isReady()) {
+      promise.fail(
+          members.isFailed() ?
+          "Failed to get the replicas in the network: " + members.failure() :
+          "Not expecting discarded future");
+
+      terminate(self());
+      return;
+    }
+
+    // Ask the other replicas one at a time (there is no need to ask
+    // the local replica).
+    peers.clear();
+    foreach (const UPID& pid, members.get()) {
+      if (pid != replica->pid()) {
+        peers.push_back(pid);
+      }
+    }
+
+    ask();
+  }
+
+  void ask()
+  {
+    if (peers.empty()) {
+      // None of the other replicas is VOTING (or reachable).
+      transferred(list<Action>(), reading.to());
+      return;
+    }
+
+    const UPID pid = peers.front();
+    peers.pop_front();
+
+    response = protocol::read(pid, reading);
+
+    // Don't wait forever for a replica that is not reachable.
+    static const Duration T = Seconds(10);
+    timer = delay(T, self(), &Self::timedout, response);
+
+    response.onAny(defer(self(), &Self::received, response));
+  }
+
+  void received(const Future<ReadResponse>& future)
+  {
+    // Ignore responses that arrive after we gave up on the request.
+    if (!(future == response)) {
+      return;
+    }
+
+    Timer::cancel(timer);
+
+    if (!future.isReady() || !future.get().okay()) {
+      // Ask the next replica instead.
+      ask();
+      return;
+    }
+
+    const ReadResponse& response_ = future.get();
+
+    // A response that got too big only covers the positions up to
+    // 'last', the positions after it are read with the next request.
+    uint64_t last = reading.to();
+    if (response_.has_last() &&
+        response_.last() >= reading.from() &&
+        response_.last() < reading.to()) {
+      last = response_.last();
+    }
+
+    list<Action> actions;
+    foreach (const Action& action, response_.actions()) {
+      if (valid(action) && action.position() <= last) {
+        actions.push_back(action);
+      } else {
+        LOG(WARNING) << "Ignoring invalid action at position "
+                     << action.position() << " read for positions "
+                     << reading.from() << " -> " << last;
+      }
+    }
+
+    transferred(actions, last);
+  }
+
+  void timedout(const Future<ReadResponse>& future)
+  {
+    // Ignore the timeout if the request has been handled already
+    // (i.e., the timer could not be cancelled in time).
+    if (!(future == response) || !future.isPending()) {
+      return;
+    }
+
+    LOG(INFO) << "Timed out reading positions "
+              << reading.from() << " -> " << reading.to()
+              << " from a replica";
+
+    // This asks the next replica (see 'received').
+    response.discard();
+  }
+
+  // Returns true if the action is one that we asked for and is
+  // complete.
+  bool valid(const Action& action)
+  {
+    if (action.position() < reading.from() ||
+        action.position() > reading.to() ||
+        positions.count(action.position()) == 0) {
+      return false;
+    }
+
+    if (!action.has_learned() || !action.learned() ||
+        !action.has_performed() || !action.has_type()) {
+      return false;
+    }
+
+    switch (action.type()) {
+      case Action::NOP:
+        return action.has_nop();
+      case Action::APPEND:
+        return action.has_append();
+      case Action::TRUNCATE:
+        return action.has_truncate();
+      default:
+        return false;
+    }
+  }
+
+  // Continues after the positions up to 'last' have been read.
+  void transferred(const list<Action>& actions, uint64_t last)
+  {
+    // Everything in the chunk that we did not read needs Paxos.
+    set<uint64_t> read;
+    foreach (const Action& action, actions) {
+      read.insert(action.position());
+    }
+
+    for (; it != positions.end() && *it <= last; ++it) {
+      if (read.count(*it) == 0) {
+        remaining.insert(*it);
+      }
+    }
+
+    if (actions.empty()) {
+      transfer();
+      return;
+    }
+
+    LOG(INFO) << "Read " << actions.size() << " learned actions for positions "
+              << reading.from() << " -> " << last;
+
+    // Store the future so that we can discard it if the user wants to
+    // cancel the catch-up operation.
+    learning = replica->learn(actions);
+    learning.onAny(defer(self(), &Self::learned));
+  }
+
+  void learned()
+  {
+    // No one can discard the future 'learning' except the 'finalize'.
+    CHECK(!learning.isDiscarded());
+
+    if (learning.isFailed()) {
+      promise.fail("Failed to persist learned actions: " + learning.failure());
+      terminate(self());
+      return;
+    } else if (!learning.get()) {
+      promise.fail("Failed to persist learned actions");
+      terminate(self());
+      return;
+    }
+
+    transfer();
+  }
+
+  void catchup()
+  {
+    if (it == remaining.end()) {
       promise.set(Nothing());
       terminate(self());
       return;
@@ -249,9 +469,20 @@ private:
   const set<uint64_t> positions;
 
   uint64_t proposal;
-  set<uint64_t>::iterator it;
+
+  // Iterates over 'positions' while reading and then over
+  // 'remaining' while catching-up each of them.
+  set<uint64_t>::const_iterator it;
+
+  // The positions that were not read from the other replicas.
+  set<uint64_t> remaining;
 
   process::Promise<Nothing> promise;
+  ReadRequest reading;
+  list<UPID> peers; // The replicas yet to be asked for 'reading'.
+  Future<ReadResponse> response;
+  Timer timer;
+  Future<bool> learning;
   Future<uint64_t> catching;
 };
 
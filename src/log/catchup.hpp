@@ -35,11 +35,14 @@ namespace mesos {
 namespace internal {
 namespace log {
 
-// Catches-up a set of log positions in the local replica. The user of
-// this function can provide a hint on the proposal number that will
-// be used for Paxos. This could potentially save us a few Paxos
-// rounds. However, if the user has no idea what proposal number to
-// use, he can just use an arbitrary proposal number (e.g., 0).
+// Catches-up a set of log positions in the local replica. The learned
+// actions are read in bulk from the other replicas in the network,
+// only the positions that are not learned by any of them go through
+// Paxos (one after another). The user of this function can provide a
+// hint on the proposal number that will be used for Paxos. This could
+// potentially save us a few Paxos rounds. However, if the user has no
+// idea what proposal number to use, he can just use an arbitrary
+// proposal number (e.g., 0).
 extern process::Future<Nothing> catchup(
     size_t quorum,
     const process::Shared<Replica>& replica,
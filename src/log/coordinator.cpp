@@ -17,12 +17,15 @@
  */
 
 #include <algorithm>
+#include <deque>
+#include <vector>
 
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/none.hpp>
 
 #include "common/type_utils.hpp"
@@ -35,8 +38,10 @@
 
 using namespace process;
 
+using std::deque;
 using std::set;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -48,11 +53,13 @@ public:
   CoordinatorProcess(
       size_t _quorum,
       const Shared<Replica>& _replica,
-      const Shared<Network>& _network)
+      const Shared<Network>& _network,
+      size_t _window)
     : ProcessBase(ID::generate("log-coordinator")),
       quorum(_quorum),
       replica(_replica),
       network(_network),
+      window(_window),
       state(INITIAL),
       proposal(0),
       index(0) {}
@@ -62,14 +69,22 @@ public:
   // See comments in 'coordinator.hpp'.
   Future<Option<uint64_t> > elect();
   Future<uint64_t> demote();
-  Future<uint64_t> append(const string& bytes);
+  Future<uint64_t> append(const Action::Append& append);
   Future<uint64_t> truncate(uint64_t to);
 
 protected:
   virtual void finalize()
   {
     electing.discard();
-    writing.discard();
+
+    foreach (Write* write, writes) {
+      if (write->writing.isSome()) {
+        write->writing.get().discard();
+      }
+      write->promise.future().discard();
+      delete write;
+    }
+    writes.clear();
   }
 
 private:
@@ -93,19 +108,21 @@ private:
   /////////////////////////////////
 
   Future<uint64_t> write(const Action& action);
+  void runWrites();
   Future<WriteResponse> runWritePhase(const Action& action);
   Future<Nothing> checkWritePhase(const WriteResponse& response);
   Future<Nothing> runLearnPhase(const Action& action);
   Future<bool> checkLearnPhase(const Action& action);
-  Future<uint64_t> updateIndexAfterWritten(bool missing);
-  void writingFinished();
-  void writingFailed();
-  void writingAborted();
+  Future<uint64_t> getPositionAfterWritten(uint64_t position, bool missing);
+  void writingFinished(const Future<uint64_t>& writing);
 
   const size_t quorum;
   const Shared<Replica> replica;
   const Shared<Network> network;
 
+  // The maximum number of writes in flight.
+  const size_t window;
+
   // The current state of the coordinator. A coordinator needs to be
   // elected first to perform append and truncate operations. If one
   // tries to do an append or a truncate while the coordinator is not
@@ -113,7 +130,9 @@ private:
   // coordinator does not declare itself as elected until it wins the
   // election and has filled all existing positions. A coordinator is
   // put in electing state after it decides to go for an election and
-  // before it is elected.
+  // before it is elected. An elected coordinator is in writing state
+  // while it has writes that have not finished yet, more appends and
+  // truncates can be done in the meantime.
   enum {
     INITIAL,
     ELECTING,
@@ -128,7 +147,25 @@ private:
   uint64_t index;
 
   Future<Option<uint64_t> > electing;
-  Future<uint64_t> writing;
+
+  // An append or truncate that got a position assigned.
+  struct Write
+  {
+    explicit Write(const Action& _action) : action(_action) {}
+
+    const Action action;
+
+    // The write and learn phases, none until the write is started.
+    Option<Future<uint64_t> > writing;
+
+    process::Promise<uint64_t> promise;
+  };
+
+  // The writes that have not finished yet, ordered by position. The
+  // write and learn phases for (at most) the first 'window' writes
+  // are run concurrently, but the writes finish (i.e., their promises
+  // get set) in order of their positions.
+  deque<Write*> writes;
 };
 
 
@@ -286,14 +323,12 @@ Future<uint64_t> CoordinatorProcess::demote()
 /////////////////////////////////////////////////
 
 
-Future<uint64_t> CoordinatorProcess::append(const string& bytes)
+Future<uint64_t> CoordinatorProcess::append(const Action::Append& append)
 {
   if (state == INITIAL) {
     return Future<uint64_t>::failed("Coordinator is not elected");
   } else if (state == ELECTING) {
     return Future<uint64_t>::failed("Coordinator is being elected");
-  } else if (state == WRITING) {
-    return Future<uint64_t>::failed("Coordinator is currently writing");
   }
 
   Action action;
@@ -301,8 +336,7 @@ Future<uint64_t> CoordinatorProcess::append(const string& bytes)
   action.set_promised(proposal);
   action.set_performed(proposal);
   action.set_type(Action::APPEND);
-  Action::Append* append = action.mutable_append();
-  append->set_bytes(bytes);
+  action.mutable_append()->CopyFrom(append);
 
   return write(action);
 }
@@ -314,8 +348,6 @@ Future<uint64_t> CoordinatorProcess::truncate(uint64_t to)
     return Future<uint64_t>::failed("Coordinator is not elected");
   } else if (state == ELECTING) {
     return Future<uint64_t>::failed("Coordinator is being elected");
-  } else if (state == WRITING) {
-    return Future<uint64_t>::failed("Coordinator is currently writing");
   }
 
   Action action;
@@ -332,24 +364,62 @@ Future<uint64_t> CoordinatorProcess::truncate(uint64_t to)
 
 Future<uint64_t> CoordinatorProcess::write(const Action& action)
 {
-  LOG(INFO) << "Coordinator attempting to write " << action.type()
-            << " action at position " << action.position();
-
-  CHECK_EQ(state, ELECTED);
+  CHECK(state == ELECTED || state == WRITING);
   CHECK(action.has_performed() && action.has_type());
+  CHECK_EQ(action.position(), index);
 
   state = WRITING;
 
-  writing = runWritePhase(action)
-    .then(defer(self(), &Self::checkWritePhase, lambda::_1))
-    .then(defer(self(), &Self::runLearnPhase, action))
-    .then(defer(self(), &Self::checkLearnPhase, action))
-    .then(defer(self(), &Self::updateIndexAfterWritten, lambda::_1))
-    .onReady(defer(self(), &Self::writingFinished))
-    .onFailed(defer(self(), &Self::writingFailed))
-    .onDiscarded(defer(self(), &Self::writingAborted));
+  // The next append or truncate goes to the next position, even
+  // though this one has not been written yet.
+  index++;
+
+  Write* write = new Write(action);
+  writes.push_back(write);
+
+  Future<uint64_t> future = write->promise.future();
+
+  runWrites();
+
+  return future;
+}
+
+
+void CoordinatorProcess::runWrites()
+{
+  CHECK_EQ(state, WRITING);
+
+  size_t running = 0;
+
+  foreach (Write* write, writes) {
+    if (running == window) {
+      break;
+    }
+
+    running++;
+
+    if (write->writing.isSome()) {
+      continue;
+    }
+
+    const Action& action = write->action;
+
+    LOG(INFO) << "Coordinator attempting to write " << action.type()
+              << " action at position " << action.position();
+
+    Future<uint64_t> writing = runWritePhase(action)
+      .then(defer(self(), &Self::checkWritePhase, lambda::_1))
+      .then(defer(self(), &Self::runLearnPhase, action))
+      .then(defer(self(), &Self::checkLearnPhase, action))
+      .then(defer(self(),
+                  &Self::getPositionAfterWritten,
+                  action.position(),
+                  lambda::_1));
 
-  return writing;
+    write->writing = writing;
+
+    writing.onAny(defer(self(), &Self::writingFinished, lambda::_1));
+  }
 }
 
 
@@ -363,9 +433,9 @@ Future<Nothing> CoordinatorProcess::checkWritePhase(
     const WriteResponse& response)
 {
    if (!response.okay()) {
-    // Received a NACK. Save the proposal number.
-    CHECK_LE(proposal, response.proposal());
-    proposal = response.proposal();
+    // Received a NACK. Save the proposal number, which is the highest
+    // one if more than one of the writes in flight got a NACK.
+    proposal = std::max(proposal, response.proposal());
 
     return Future<Nothing>::failed("Coordinator demoted");
   } else {
@@ -389,33 +459,70 @@ Future<bool> CoordinatorProcess::checkLearnPhase(const Action& action)
 }
 
 
-Future<uint64_t> CoordinatorProcess::updateIndexAfterWritten(bool missing)
+Future<uint64_t> CoordinatorProcess::getPositionAfterWritten(
+    uint64_t position,
+    bool missing)
 {
   CHECK(!missing) << "Not expecting local replica to be missing position "
-                  << index << " after the writing is done";
+                  << position << " after the writing is done";
 
-  return index++;
+  return position;
 }
 
 
-void CoordinatorProcess::writingFinished()
+void CoordinatorProcess::writingFinished(const Future<uint64_t>& writing)
 {
-  CHECK_EQ(state, WRITING);
-  state = ELECTED;
-}
+  // Writes that already got failed (because a write before them
+  // failed) are ignored.
+  bool found = false;
+  foreach (Write* write, writes) {
+    if (write->writing.isSome() && write->writing.get() == writing) {
+      found = true;
+      break;
+    }
+  }
 
+  if (!found) {
+    return;
+  }
 
-void CoordinatorProcess::writingFailed()
-{
   CHECK_EQ(state, WRITING);
-  state = INITIAL;
-}
 
+  if (!writing.isReady()) {
+    // We can't tell which of the other writes in flight made it into
+    // the log, so we fail all of them. The positions that did not get
+    // written will be filled the next time a coordinator gets elected.
+    const string failure = writing.isFailed()
+      ? writing.failure()
+      : "Not expecting discarded future";
 
-void CoordinatorProcess::writingAborted()
-{
-  CHECK_EQ(state, WRITING);
-  state = ELECTED;
+    state = INITIAL;
+
+    foreach (Write* write, writes) {
+      if (write->writing.isSome()) {
+        write->writing.get().discard();
+      }
+      write->promise.fail(failure);
+      delete write;
+    }
+    writes.clear();
+    return;
+  }
+
+  while (!writes.empty() &&
+         writes.front()->writing.isSome() &&
+         writes.front()->writing.get().isReady()) {
+    Write* write = writes.front();
+    writes.pop_front();
+    write->promise.set(write->writing.get().get());
+    delete write;
+  }
+
+  if (writes.empty()) {
+    state = ELECTED;
+  } else {
+    runWrites();
+  }
 }
 
 
@@ -427,9 +534,10 @@ void CoordinatorProcess::writingAborted()
 Coordinator::Coordinator(
     size_t quorum,
     const Shared<Replica>& replica,
-    const Shared<Network>& network)
+    const Shared<Network>& network,
+    size_t window)
 {
-  process = new CoordinatorProcess(quorum, replica, network);
+  process = new CoordinatorProcess(quorum, replica, network, window);
   spawn(process);
 }
 
@@ -456,7 +564,23 @@ Future<uint64_t> Coordinator::demote()
 
 Future<uint64_t> Coordinator::append(const string& bytes)
 {
-  return dispatch(process, &CoordinatorProcess::append, bytes);
+  Action::Append append;
+  append.set_bytes(bytes);
+
+  return dispatch(process, &CoordinatorProcess::append, append);
+}
+
+
+Future<uint64_t> Coordinator::append(const vector<string>& records)
+{
+  Action::Append append;
+  append.set_bytes("");
+
+  foreach (const string& record, records) {
+    append.add_records(record);
+  }
+
+  return dispatch(process, &CoordinatorProcess::append, append);
 }
 
 
@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include <process/future.hpp>
 #include <process/shared.hpp>
@@ -42,10 +43,12 @@ class CoordinatorProcess;
 class Coordinator
 {
 public:
+  // At most 'window' appends and truncates are written concurrently.
   Coordinator(
       size_t _quorum,
       const process::Shared<Replica>& _replica,
-      const process::Shared<Network>& _network);
+      const process::Shared<Network>& _network,
+      size_t _window = 32);
 
   ~Coordinator();
 
@@ -61,9 +64,18 @@ public:
   process::Future<uint64_t> demote();
 
   // Appends the specified bytes to the end of the log. Returns the
-  // position of the appended entry if the operation succeeds.
+  // position of the appended entry if the operation succeeds. Appends
+  // and truncates can be done while others are still in progress,
+  // they are written concurrently but succeed in order. If one of
+  // them fails, all of those in progress fail and the coordinator
+  // needs to be elected again.
   process::Future<uint64_t> append(const std::string& bytes);
 
+  // Appends all of the specified records to the end of the log as a
+  // single entry (i.e., at a single position). Returns the position
+  // of the appended entry if the operation succeeds.
+  process::Future<uint64_t> append(const std::vector<std::string>& records);
+
   // Removes all log entries preceding the log entry at the given
   // position (to). Returns the position at which the truncate
   // operation is written if the operation succeeds.
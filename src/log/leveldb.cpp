@@ -16,19 +16,29 @@
  * limitations under the License.
  */
 
+#include <map>
+
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
 #include <leveldb/comparator.h>
 #include <leveldb/write_batch.h>
 
+#include <process/async.hpp>
+
 #include <stout/check.hpp>
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/none.hpp>
 #include <stout/numify.hpp>
+#include <stout/result.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
 
 #include "log/leveldb.hpp"
 
+using std::list;
+using std::map;
+using std::set;
 using std::string;
 
 namespace mesos {
@@ -118,8 +128,96 @@ static uint64_t decode(const leveldb::Slice& s)
 }
 
 
+// The key of the snapshot record. Note that it sorts after the keys
+// of all the positions (see 'encode').
+static const string SNAPSHOT = "snapshot";
+
+
+// Adds (or removes) the position to (or from) the positions, keeping
+// track in 'changes' of whether each changed position was included
+// before its first change (so that the changes can be undone).
+static void mark(
+    set<uint64_t>* positions,
+    map<uint64_t, bool>* changes,
+    uint64_t position,
+    bool add)
+{
+  if (add == (positions->count(position) > 0)) {
+    return;
+  }
+
+  changes->insert(std::make_pair(position, !add));
+
+  if (add) {
+    positions->insert(position);
+  } else {
+    positions->erase(position);
+  }
+}
+
+
+// Reverts the positions to how they were before the changes.
+static void undo(set<uint64_t>* positions, const map<uint64_t, bool>& changes)
+{
+  for (map<uint64_t, bool>::const_iterator it = changes.begin();
+       it != changes.end();
+       ++it) {
+    if (it->second) {
+      positions->insert(it->first);
+    } else {
+      positions->erase(it->first);
+    }
+  }
+}
+
+
+// Returns the record stored at the specified key, if any.
+static Result<Record> get(leveldb::DB* db, const string& key)
+{
+  string value;
+
+  leveldb::Status status = db->Get(leveldb::ReadOptions(), key, &value);
+
+  if (status.IsNotFound()) {
+    return None();
+  } else if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  google::protobuf::io::ArrayInputStream stream(value.data(), value.size());
+
+  Record record;
+
+  if (!record.ParseFromZeroCopyStream(&stream)) {
+    return Error("Failed to deserialize record");
+  }
+
+  return record;
+}
+
+
+// Compacts the keys within [begin, end), executed via 'async'.
+static Nothing compactRange(
+    leveldb::DB* db,
+    const string& begin,
+    const string& end)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  leveldb::Slice _begin(begin);
+  leveldb::Slice _end(end);
+
+  db->CompactRange(&_begin, &_end);
+
+  LOG(INFO) << "Compacting leveldb took " << stopwatch.elapsed();
+
+  return Nothing();
+}
+
+
 LevelDBStorage::LevelDBStorage()
-  : db(NULL), first(0)
+  : db(NULL), first(0), begin(0), snapshot(0), compacted(0)
 {
   // Nothing to see here.
 }
@@ -127,6 +225,11 @@ LevelDBStorage::LevelDBStorage()
 
 LevelDBStorage::~LevelDBStorage()
 {
+  // Wait for the background compaction which is using the db.
+  if (compacting.isSome()) {
+    compacting.get().await();
+  }
+
   delete db; // Might be null if open failed in LevelDBStorage::recover.
 }
 
@@ -165,21 +268,45 @@ Try<LevelDBStorage::State> LevelDBStorage::restore(const string& path)
 
   LOG(INFO) << "Opened db in " << stopwatch.elapsed();
 
-  stopwatch.start(); // Restart the stopwatch.
-
-  // TODO(benh): Conditionally compact to avoid long recovery times?
-  db->CompactRange(NULL, NULL);
-
-  LOG(INFO) << "Compacted db in " << stopwatch.elapsed();
-
   State state;
   state.begin = 0;
   state.end = 0;
+  state.snapshot = 0;
+
+  // Positions before the snapshot (if any) don't need to be read
+  // since they are all learned, but we need to read the metadata
+  // (which is stored before all positions) separately then. Without
+  // a snapshot (i.e., a log written before snapshots were supported)
+  // we read all of the records.
+  Result<Record> result = get(db, SNAPSHOT);
+
+  if (result.isError()) {
+    return Error("Failed to read snapshot: " + result.error());
+  } else if (result.isSome()) {
+    if (result.get().type() != Record::SNAPSHOT ||
+        !result.get().has_snapshot()) {
+      return Error("Bad snapshot record");
+    }
+
+    const Snapshot marker = result.get().snapshot();
+
+    state.begin = marker.begin();
+    state.end = marker.position() > 0 ? marker.position() - 1 : 0;
+    state.snapshot = marker.position();
+
+    result = get(db, encode(0, false));
 
-  // TODO(benh): Consider just reading the "promise" record (e.g.,
-  // 'encode(0, false)') and then iterating over the rest of the
-  // records and confirming that they are all indeed of type
-  // Record::Action.
+    if (result.isError()) {
+      return Error("Failed to read metadata: " + result.error());
+    } else if (result.isSome()) {
+      if (result.get().type() != Record::METADATA ||
+          !result.get().has_metadata()) {
+        return Error("Bad metadata record");
+      }
+
+      state.metadata.CopyFrom(result.get().metadata());
+    }
+  }
 
   stopwatch.start(); // Restart the stopwatch.
 
@@ -189,9 +316,16 @@ Try<LevelDBStorage::State> LevelDBStorage::restore(const string& path)
 
   stopwatch.start(); // Restart the stopwatch.
 
-  iterator->SeekToFirst();
+  if (state.snapshot > 0) {
+    iterator->Seek(encode(state.snapshot));
 
-  LOG(INFO) << "Seeked to beginning of db in " << stopwatch.elapsed();
+    LOG(INFO) << "Seeked to snapshot position " << state.snapshot
+              << " of db in " << stopwatch.elapsed();
+  } else {
+    iterator->SeekToFirst();
+
+    LOG(INFO) << "Seeked to beginning of db in " << stopwatch.elapsed();
+  }
 
   stopwatch.start(); // Restart the stopwatch.
 
@@ -227,6 +361,12 @@ Try<LevelDBStorage::State> LevelDBStorage::restore(const string& path)
         break;
       }
 
+      case Record::SNAPSHOT: {
+        CHECK(record.has_snapshot());
+        // Already read above.
+        break;
+      }
+
       case Record::ACTION: {
         CHECK(record.has_action());
         const Action& action = record.action();
@@ -262,126 +402,229 @@ Try<LevelDBStorage::State> LevelDBStorage::restore(const string& path)
   // remains (i.e., hasn't been deleted) in leveldb.
   iterator->Seek(encode(0));
 
-  if (iterator->Valid()) {
+  if (iterator->Valid() && iterator->key() != SNAPSHOT) {
     first = decode(iterator->key());
   }
 
   delete iterator;
 
+  compacted = first;
+
+  begin = state.begin;
+  snapshot = state.snapshot;
+  learned = state.learned;
+
   return state;
 }
 
 
 Try<Nothing> LevelDBStorage::persist(const Metadata& metadata)
+{
+  return persist(metadata, list<Action>());
+}
+
+
+Try<Nothing> LevelDBStorage::persist(const Action& action)
+{
+  return persist(None(), list<Action>(1, action));
+}
+
+
+Try<Nothing> LevelDBStorage::persist(
+    const Option<Metadata>& metadata,
+    const list<Action>& actions)
 {
   Stopwatch stopwatch;
   stopwatch.start();
 
-  leveldb::WriteOptions options;
-  options.sync = true;
+  leveldb::WriteBatch batch;
 
-  Record record;
-  record.set_type(Record::METADATA);
-  record.mutable_metadata()->CopyFrom(metadata);
+  size_t size = 0;
 
-  string value;
+  if (metadata.isSome()) {
+    Record record;
+    record.set_type(Record::METADATA);
+    record.mutable_metadata()->CopyFrom(metadata.get());
 
-  if (!record.SerializeToString(&value)) {
-    return Error("Failed to serialize record");
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Error("Failed to serialize record");
+    }
+
+    batch.Put(encode(0, false), value);
+    size += value.size();
   }
 
-  leveldb::Status status = db->Put(options, encode(0, false), value);
+  foreach (const Action& action, actions) {
+    Record record;
+    record.set_type(Record::ACTION);
+    record.mutable_action()->MergeFrom(action);
 
-  if (!status.ok()) {
-    return Error(status.ToString());
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Error("Failed to serialize record");
+    }
+
+    batch.Put(encode(action.position()), value);
+    size += value.size();
   }
 
-  LOG(INFO) << "Persisting metadata (" << value.size()
-            << " bytes) to leveldb took " << stopwatch.elapsed();
+  // Advance the snapshot (if possible) and persist it along with
+  // the records. The learned positions are updated in place (rather
+  // than copied for every write), recording the changes so that they
+  // can be undone if the write fails.
+  uint64_t begin_ = begin;
+  uint64_t snapshot_ = snapshot;
+  map<uint64_t, bool> changes;
+
+  foreach (const Action& action, actions) {
+    if (action.has_learned() && action.learned()) {
+      if (action.position() >= snapshot_) {
+        mark(&learned, &changes, action.position(), true);
+      }
 
-  return Nothing();
-}
+      if (action.has_type() && action.type() == Action::TRUNCATE) {
+        begin_ = std::max(begin_, action.truncate().to());
+      }
+    } else if (action.position() < snapshot_) {
+      // A learned position is getting overwritten (see the TODO in
+      // Replica::write), so the snapshot needs to move back.
+      for (uint64_t position = std::max(action.position() + 1, begin_);
+           position < snapshot_;
+           position++) {
+        mark(&learned, &changes, position, true);
+      }
+      snapshot_ = action.position();
+    } else {
+      mark(&learned, &changes, action.position(), false);
+    }
+  }
 
+  if (snapshot_ < begin_) {
+    snapshot_ = begin_;
+    while (!learned.empty() && *learned.begin() < begin_) {
+      mark(&learned, &changes, *learned.begin(), false);
+    }
+  }
 
-Try<Nothing> LevelDBStorage::persist(const Action& action)
-{
-  Stopwatch stopwatch;
-  stopwatch.start();
+  while (!learned.empty() && *learned.begin() == snapshot_) {
+    mark(&learned, &changes, *learned.begin(), false);
+    snapshot_++;
+  }
 
-  Record record;
-  record.set_type(Record::ACTION);
-  record.mutable_action()->MergeFrom(action);
+  if (snapshot_ != snapshot || begin_ != begin) {
+    Record record;
+    record.set_type(Record::SNAPSHOT);
+    record.mutable_snapshot()->set_position(snapshot_);
+    record.mutable_snapshot()->set_begin(begin_);
 
-  string value;
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      undo(&learned, changes);
+      return Error("Failed to serialize record");
+    }
 
-  if (!record.SerializeToString(&value)) {
-    return Error("Failed to serialize record");
+    batch.Put(SNAPSHOT, value);
+    size += value.size();
   }
 
   leveldb::WriteOptions options;
   options.sync = true;
 
-  leveldb::Status status = db->Put(options, encode(action.position()), value);
+  leveldb::Status status = db->Write(options, &batch);
 
   if (!status.ok()) {
+    undo(&learned, changes);
     return Error(status.ToString());
   }
 
-  LOG(INFO) << "Persisting action (" << value.size()
+  begin = begin_;
+  snapshot = snapshot_;
+
+  LOG(INFO) << "Persisting " << (metadata.isSome() ? "metadata and " : "")
+            << actions.size() << " action(s) (" << size
             << " bytes) to leveldb took " << stopwatch.elapsed();
 
   // Delete positions if a truncate action has been *learned*. Note
   // that we do this in a best-effort fashion (i.e., we ignore any
   // failures to the database since we can always try again).
-  if (action.has_type() && action.type() == Action::TRUNCATE &&
-      action.has_learned() && action.learned()) {
-    CHECK(action.has_truncate());
-
-    stopwatch.start(); // Restart the stopwatch.
-
-    // To actually perform the truncation in leveldb we need to remove
-    // all the keys that represent positions no longer in the log. We
-    // do this by attempting to delete all keys that represent the
-    // first position we know is still in leveldb up to (but
-    // excluding) the truncate position. Note that this works because
-    // the semantics of WriteBatch are such that even if the position
-    // doesn't exist (which is possible because this replica has some
-    // holes), we can attempt to delete the key that represents it and
-    // it will just ignore that key. This is *much* cheaper than
-    // actually iterating through the entire database instead (which
-    // was, for posterity, the original implementation). In addition,
-    // caching the "first" position we know is in the database is
-    // cheaper than using an iterator to determine the first position
-    // (which was, for posterity, the second implementation).
-
-    leveldb::WriteBatch batch;
-
-    // Add positions up to (but excluding) the truncate position to
-    // the batch starting at the first position still in leveldb.
-    uint64_t index = 0;
-    while ((first + index) < action.truncate().to()) {
-      batch.Delete(encode(first + index));
-      index++;
+  foreach (const Action& action, actions) {
+    if (action.has_type() && action.type() == Action::TRUNCATE &&
+        action.has_learned() && action.learned()) {
+      CHECK(action.has_truncate());
+      truncate(action.truncate().to());
     }
+  }
 
-    // If we added any positions, attempt to delete them!
-    if (index > 0) {
-      // We do this write asynchronously (e.g., using default options).
-      leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+  return Nothing();
+}
 
-      if (!status.ok()) {
-        LOG(WARNING) << "Ignoring leveldb batch delete failure: "
-                     << status.ToString();
-      } else {
-        first = action.truncate().to(); // Save the new first position!
 
-        LOG(INFO) << "Deleting ~" << index
-                  << " keys from leveldb took " << stopwatch.elapsed();
-      }
+void LevelDBStorage::truncate(uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // To actually perform the truncation in leveldb we need to remove
+  // all the keys that represent positions no longer in the log. We
+  // do this by attempting to delete all keys that represent the
+  // first position we know is still in leveldb up to (but
+  // excluding) the truncate position. Note that this works because
+  // the semantics of WriteBatch are such that even if the position
+  // doesn't exist (which is possible because this replica has some
+  // holes), we can attempt to delete the key that represents it and
+  // it will just ignore that key. This is *much* cheaper than
+  // actually iterating through the entire database instead (which
+  // was, for posterity, the original implementation). In addition,
+  // caching the "first" position we know is in the database is
+  // cheaper than using an iterator to determine the first position
+  // (which was, for posterity, the second implementation).
+
+  leveldb::WriteBatch batch;
+
+  // Add positions up to (but excluding) the truncate position to
+  // the batch starting at the first position still in leveldb.
+  uint64_t index = 0;
+  while ((first + index) < to) {
+    batch.Delete(encode(first + index));
+    index++;
+  }
+
+  // If we added any positions, attempt to delete them!
+  if (index > 0) {
+    // We do this write asynchronously (e.g., using default options).
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+
+    if (!status.ok()) {
+      LOG(WARNING) << "Ignoring leveldb batch delete failure: "
+                   << status.ToString();
+    } else {
+      first = to; // Save the new first position!
+
+      LOG(INFO) << "Deleting ~" << index
+                << " keys from leveldb took " << stopwatch.elapsed();
+
+      compact(to);
     }
   }
+}
 
-  return Nothing();
+
+void LevelDBStorage::compact(uint64_t to)
+{
+  // The positions that are not compacted now get compacted with the
+  // next truncation.
+  if (compacting.isSome() && compacting.get().isPending()) {
+    return;
+  }
+
+  // Have leveldb drop the deleted keys rather than (eventually) having
+  // to skip over them.
+  compacting = process::async(&compactRange, db, encode(compacted), encode(to));
+  compacted = to;
 }
 
 
@@ -417,6 +660,55 @@ Try<Action> LevelDBStorage::read(uint64_t position)
   return record.action();
 }
 
+
+Try<list<Action> > LevelDBStorage::read(uint64_t from, uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  list<Action> actions;
+
+  // Iterate over the range rather than getting each of the positions
+  // (which would look up each of them in the db from scratch).
+  leveldb::Iterator* iterator = db->NewIterator(leveldb::ReadOptions());
+
+  for (iterator->Seek(encode(from));
+       iterator->Valid() && iterator->key() != SNAPSHOT &&
+         decode(iterator->key()) <= to;
+       iterator->Next()) {
+    const leveldb::Slice& slice = iterator->value();
+
+    google::protobuf::io::ArrayInputStream stream(slice.data(), slice.size());
+
+    Record record;
+
+    if (!record.ParseFromZeroCopyStream(&stream)) {
+      delete iterator;
+      return Error("Failed to deserialize record");
+    }
+
+    if (record.type() != Record::ACTION) {
+      delete iterator;
+      return Error("Bad record");
+    }
+
+    actions.push_back(record.action());
+  }
+
+  leveldb::Status status = iterator->status();
+
+  delete iterator;
+
+  if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  LOG(INFO) << "Reading " << actions.size() << " positions from leveldb took "
+            << stopwatch.elapsed();
+
+  return actions;
+}
+
 } // namespace log {
 } // namespace internal {
 } // namespace mesos {
@@ -19,8 +19,17 @@
 #ifndef __LOG_LEVELDB_HPP__
 #define __LOG_LEVELDB_HPP__
 
+#include <stdint.h>
+
 #include <leveldb/db.h>
 
+#include <set>
+
+#include <process/future.hpp>
+
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+
 #include "log/storage.hpp"
 
 namespace mesos {
@@ -37,11 +46,34 @@ public:
   virtual Try<State> restore(const std::string& path);
   virtual Try<Nothing> persist(const Metadata& metadata);
   virtual Try<Nothing> persist(const Action& action);
+  virtual Try<Nothing> persist(
+      const Option<Metadata>& metadata,
+      const std::list<Action>& actions);
   virtual Try<Action> read(uint64_t position);
+  virtual Try<std::list<Action> > read(uint64_t from, uint64_t to);
 
 private:
+  // Deletes the positions preceding the specified position (in a
+  // best-effort fashion).
+  void truncate(uint64_t to);
+
+  // Compacts the deleted positions preceding the specified position
+  // in the background, unless a compaction is still in progress.
+  void compact(uint64_t to);
+
   leveldb::DB* db;
   uint64_t first; // First position still in leveldb, used during truncation.
+
+  // The snapshot of the log as last persisted (see Snapshot) and the
+  // learned positions after it, used to advance the snapshot.
+  uint64_t begin;
+  uint64_t snapshot;
+  std::set<uint64_t> learned;
+
+  // Positions preceding this one have been compacted (or are being
+  // compacted if 'compacting' is pending).
+  uint64_t compacted;
+  Option<process::Future<Nothing> > compacting;
 };
 
 } // namespace log {
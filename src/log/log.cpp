@@ -41,6 +41,7 @@ using namespace process;
 using std::list;
 using std::set;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -152,6 +153,7 @@ public:
 
   Future<Option<Log::Position> > elect();
   Future<Log::Position> append(const string& bytes);
+  Future<Log::Position> append(const vector<string>& records);
   Future<Log::Position> truncate(const Log::Position& to);
 
 protected:
@@ -515,7 +517,15 @@ Future<list<Log::Entry> > LogReaderProcess::__read(
     // And only return appends.
     CHECK(action.has_type());
     if (action.type() == Action::APPEND) {
-      entries.push_back(Log::Entry(action.position(), action.append().bytes()));
+      if (action.append().records_size() > 0) {
+        // All of the records of an append share its position.
+        foreach (const string& record, action.append().records()) {
+          entries.push_back(Log::Entry(action.position(), record));
+        }
+      } else {
+        entries.push_back(
+            Log::Entry(action.position(), action.append().bytes()));
+      }
     }
   }
 
@@ -653,6 +663,26 @@ Future<Log::Position> LogWriterProcess::append(const string& bytes)
 }
 
 
+Future<Log::Position> LogWriterProcess::append(const vector<string>& records)
+{
+  if (coordinator == NULL) {
+    return Failure("No election has been performed");
+  }
+
+  if (error.isSome()) {
+    return Failure(error.get());
+  }
+
+  if (records.empty()) {
+    return Failure("No records to append");
+  }
+
+  return coordinator->append(records)
+    .then(lambda::bind(&Self::position, lambda::_1))
+    .onFailed(defer(self(), &Self::failed, lambda::_1));
+}
+
+
 Future<Log::Position> LogWriterProcess::truncate(const Log::Position& to)
 {
   if (coordinator == NULL) {
@@ -842,15 +872,13 @@ Log::Writer::~Writer()
 }
 
 
-Result<Log::Position> Log::Writer::append(
-    const string& data,
+// Waits for an append (of one or more records) to the log until the
+// timeout expires, in which case the append is discarded and none is
+// returned.
+static Result<Log::Position> _append(
+    Future<Log::Position> future,
     const Timeout& timeout)
 {
-  LOG(INFO) << "Attempting to append " << data.size() << " bytes to the log";
-
-  Future<Log::Position> future =
-    dispatch(process, &LogWriterProcess::append, data);
-
   if (!future.await(timeout.remaining())) {
     LOG(INFO) << "Timed out while trying to append the log";
 
@@ -873,6 +901,35 @@ Result<Log::Position> Log::Writer::append(
 }
 
 
+Result<Log::Position> Log::Writer::append(
+    const string& data,
+    const Timeout& timeout)
+{
+  LOG(INFO) << "Attempting to append " << data.size() << " bytes to the log";
+
+  // Disambiguates the overloaded LogWriterProcess::append.
+  Future<Log::Position> (LogWriterProcess::*append)(const string&) =
+    &LogWriterProcess::append;
+
+  return _append(dispatch(process, append, data), timeout);
+}
+
+
+Result<Log::Position> Log::Writer::append(
+    const vector<string>& records,
+    const Timeout& timeout)
+{
+  LOG(INFO) << "Attempting to append " << records.size()
+            << " records to the log";
+
+  // Disambiguates the overloaded LogWriterProcess::append.
+  Future<Log::Position> (LogWriterProcess::*append)(const vector<string>&) =
+    &LogWriterProcess::append;
+
+  return _append(dispatch(process, append, records), timeout);
+}
+
+
 Result<Log::Position> Log::Writer::truncate(
     const Log::Position& to,
     const Timeout& timeout)
@@ -22,6 +22,7 @@
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/owned.hpp>
 #include <process/process.hpp>
@@ -129,6 +130,8 @@ public:
 
     // Returns all entries between the specified positions, unless
     // those positions are invalid, in which case returns an error.
+    // The records appended together (see Writer::append) are
+    // returned as separate entries with the same position.
     Result<std::list<Entry> > read(
         const Position& from,
         const Position& to,
@@ -167,6 +170,13 @@ public:
         const std::string& data,
         const process::Timeout& timeout);
 
+    // Attempts to append all of the specified records to the log with
+    // a single write, i.e., all of them end up at the same position.
+    // Otherwise like appending a single record (see above).
+    Result<Position> append(
+        const std::vector<std::string>& records,
+        const process::Timeout& timeout);
+
     // Attempts to truncate the log up to but not including the
     // specificed position. A none result means the operation timed
     // out, otherwise the new ending position of the log is returned
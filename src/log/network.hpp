@@ -73,6 +73,10 @@ public:
   // Set the PIDs that are part of this network.
   void set(const std::set<process::UPID>& pids);
 
+  // Returns the PIDs that are currently part of this network, e.g.,
+  // to send a request to only one of them.
+  process::Future<std::set<process::UPID> > members() const;
+
   // Returns a future which gets set when the network size satisfies
   // the constraint specified by 'size' and 'mode'. For example, if
   // 'size' is 2 and 'mode' is GREATER_THAN, then the returned future
@@ -179,6 +183,11 @@ public:
     update();
   }
 
+  std::set<process::UPID> members()
+  {
+    return pids;
+  }
+
   process::Future<size_t> watch(size_t size, Network::WatchMode mode)
   {
     if (satisfied(size, mode)) {
@@ -337,6 +346,12 @@ inline void Network::set(const std::set<process::UPID>& pids)
 }
 
 
+inline process::Future<std::set<process::UPID> > Network::members() const
+{
+  return process::dispatch(process, &NetworkProcess::members);
+}
+
+
 inline process::Future<size_t> Network::watch(
     size_t size, Network::WatchMode mode) const
 {
@@ -17,18 +17,23 @@
  */
 
 #include <algorithm>
+#include <list>
+#include <map>
+#include <utility>
 
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/check.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/result.hpp>
+#include <stout/stringify.hpp>
 #include <stout/try.hpp>
-#include <stout/utils.hpp>
 
 #include "common/type_utils.hpp"
 
@@ -39,6 +44,7 @@
 using namespace process;
 
 using std::list;
+using std::map;
 using std::set;
 using std::string;
 
@@ -52,10 +58,84 @@ namespace protocol {
 Protocol<PromiseRequest, PromiseResponse> promise;
 Protocol<WriteRequest, WriteResponse> write;
 Protocol<RecoverRequest, RecoverResponse> recover;
+Protocol<ReadRequest, ReadResponse> read;
 
 } // namespace protocol {
 
 
+// The total size of the actions the replica keeps in memory so that
+// readers tailing the log don't have to go to disk.
+static const Bytes MAX_CACHED_ACTIONS_SIZE = Megabytes(64);
+
+// The maximum size of the learned actions sent in response to a read
+// request (a response includes at least one action though).
+static const Bytes MAX_READ_RESPONSE_SIZE = Megabytes(4);
+
+
+// Provides a least-recently used (LRU) cache of actions, like
+// stout's cache but bounded by the total size of the actions rather
+// than their number (a single action can be arbitrarily big).
+class ActionCache
+{
+public:
+  explicit ActionCache(const Bytes& _capacity) : capacity(_capacity) {}
+
+  void put(const Action& action)
+  {
+    erase(action.position());
+
+    const Bytes bytes = Bytes(action.ByteSize());
+
+    // Don't let a single action evict everything else.
+    if (bytes > capacity) {
+      return;
+    }
+
+    while (size + bytes > capacity) {
+      erase(positions.front());
+    }
+
+    list<uint64_t>::iterator i =
+      positions.insert(positions.end(), action.position());
+
+    actions[action.position()] = std::make_pair(action, i);
+    size += bytes;
+  }
+
+  Option<Action> get(uint64_t position)
+  {
+    if (!actions.contains(position)) {
+      return None();
+    }
+
+    // Move the position to the end of the LRU list.
+    list<uint64_t>::iterator i = actions[position].second;
+    positions.splice(positions.end(), positions, i);
+
+    return actions[position].first;
+  }
+
+private:
+  void erase(uint64_t position)
+  {
+    if (actions.contains(position)) {
+      size -= Bytes(actions[position].first.ByteSize());
+      positions.erase(actions[position].second);
+      actions.erase(position);
+    }
+  }
+
+  const Bytes capacity;
+  Bytes size;
+
+  // Positions ordered by least-recently used.
+  list<uint64_t> positions;
+
+  // Cached actions and "pointers" into the LRU list.
+  hashmap<uint64_t, std::pair<Action, list<uint64_t>::iterator> > actions;
+};
+
+
 class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 {
 public:
@@ -101,28 +181,58 @@ public:
   // the disk. Returns true on success and false otherwise.
   bool update(const Metadata::Status& status);
 
+  // Persists the specified learned actions (e.g., read from another
+  // replica) right away. Returns true on success and false otherwise.
+  bool learn(const list<Action>& actions);
+
+protected:
+  virtual void finalize();
+
 private:
   // Handles a request from a proposer to promise not to accept writes
   // from any other proposer with lower proposal number.
-  void promise(const PromiseRequest& request);
+  void promise(const UPID& from, const PromiseRequest& request);
 
   // Handles a request from a proposer to write an action.
-  void write(const WriteRequest& request);
+  void write(const UPID& from, const WriteRequest& request);
 
   // Handles a request from a recover process.
-  void recover(const RecoverRequest& request);
+  void recover(const UPID& from, const RecoverRequest& request);
+
+  // Handles a request from a catching-up replica for the learned
+  // actions within a range of positions.
+  void read(const UPID& from, const ReadRequest& request);
 
   // Handles a message notifying of a learned action.
   void learned(const Action& action);
 
   // Helper routines that write a record corresponding to the
-  // specified argument. Returns true on success and false otherwise.
-  bool persist(const Action& action);
+  // specified argument. The record gets persisted on the disk with
+  // the next commit.
+  void persist(const Action& action);
 
   // Helper routines that update metadata corresponding to the
-  // specified argument. The update will be persisted on the disk.
-  // Returns true on success and false otherwise.
-  bool update(uint64_t promised);
+  // specified argument. The update gets persisted on the disk with
+  // the next commit.
+  void update(uint64_t promised);
+
+  // Sends the response once everything written so far is committed.
+  void respond(const UPID& to, const google::protobuf::Message& response);
+
+  // Starts a new batch (unless there is one already) for the records
+  // written until the next commit.
+  void prepare();
+
+  // Adds (or removes) the position to (or from) the holes or the
+  // unlearned positions, remembering whether it was there before the
+  // batch in case the commit fails.
+  void markHole(uint64_t position, bool add);
+  void markUnlearned(uint64_t position, bool add);
+
+  // Persists the records written since the last commit with a single
+  // synchronous write and sends the responses held back until then.
+  // Returns false if the records could not be persisted.
+  bool commit();
 
   // Helper routine to restore log (e.g., on restart).
   void restore(const string& path);
@@ -145,13 +255,47 @@ private:
 
   // Unlearned positions in the log.
   set<uint64_t> unlearned;
+
+  // The most recently learned (or read) actions as committed.
+  ActionCache cached;
+
+  struct Response
+  {
+    UPID to;
+    string name;
+    string data;
+  };
+
+  // The records written since the last commit, committed together
+  // once the requests that are already queued have been handled,
+  // i.e., requests that arrive while the replica is busy syncing
+  // the disk get committed together by the next sync. We keep the
+  // state as of the last commit in case the commit fails, for the
+  // holes and unlearned positions only that of the positions that
+  // the batch changed (i.e., whether they were holes or unlearned).
+  struct Batch
+  {
+    Option<Metadata> metadata;
+    map<uint64_t, Action> actions;
+    list<Response> responses;
+
+    Metadata committed;
+    uint64_t begin;
+    uint64_t end;
+    map<uint64_t, bool> holes;
+    map<uint64_t, bool> unlearned;
+  };
+
+  Batch* batch;
 };
 
 
 ReplicaProcess::ReplicaProcess(const string& path)
   : ProcessBase(ID::generate("log-replica")),
     begin(0),
-    end(0)
+    end(0),
+    cached(MAX_CACHED_ACTIONS_SIZE),
+    batch(NULL)
 {
   // TODO(benh): Factor out and expose storage.
   storage = new LevelDBStorage();
@@ -168,6 +312,9 @@ ReplicaProcess::ReplicaProcess(const string& path)
   install<RecoverRequest>(
       &ReplicaProcess::recover);
 
+  install<ReadRequest>(
+      &ReplicaProcess::read);
+
   install<LearnedMessage>(
       &ReplicaProcess::learned,
       &LearnedMessage::action);
@@ -176,10 +323,17 @@ ReplicaProcess::ReplicaProcess(const string& path)
 
 ReplicaProcess::~ReplicaProcess()
 {
+  delete batch;
   delete storage;
 }
 
 
+void ReplicaProcess::finalize()
+{
+  commit();
+}
+
+
 Result<Action> ReplicaProcess::read(uint64_t position)
 {
   if (position < begin) {
@@ -190,6 +344,18 @@ Result<Action> ReplicaProcess::read(uint64_t position)
     return None();
   }
 
+  // Might not have been committed yet ...
+  if (batch != NULL && batch->actions.count(position) > 0) {
+    return batch->actions[position];
+  }
+
+  // Might have been read or written recently ...
+  Option<Action> cached_ = cached.get(position);
+
+  if (cached_.isSome()) {
+    return cached_.get();
+  }
+
   // Must exist in storage ...
   Try<Action> action = storage->read(position);
 
@@ -199,6 +365,10 @@ Result<Action> ReplicaProcess::read(uint64_t position)
 
   CHECK_SOME(action);
 
+  if (action.get().has_learned() && action.get().learned()) {
+    cached.put(action.get());
+  }
+
   return action.get();
 }
 
@@ -221,21 +391,70 @@ Future<list<Action> > ReplicaProcess::read(uint64_t from, uint64_t to)
     return promise.future();
   }
 
-  list<Action> actions;
+  // Take what we have in memory and read the rest from storage, with
+  // a single read of the range of the positions not in memory.
+  map<uint64_t, Action> actions;
+  Option<uint64_t> first;
+  Option<uint64_t> last;
 
   for (uint64_t position = from; position <= to; position++) {
-    Result<Action> result = read(position);
+    if (holes.count(position) > 0) {
+      continue;
+    }
 
-    if (result.isError()) {
+    if (batch != NULL && batch->actions.count(position) > 0) {
+      actions[position] = batch->actions[position];
+      continue;
+    }
+
+    Option<Action> cached_ = cached.get(position);
+
+    if (cached_.isSome()) {
+      actions[position] = cached_.get();
+    } else {
+      first = first.isSome() ? first.get() : position;
+      last = position;
+    }
+  }
+
+  if (first.isSome()) {
+    Try<list<Action> > stored = storage->read(first.get(), last.get());
+
+    if (stored.isError()) {
       process::Promise<list<Action> > promise;
-      promise.fail(result.error());
+      promise.fail(stored.error());
       return promise.future();
-    } else if (result.isSome()) {
-      actions.push_back(result.get());
+    }
+
+    const list<Action> actions_ = stored.get();
+
+    foreach (const Action& action, actions_) {
+      // Those in memory are more recent.
+      if (holes.count(action.position()) == 0 &&
+          actions.count(action.position()) == 0) {
+        actions[action.position()] = action;
+
+        if (action.has_learned() && action.learned()) {
+          cached.put(action);
+        }
+      }
+    }
+
+    for (uint64_t position = first.get(); position <= last.get(); position++) {
+      if (holes.count(position) == 0 && actions.count(position) == 0) {
+        process::Promise<list<Action> > promise;
+        promise.fail("Missing position " + stringify(position) + " in storage");
+        return promise.future();
+      }
     }
   }
 
-  return actions;
+  list<Action> results;
+  foreachvalue (const Action& action, actions) {
+    results.push_back(action);
+  }
+
+  return results;
 }
 
 
@@ -307,8 +526,23 @@ uint64_t ReplicaProcess::promised()
 }
 
 
+bool ReplicaProcess::learn(const list<Action>& actions)
+{
+  foreach (const Action& action, actions) {
+    CHECK(action.has_learned() && action.learned());
+    persist(action);
+  }
+
+  return commit();
+}
+
+
 bool ReplicaProcess::update(const Metadata::Status& status)
 {
+  // Make sure a pending update of the promise doesn't overwrite the
+  // status later.
+  commit();
+
   Metadata metadata_;
   metadata_.set_status(status);
   metadata_.set_promised(promised());
@@ -329,25 +563,14 @@ bool ReplicaProcess::update(const Metadata::Status& status)
 }
 
 
-bool ReplicaProcess::update(uint64_t promised)
+void ReplicaProcess::update(uint64_t promised)
 {
-  Metadata metadata_;
-  metadata_.set_status(status());
-  metadata_.set_promised(promised);
-
-  Try<Nothing> persisted = storage->persist(metadata_);
-
-  if (persisted.isError()) {
-    LOG(ERROR) << "Error writing to log: " << persisted.error();
-    return false;
-  }
-
-  LOG(INFO) << "Persisted promised to " << promised;
+  prepare();
 
   // Update the cached metadata.
   metadata.set_promised(promised);
 
-  return true;
+  batch->metadata = metadata;
 }
 
 
@@ -365,7 +588,7 @@ bool ReplicaProcess::update(uint64_t promised)
 // procedure.
 
 
-void ReplicaProcess::promise(const PromiseRequest& request)
+void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
 {
   // Ignore promise requests if this replica is not in VOTING status.
   if (status() != Metadata::VOTING) {
@@ -404,7 +627,7 @@ void ReplicaProcess::promise(const PromiseRequest& request)
       response.set_okay(true);
       response.set_proposal(request.proposal());
       response.mutable_action()->MergeFrom(action);
-      reply(response);
+      respond(from, response);
       return;
     }
 
@@ -436,19 +659,19 @@ void ReplicaProcess::promise(const PromiseRequest& request)
         PromiseResponse response;
         response.set_okay(false);
         response.set_proposal(promised());
-        reply(response);
+        respond(from, response);
       } else {
         Action action;
         action.set_position(request.position());
         action.set_promised(request.proposal());
 
-        if (persist(action)) {
-          PromiseResponse response;
-          response.set_okay(true);
-          response.set_proposal(request.proposal());
-          response.set_position(request.position());
-          reply(response);
-        }
+        persist(action);
+
+        PromiseResponse response;
+        response.set_okay(true);
+        response.set_proposal(request.proposal());
+        response.set_position(request.position());
+        respond(from, response);
       }
     } else {
       CHECK_SOME(result);
@@ -459,18 +682,18 @@ void ReplicaProcess::promise(const PromiseRequest& request)
         PromiseResponse response;
         response.set_okay(false);
         response.set_proposal(action.promised());
-        reply(response);
+        respond(from, response);
       } else {
         Action original = action;
         action.set_promised(request.proposal());
 
-        if (persist(action)) {
-          PromiseResponse response;
-          response.set_okay(true);
-          response.set_proposal(request.proposal());
-          response.mutable_action()->MergeFrom(original);
-          reply(response);
-        }
+        persist(action);
+
+        PromiseResponse response;
+        response.set_okay(true);
+        response.set_proposal(request.proposal());
+        response.mutable_action()->MergeFrom(original);
+        respond(from, response);
       }
     }
   } else {
@@ -484,22 +707,22 @@ void ReplicaProcess::promise(const PromiseRequest& request)
       PromiseResponse response;
       response.set_okay(false);
       response.set_proposal(promised());
-      reply(response);
+      respond(from, response);
     } else {
-      if (update(request.proposal())) {
-        // Return the last position written.
-        PromiseResponse response;
-        response.set_okay(true);
-        response.set_proposal(request.proposal());
-        response.set_position(end);
-        reply(response);
-      }
+      update(request.proposal());
+
+      // Return the last position written.
+      PromiseResponse response;
+      response.set_okay(true);
+      response.set_proposal(request.proposal());
+      response.set_position(end);
+      respond(from, response);
     }
   }
 }
 
 
-void ReplicaProcess::write(const WriteRequest& request)
+void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
 {
   // Ignore write requests if this replica is not in VOTING status.
   if (status() != Metadata::VOTING) {
@@ -522,7 +745,7 @@ void ReplicaProcess::write(const WriteRequest& request)
       response.set_okay(false);
       response.set_proposal(promised());
       response.set_position(request.position());
-      reply(response);
+      respond(from, response);
     } else {
       Action action;
       action.set_position(request.position());
@@ -548,13 +771,13 @@ void ReplicaProcess::write(const WriteRequest& request)
           LOG(FATAL) << "Unknown Action::Type!";
       }
 
-      if (persist(action)) {
-        WriteResponse response;
-        response.set_okay(true);
-        response.set_proposal(request.proposal());
-        response.set_position(request.position());
-        reply(response);
-      }
+      persist(action);
+
+      WriteResponse response;
+      response.set_okay(true);
+      response.set_proposal(request.proposal());
+      response.set_position(request.position());
+      respond(from, response);
     }
   } else if (result.isSome()) {
     Action action = result.get();
@@ -565,7 +788,7 @@ void ReplicaProcess::write(const WriteRequest& request)
       response.set_okay(false);
       response.set_proposal(action.promised());
       response.set_position(request.position());
-      reply(response);
+      respond(from, response);
     } else {
       // TODO(benh): Check if this position has already been learned,
       // and if so, check that we are re-writing the same value!
@@ -612,19 +835,19 @@ void ReplicaProcess::write(const WriteRequest& request)
           LOG(FATAL) << "Unknown Action::Type!";
       }
 
-      if (persist(action)) {
-        WriteResponse response;
-        response.set_okay(true);
-        response.set_proposal(request.proposal());
-        response.set_position(request.position());
-        reply(response);
-      }
+      persist(action);
+
+      WriteResponse response;
+      response.set_okay(true);
+      response.set_proposal(request.proposal());
+      response.set_position(request.position());
+      respond(from, response);
     }
   }
 }
 
 
-void ReplicaProcess::recover(const RecoverRequest& request)
+void ReplicaProcess::recover(const UPID& from, const RecoverRequest& request)
 {
   LOG(INFO) << "Replica in " << status()
             << " status received a broadcasted recover request";
@@ -637,7 +860,65 @@ void ReplicaProcess::recover(const RecoverRequest& request)
     response.set_end(end);
   }
 
-  reply(response);
+  respond(from, response);
+}
+
+
+void ReplicaProcess::read(const UPID& from, const ReadRequest& request)
+{
+  ReadResponse response;
+
+  // Only VOTING replicas know which of their actions are learned
+  // (e.g., a RECOVERING replica might still be catching up itself).
+  if (status() != Metadata::VOTING) {
+    LOG(INFO) << "Replica in " << status()
+              << " status ignoring read request for positions "
+              << request.from() << " -> " << request.to();
+
+    response.set_okay(false);
+    respond(from, response);
+    return;
+  }
+
+  // Skip the positions that have been truncated or not written yet.
+  const uint64_t from_ = std::max(request.from(), begin);
+  const uint64_t to = std::min(request.to(), end);
+
+  if (from_ <= to) {
+    Future<list<Action> > actions = read(from_, to);
+
+    if (!actions.isReady()) {
+      LOG(ERROR) << "Error getting log records at " << from_ << " -> " << to
+                 << ": " << (actions.isFailed() ? actions.failure() : "");
+      return;
+    }
+
+    const list<Action> actions_ = actions.get();
+
+    Bytes size;
+    foreach (const Action& action, actions_) {
+      if (!action.has_learned() || !action.learned()) {
+        continue;
+      }
+
+      size += Bytes(action.ByteSize());
+
+      if (size > MAX_READ_RESPONSE_SIZE && response.actions_size() > 0) {
+        // Let the reader ask for the remaining positions again.
+        response.set_last(action.position() - 1);
+        break;
+      }
+
+      response.add_actions()->CopyFrom(action);
+    }
+  }
+
+  LOG(INFO) << "Replica sending " << response.actions_size()
+            << " learned actions for positions "
+            << request.from() << " -> " << request.to();
+
+  response.set_okay(true);
+  respond(from, response);
 }
 
 
@@ -648,45 +929,37 @@ void ReplicaProcess::learned(const Action& action)
 
   CHECK(action.learned());
 
-  if (persist(action)) {
-    LOG(INFO) << "Replica learned " << action.type()
-              << " action at position " << action.position();
-  }
+  persist(action);
+
+  LOG(INFO) << "Replica learned " << action.type()
+            << " action at position " << action.position();
 }
 
 
-bool ReplicaProcess::persist(const Action& action)
+void ReplicaProcess::persist(const Action& action)
 {
-  Try<Nothing> persisted = storage->persist(action);
+  prepare();
 
-  if (persisted.isError()) {
-    LOG(ERROR) << "Error writing to log: " << persisted.error();
-    return false;
-  }
-
-  LOG(INFO) << "Persisted action at " << action.position();
+  batch->actions[action.position()] = action;
 
   // No longer a hole here (if there even was one).
-  holes.erase(action.position());
+  markHole(action.position(), false);
 
   // Update unlearned positions and deal with truncation actions.
   if (action.has_learned() && action.learned()) {
-    unlearned.erase(action.position());
+    markUnlearned(action.position(), false);
     if (action.has_type() && action.type() == Action::TRUNCATE) {
       // No longer consider truncated positions as holes (so that a
       // coordinator doesn't try and fill them).
-      foreach (uint64_t position, utils::copy(holes)) {
-        if (position < action.truncate().to()) {
-          holes.erase(position);
-        }
+      while (!holes.empty() && *holes.begin() < action.truncate().to()) {
+        markHole(*holes.begin(), false);
       }
 
       // No longer consider truncated positions as unlearned (so that
       // a coordinator doesn't try and fill them).
-      foreach (uint64_t position, utils::copy(unlearned)) {
-        if (position < action.truncate().to()) {
-          unlearned.erase(position);
-        }
+      while (!unlearned.empty() &&
+             *unlearned.begin() < action.truncate().to()) {
+        markUnlearned(*unlearned.begin(), false);
       }
 
       // And update the beginning position.
@@ -694,18 +967,149 @@ bool ReplicaProcess::persist(const Action& action)
     }
   } else {
     // We just introduced an unlearned position.
-    unlearned.insert(action.position());
+    markUnlearned(action.position(), true);
   }
 
   // Update holes if we just wrote many positions past the last end.
   for (uint64_t position = end + 1; position < action.position(); position++) {
-    holes.insert(position);
+    markHole(position, true);
   }
 
   // And update the end position.
   end = std::max(end, action.position());
+}
 
-  return true;
+
+void ReplicaProcess::respond(
+    const UPID& to,
+    const google::protobuf::Message& response)
+{
+  if (batch == NULL) {
+    send(to, response);
+    return;
+  }
+
+  Response response_;
+  response_.to = to;
+  response_.name = response.GetTypeName();
+  response.SerializeToString(&response_.data);
+
+  batch->responses.push_back(response_);
+}
+
+
+void ReplicaProcess::prepare()
+{
+  if (batch != NULL) {
+    return;
+  }
+
+  batch = new Batch();
+  batch->committed = metadata;
+  batch->begin = begin;
+  batch->end = end;
+
+  // Commit after the requests that are already queued.
+  dispatch(self(), &ReplicaProcess::commit);
+}
+
+
+void ReplicaProcess::markHole(uint64_t position, bool add)
+{
+  CHECK_NOTNULL(batch);
+
+  bool was = holes.count(position) > 0;
+  if (was != add) {
+    batch->holes.insert(std::make_pair(position, was));
+    if (add) {
+      holes.insert(position);
+    } else {
+      holes.erase(position);
+    }
+  }
+}
+
+
+void ReplicaProcess::markUnlearned(uint64_t position, bool add)
+{
+  CHECK_NOTNULL(batch);
+
+  bool was = unlearned.count(position) > 0;
+  if (was != add) {
+    batch->unlearned.insert(std::make_pair(position, was));
+    if (add) {
+      unlearned.insert(position);
+    } else {
+      unlearned.erase(position);
+    }
+  }
+}
+
+
+bool ReplicaProcess::commit()
+{
+  if (batch == NULL) {
+    return true;
+  }
+
+  list<Action> actions;
+  foreachvalue (const Action& action, batch->actions) {
+    actions.push_back(action);
+  }
+
+  Try<Nothing> persisted = storage->persist(batch->metadata, actions);
+
+  if (persisted.isError()) {
+    LOG(ERROR) << "Error writing to log: " << persisted.error();
+
+    // Pretend like none of the requests since the last commit made it
+    // here (see above) by not responding and restoring the state.
+    metadata = batch->committed;
+    begin = batch->begin;
+    end = batch->end;
+
+    foreachpair (uint64_t position, bool was, batch->holes) {
+      if (was) {
+        holes.insert(position);
+      } else {
+        holes.erase(position);
+      }
+    }
+
+    foreachpair (uint64_t position, bool was, batch->unlearned) {
+      if (was) {
+        unlearned.insert(position);
+      } else {
+        unlearned.erase(position);
+      }
+    }
+  } else {
+    // Keep the learned actions in memory (and update the ones that
+    // are already there).
+    foreach (const Action& action, actions) {
+      if ((action.has_learned() && action.learned()) ||
+          cached.get(action.position()).isSome()) {
+        cached.put(action);
+      }
+    }
+
+    LOG(INFO) << "Persisted " << actions.size() << " action(s)"
+              << (batch->metadata.isSome()
+                  ? " and promised " + stringify(metadata.promised())
+                  : "");
+
+    foreach (const Response& response, batch->responses) {
+      send(response.to,
+           response.name,
+           response.data.data(),
+           response.data.size());
+    }
+  }
+
+  delete batch;
+  batch = NULL;
+
+  return persisted.isSome();
 }
 
 
@@ -724,16 +1128,22 @@ void ReplicaProcess::restore(const string& path)
   // Only use the learned positions to help determine the holes.
   const set<uint64_t>& learned = state.get().learned;
 
+  // Positions before the snapshot are all learned.
+  const uint64_t snapshot = state.get().snapshot;
+
   // We need to assume that position 0 is a hole for a brand new log
   // (a coordinator will simply fill it with a no-op when it first
   // gets elected), unless the position was found during recovery or
   // it has been truncated.
-  if (learned.count(0) == 0 && unlearned.count(0) == 0 && begin == 0) {
+  if (learned.count(0) == 0 && unlearned.count(0) == 0 &&
+      begin == 0 && snapshot == 0) {
     holes.insert(0);
   }
 
   // Now determine the rest of the holes.
-  for (uint64_t position = begin; position < end; position++) {
+  for (uint64_t position = std::max(begin, snapshot);
+       position < end;
+       position++) {
     if (learned.count(position) == 0 && unlearned.count(position) == 0) {
       holes.insert(position);
     }
@@ -763,7 +1173,11 @@ Replica::~Replica()
 
 Future<list<Action> > Replica::read(uint64_t from, uint64_t to) const
 {
-  return dispatch(process, &ReplicaProcess::read, from, to);
+  // Need to disambiguate overloaded function.
+  Future<list<Action> > (ReplicaProcess::*read)(uint64_t from, uint64_t to) =
+    &ReplicaProcess::read;
+
+  return dispatch(process, read, from, to);
 }
 
 
@@ -813,6 +1227,12 @@ Future<bool> Replica::update(const Metadata::Status& status)
 }
 
 
+Future<bool> Replica::learn(const list<Action>& actions) const
+{
+  return dispatch(process, &ReplicaProcess::learn, actions);
+}
+
+
 PID<ReplicaProcess> Replica::pid() const
 {
   return process->self();
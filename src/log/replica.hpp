@@ -41,6 +41,7 @@ namespace protocol {
 extern Protocol<PromiseRequest, PromiseResponse> promise;
 extern Protocol<WriteRequest, WriteResponse> write;
 extern Protocol<RecoverRequest, RecoverResponse> recover;
+extern Protocol<ReadRequest, ReadResponse> read;
 
 } // namespace protocol {
 
@@ -92,6 +93,11 @@ public:
   // Updates the status of this replica.
   process::Future<bool> update(const Metadata::Status& status);
 
+  // Persists the specified learned actions, e.g., read from another
+  // replica while catching up. Like a learned message from the
+  // network this is allowed on a shared (i.e., const) replica.
+  process::Future<bool> learn(const std::list<Action>& actions) const;
+
   // Returns the PID associated with this replica.
   process::PID<ReplicaProcess> pid() const;
 
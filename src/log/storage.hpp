@@ -21,10 +21,12 @@
 
 #include <stdint.h>
 
+#include <list>
 #include <set>
 #include <string>
 
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
 #include "messages/log.hpp"
@@ -42,7 +44,9 @@ public:
     Metadata metadata; // The metadata for the replica.
     uint64_t begin; // Beginning position of the log.
     uint64_t end; // Ending position of the log.
+    uint64_t snapshot; // Positions in [begin, snapshot) are learned.
     std::set<uint64_t> learned; // Positions present and learned
+                                // (from 'snapshot' onwards).
     std::set<uint64_t> unlearned; // Positions present but unlearned.
   };
 
@@ -51,7 +55,17 @@ public:
   virtual Try<State> restore(const std::string& path) = 0;
   virtual Try<Nothing> persist(const Metadata& metadata) = 0;
   virtual Try<Nothing> persist(const Action& action) = 0;
+
+  // Persists the metadata (if any) and the actions at once, i.e.,
+  // with a single synchronous write.
+  virtual Try<Nothing> persist(
+      const Option<Metadata>& metadata,
+      const std::list<Action>& actions) = 0;
   virtual Try<Action> read(uint64_t position) = 0;
+
+  // Returns the actions stored within [from, to] in order, i.e., the
+  // positions that have not been written are skipped.
+  virtual Try<std::list<Action> > read(uint64_t from, uint64_t to) = 0;
 };
 
 } // namespace log {
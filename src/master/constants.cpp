@@ -29,8 +29,13 @@ const double MIN_CPUS = 0.1;
 const Bytes MIN_MEM = Megabytes(32);
 const Duration SLAVE_PING_TIMEOUT = Seconds(15);
 const uint32_t MAX_SLAVE_PING_TIMEOUTS = 5;
+const Duration SLAVE_PING_BATCH_INTERVAL = Milliseconds(100);
 const uint32_t MAX_COMPLETED_FRAMEWORKS = 50;
 const uint32_t MAX_COMPLETED_TASKS_PER_FRAMEWORK = 1000;
+const uint32_t MAX_REMOVED_SLAVES = 1000;
+const uint32_t MAX_REGISTRY_CHANGES = 100;
+const uint32_t MAX_REREGISTRATIONS_PER_SLICE = 100;
+const uint32_t MAX_CONCURRENT_AUTHENTICATIONS = 64;
 const Duration WHITELIST_WATCH_INTERVAL = Seconds(5);
 const uint32_t TASK_LIMIT = 100;
 
@@ -51,6 +51,10 @@ extern const Duration SLAVE_PING_TIMEOUT;
 // Maximum number of ping timeouts until slave is considered failed.
 extern const uint32_t MAX_SLAVE_PING_TIMEOUTS;
 
+// Slaves whose pings are due within this interval of each other are
+// pinged together.
+extern const Duration SLAVE_PING_BATCH_INTERVAL;
+
 // Maximum number of completed frameworks to store in the cache.
 // TODO(thomasm): Make configurable.
 extern const uint32_t MAX_COMPLETED_FRAMEWORKS;
@@ -59,6 +63,22 @@ extern const uint32_t MAX_COMPLETED_FRAMEWORKS;
 // cache.  TODO(thomasm): Make configurable.
 extern const uint32_t MAX_COMPLETED_TASKS_PER_FRAMEWORK;
 
+// Maximum number of removed slaves to remember for computing the
+// deltas served by '/master/state-diff.json'.
+extern const uint32_t MAX_REMOVED_SLAVES;
+
+// Maximum number of changes to the registry that the registrar keeps
+// before it stores all of the slaves again.
+extern const uint32_t MAX_REGISTRY_CHANGES;
+
+// Maximum number of slaves that re-registered after a failover that
+// the master re-adds before handling other events.
+extern const uint32_t MAX_REREGISTRATIONS_PER_SLICE;
+
+// Maximum number of frameworks that get authenticated at the same
+// time, further authentications are queued.
+extern const uint32_t MAX_CONCURRENT_AUTHENTICATIONS;
+
 // Time interval to check for updated watchers list.
 extern const Duration WHITELIST_WATCH_INTERVAL;
 
@@ -81,11 +81,17 @@ private:
   void detected(const Future<Option<Group::Membership> >& leader);
 
   // Invoked when we have fetched the data associated with the leader.
-  void fetched(const Future<string>& data);
+  void fetched(
+      const Group::Membership& membership,
+      const Future<string>& data);
 
   Owned<Group> group;
   LeaderDetector detector;
 
+  // The membership of the leading Master, whose data might still be
+  // getting fetched.
+  Option<Group::Membership> membership;
+
   // The leading Master.
   Option<UPID> leader;
   set<Promise<Option<UPID> >*> promises;
@@ -283,6 +289,8 @@ void ZooKeeperMasterDetectorProcess::detected(
     return;
   }
 
+  membership = _leader.get();
+
   if (_leader.get().isNone()) {
     leader = None();
 
@@ -294,7 +302,7 @@ void ZooKeeperMasterDetectorProcess::detected(
   } else {
     // Fetch the data associated with the leader.
     group->data(_leader.get().get())
-      .onAny(defer(self(), &Self::fetched, lambda::_1));
+      .onAny(defer(self(), &Self::fetched, _leader.get().get(), lambda::_1));
   }
 
   // Keep trying to detect leadership changes.
@@ -303,10 +311,19 @@ void ZooKeeperMasterDetectorProcess::detected(
 }
 
 
-void ZooKeeperMasterDetectorProcess::fetched(const Future<string>& data)
+void ZooKeeperMasterDetectorProcess::fetched(
+    const Group::Membership& _membership,
+    const Future<string>& data)
 {
   CHECK(!data.isDiscarded());
 
+  // A newer leader might have been detected while the data was being
+  // fetched (e.g., when leadership changes several times in a row),
+  // in which case we must not overwrite it with a former leader.
+  if (membership != _membership) {
+    return;
+  }
+
   if (data.isFailed()) {
     leader = None();
     foreach (Promise<Option<UPID> >* promise, promises) {
@@ -22,6 +22,7 @@
 #include <mesos/resources.hpp>
 
 #include <process/delay.hpp>
+#include <process/dispatch.hpp>
 #include <process/id.hpp>
 #include <process/timeout.hpp>
 
@@ -183,12 +184,25 @@ protected:
   // Allocate any allocatable resources.
   void allocate();
 
+  // Allocate any allocatable resources once the events already
+  // queued for this process have been handled, so that a burst of
+  // (re-)registering frameworks results in a single allocation.
+  void scheduleAllocation();
+  void _allocate();
+
   // Allocate resources just from the specified slave.
   void allocate(const SlaveID& slaveId);
 
   // Allocate resources from the specified slaves.
   void allocate(const hashset<SlaveID>& slaveIds);
 
+  // Sends the resources allocated to a framework to the master as
+  // offers. Virtual so that the allocator can be driven without a
+  // running master (e.g., from the allocator benchmarks).
+  virtual void offer(
+      const FrameworkID& frameworkId,
+      const hashmap<SlaveID, Resources>& resources);
+
   // Remove a filter for the specified framework.
   void expire(const FrameworkID& frameworkId, Filter* filter);
 
@@ -206,6 +220,9 @@ protected:
 
   bool initialized;
 
+  // Whether an allocation has been scheduled (see scheduleAllocation).
+  bool allocationPending;
+
   Flags flags;
   PID<Master> master;
 
@@ -264,7 +281,8 @@ public:
 template <class RoleSorter, class FrameworkSorter>
 HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::HierarchicalAllocatorProcess()
   : ProcessBase(ID::generate("hierarchical-allocator")),
-    initialized(false) {}
+    initialized(false),
+    allocationPending(false) {}
 
 
 template <class RoleSorter, class FrameworkSorter>
@@ -331,7 +349,7 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::frameworkAdded(
 
   LOG(INFO) << "Added framework " << frameworkId;
 
-  allocate();
+  scheduleAllocation();
 }
 
 
@@ -377,7 +395,7 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::frameworkActivated(
 
   LOG(INFO) << "Activated framework " << frameworkId;
 
-  allocate();
+  scheduleAllocation();
 }
 
 
@@ -690,6 +708,27 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::allocate()
 }
 
 
+template <class RoleSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::scheduleAllocation()
+{
+  if (!allocationPending) {
+    allocationPending = true;
+    dispatch(self(), &Self::_allocate);
+  }
+}
+
+
+template <class RoleSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::_allocate()
+{
+  CHECK(allocationPending);
+  allocationPending = false;
+  allocate();
+}
+
+
 template <class RoleSorter, class FrameworkSorter>
 void
 HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::allocate(
@@ -769,13 +808,23 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::allocate(
         sorters[role]->allocated(frameworkIdValue, allocatedResources);
         roleSorter->allocated(role, allocatedResources);
 
-        dispatch(master, &Master::offer, frameworkId, offerable);
+        offer(frameworkId, offerable);
       }
     }
   }
 }
 
 
+template <class RoleSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::offer(
+    const FrameworkID& frameworkId,
+    const hashmap<SlaveID, Resources>& resources)
+{
+  dispatch(master, &Master::offer, frameworkId, resources);
+}
+
+
 template <class RoleSorter, class FrameworkSorter>
 void
 HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::expire(
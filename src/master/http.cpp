@@ -20,6 +20,7 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <mesos/mesos.hpp>
@@ -28,6 +29,7 @@
 #include <process/help.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
 #include <stout/json.hpp>
 #include <stout/memory.hpp>
 #include <stout/net.hpp>
@@ -38,6 +40,7 @@
 
 #include "common/attributes.hpp"
 #include "common/build.hpp"
+#include "common/http.hpp"
 #include "common/type_utils.hpp"
 #include "common/protobuf_utils.hpp"
 
@@ -123,143 +126,186 @@ JSON::Object model(const Attributes& attributes)
 }
 
 
-// Returns a JSON object modeled on a TaskStatus.
-JSON::Object model(const TaskStatus& status)
+// Writes a JSON object modeled on a TaskStatus.
+void json(JSON::Writer* writer, const TaskStatus& status)
 {
-  JSON::Object object;
-  object.values["state"] = TaskState_Name(status.state());
-  object.values["timestamp"] = status.timestamp();
-
-  return object;
+  writer->beginObject();
+  writer->field("state", TaskState_Name(status.state()));
+  writer->field("timestamp", status.timestamp());
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled on a Task.
+// Writes a JSON object modeled on a Task.
 // TODO(bmahler): Expose the executor name / source.
-JSON::Object model(const Task& task)
+void json(JSON::Writer* writer, const Task& task)
 {
-  JSON::Object object;
-  object.values["id"] = task.task_id().value();
-  object.values["name"] = task.name();
-  object.values["framework_id"] = task.framework_id().value();
-  object.values["executor_id"] = task.executor_id().value();
-  object.values["slave_id"] = task.slave_id().value();
-  object.values["state"] = TaskState_Name(task.state());
-  object.values["resources"] = model(task.resources());
-
-  JSON::Array array;
+  writer->beginObject();
+  writer->field("id", task.task_id().value());
+  writer->field("name", task.name());
+  writer->field("framework_id", task.framework_id().value());
+  writer->field("executor_id", task.executor_id().value());
+  writer->field("slave_id", task.slave_id().value());
+  writer->field("state", TaskState_Name(task.state()));
+  writer->field("resources", model(task.resources()));
+
+  writer->key("statuses");
+  writer->beginArray();
   foreach (const TaskStatus& status, task.statuses()) {
-    array.values.push_back(model(status));
+    json(writer, status);
   }
-  object.values["statuses"] = array;
+  writer->endArray();
 
-  return object;
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled on an Offer.
-JSON::Object model(const Offer& offer)
+// Writes a JSON object modeled on an Offer.
+void json(JSON::Writer* writer, const Offer& offer)
 {
-  JSON::Object object;
-  object.values["id"] = offer.id().value();
-  object.values["framework_id"] = offer.framework_id().value();
-  object.values["slave_id"] = offer.slave_id().value();
-  object.values["resources"] = model(offer.resources());
-  return object;
+  writer->beginObject();
+  writer->field("id", offer.id().value());
+  writer->field("framework_id", offer.framework_id().value());
+  writer->field("slave_id", offer.slave_id().value());
+  writer->field("resources", model(offer.resources()));
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled on a Framework.
-JSON::Object model(const Framework& framework)
+// Writes the fields of the JSON model of a Framework that do not
+// depend on its offers.
+void fields(JSON::Writer* writer, const Framework& framework)
 {
-  JSON::Object object;
-  object.values["id"] = framework.id.value();
-  object.values["name"] = framework.info.name();
-  object.values["user"] = framework.info.user();
-  object.values["failover_timeout"] = framework.info.failover_timeout();
-  object.values["checkpoint"] = framework.info.checkpoint();
-  object.values["role"] = framework.info.role();
-  object.values["registered_time"] = framework.registeredTime.secs();
-  object.values["unregistered_time"] = framework.unregisteredTime.secs();
-  object.values["active"] = framework.active;
-  object.values["resources"] = model(framework.resources);
+  writer->field("id", framework.id.value());
+  writer->field("name", framework.info.name());
+  writer->field("user", framework.info.user());
+  writer->field("failover_timeout", framework.info.failover_timeout());
+  writer->field("checkpoint", framework.info.checkpoint());
+  writer->field("role", framework.info.role());
+  writer->field("registered_time", framework.registeredTime.secs());
+  writer->field("unregistered_time", framework.unregisteredTime.secs());
+  writer->field("active", framework.active);
 
   // TODO(benh): Consider making reregisteredTime an Option.
   if (framework.registeredTime != framework.reregisteredTime) {
-    object.values["reregistered_time"] = framework.reregisteredTime.secs();
+    writer->field("reregistered_time", framework.reregisteredTime.secs());
   }
 
   // Model all of the tasks associated with a framework.
-  {
-    JSON::Array array;
-    foreachvalue (Task* task, framework.tasks) {
-      array.values.push_back(model(*task));
-    }
-
-    object.values["tasks"] = array;
+  writer->key("tasks");
+  writer->beginArray();
+  foreachvalue (Task* task, framework.tasks) {
+    json(writer, *task);
   }
+  writer->endArray();
 
   // Model all of the completed tasks of a framework.
-  {
-    JSON::Array array;
-    foreach (const memory::shared_ptr<Task>& task, framework.completedTasks) {
-      array.values.push_back(model(*task));
-    }
-
-    object.values["completed_tasks"] = array;
+  writer->key("completed_tasks");
+  writer->beginArray();
+  foreach (const memory::shared_ptr<Task>& task, framework.completedTasks) {
+    json(writer, *task);
   }
+  writer->endArray();
+}
 
-  // Model all of the offers associated with a framework.
-  {
-    JSON::Array array;
-    foreach (Offer* offer, framework.offers) {
-      array.values.push_back(model(*offer));
-    }
 
-    object.values["offers"] = array;
+// Writes the fields of the JSON model of a Framework that depend on
+// its offers (the resources of a framework include its offers).
+void offerFields(JSON::Writer* writer, const Framework& framework)
+{
+  writer->field("resources", model(framework.resources));
+  writer->field("offered_resources", model(framework.resourcesOffered));
+
+  // Model all of the offers associated with a framework.
+  writer->key("offers");
+  writer->beginArray();
+  foreach (Offer* offer, framework.offers) {
+    json(writer, *offer);
   }
+  writer->endArray();
+}
 
-  return object;
+
+// Writes a JSON object modeled on a Framework.
+void json(JSON::Writer* writer, const Framework& framework)
+{
+  writer->beginObject();
+  fields(writer, framework);
+  offerFields(writer, framework);
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled after a Slave.
-JSON::Object model(const Slave& slave)
+// Writes the fields of the JSON model of a Slave that do not depend
+// on its offers.
+void fields(JSON::Writer* writer, const Slave& slave)
 {
-  JSON::Object object;
-  object.values["id"] = slave.id.value();
-  object.values["pid"] = string(slave.pid);
-  object.values["hostname"] = slave.info.hostname();
-  object.values["registered_time"] = slave.registeredTime.secs();
+  writer->field("id", slave.id.value());
+  writer->field("pid", string(slave.pid));
+  writer->field("hostname", slave.info.hostname());
+  writer->field("registered_time", slave.registeredTime.secs());
 
   if (slave.reregisteredTime.isSome()) {
-    object.values["reregistered_time"] = slave.reregisteredTime.get().secs();
+    writer->field("reregistered_time", slave.reregisteredTime.get().secs());
   }
 
-  object.values["resources"] = model(slave.info.resources());
-  object.values["attributes"] = model(slave.info.attributes());
-  return object;
+  writer->field("resources", model(slave.info.resources()));
+  writer->field("attributes", model(slave.info.attributes()));
 }
 
-// Returns a JSON object modeled after a Role.
-JSON::Object model(const Role& role)
-{
-  JSON::Object object;
-  object.values["name"] = role.info.name();
-  object.values["weight"] = role.info.weight();
-  object.values["resources"] = model(role.resources());
 
-  {
-    JSON::Array array;
+// Writes the fields of the JSON model of a Slave that depend on its
+// offers.
+void offerFields(JSON::Writer* writer, const Slave& slave)
+{
+  writer->field("offered_resources", model(slave.resourcesOffered));
+}
 
-    foreachkey (const FrameworkID& frameworkId, role.frameworks) {
-      array.values.push_back(frameworkId.value());
-    }
 
-    object.values["frameworks"] = array;
+// Writes a JSON object modeled after a Role.
+void json(JSON::Writer* writer, const Role& role)
+{
+  writer->beginObject();
+  writer->field("name", role.info.name());
+  writer->field("weight", role.info.weight());
+  writer->field("resources", model(role.resources()));
+
+  writer->key("frameworks");
+  writer->beginArray();
+  foreachkey (const FrameworkID& frameworkId, role.frameworks) {
+    writer->value(frameworkId.value());
   }
+  writer->endArray();
 
-  return object;
+  writer->endObject();
+}
+
+
+// Returns the rendered JSON model of 't'.
+template <typename T>
+string render(const T& t)
+{
+  std::ostringstream out;
+  JSON::Writer writer(&out);
+  json(&writer, t);
+  return out.str();
+}
+
+
+// Returns the fields written by 'write' for 't', rendered without the
+// enclosing braces so that they can be combined with other rendered
+// fields into one object (see Master::Http::Model::write).
+template <typename T>
+string render(void (*write)(JSON::Writer*, const T&), const T& t)
+{
+  std::ostringstream out;
+  JSON::Writer writer(&out);
+  writer.beginObject();
+  write(&writer, t);
+  writer.endObject();
+
+  const string rendered = out.str();
+  return rendered.substr(1, rendered.size() - 2);
 }
 
 
@@ -376,90 +422,316 @@ Future<Response> Master::Http::state(const Request& request)
 {
   LOG(INFO) << "HTTP request for '" << request.path << "'";
 
-  JSON::Object object;
-  object.values["version"] = MESOS_VERSION;
+  // Only re-render the state if it changed since the last request.
+  if (cache->state.isSome() && cache->version == master.version) {
+    return internal::http::json(
+        cache->state.get(), request.query.get("jsonp"));
+  }
+
+  update();
+
+  std::ostringstream out;
+  JSON::Writer writer(&out);
+
+  writer.beginObject();
+  writer.field("version", MESOS_VERSION);
 
   if (build::GIT_SHA.isSome()) {
-    object.values["git_sha"] = build::GIT_SHA.get();
+    writer.field("git_sha", build::GIT_SHA.get());
   }
 
   if (build::GIT_BRANCH.isSome()) {
-    object.values["git_branch"] = build::GIT_BRANCH.get();
+    writer.field("git_branch", build::GIT_BRANCH.get());
   }
 
   if (build::GIT_TAG.isSome()) {
-    object.values["git_tag"] = build::GIT_TAG.get();
+    writer.field("git_tag", build::GIT_TAG.get());
   }
 
-  object.values["build_date"] = build::DATE;
-  object.values["build_time"] = build::TIME;
-  object.values["build_user"] = build::USER;
-  object.values["start_time"] = master.startTime.secs();
-  object.values["id"] = master.info.id();
-  object.values["pid"] = string(master.self());
-  object.values["activated_slaves"] = master.slaves.size();
-  object.values["deactivated_slaves"] = master.deactivatedSlaves.size();
-  object.values["staged_tasks"] = master.stats.tasks[TASK_STAGING];
-  object.values["started_tasks"] = master.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = master.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = master.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = master.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = master.stats.tasks[TASK_LOST];
+  writer.field("build_date", build::DATE);
+  writer.field("build_time", build::TIME);
+  writer.field("build_user", build::USER);
+  writer.field("start_time", master.startTime.secs());
+  writer.field("id", master.info.id());
+  writer.field("pid", string(master.self()));
+  writer.field("activated_slaves", master.slaves.size());
+  writer.field("deactivated_slaves", master.deactivatedSlaves.size());
+  writer.field("staged_tasks", master.stats.tasks[TASK_STAGING]);
+  writer.field("started_tasks", master.stats.tasks[TASK_STARTING]);
+  writer.field("finished_tasks", master.stats.tasks[TASK_FINISHED]);
+  writer.field("killed_tasks", master.stats.tasks[TASK_KILLED]);
+  writer.field("failed_tasks", master.stats.tasks[TASK_FAILED]);
+  writer.field("lost_tasks", master.stats.tasks[TASK_LOST]);
 
   if (master.flags.cluster.isSome()) {
-    object.values["cluster"] = master.flags.cluster.get();
+    writer.field("cluster", master.flags.cluster.get());
   }
 
   if (master.leader.isSome()) {
-    object.values["leader"] = string(master.leader.get());
+    writer.field("leader", string(master.leader.get()));
   }
 
   if (master.flags.log_dir.isSome()) {
-    object.values["log_dir"] = master.flags.log_dir.get();
+    writer.field("log_dir", master.flags.log_dir.get());
   }
 
-  JSON::Object flags;
+  writer.key("flags");
+  writer.beginObject();
   foreachpair (const string& name, const flags::Flag& flag, master.flags) {
     Option<string> value = flag.stringify(master.flags);
     if (value.isSome()) {
-      flags.values[name] = value.get();
+      writer.field(name, value.get());
     }
   }
-  object.values["flags"] = flags;
+  writer.endObject();
 
-  // Model all of the slaves.
-  {
-    JSON::Array array;
-    foreachvalue (Slave* slave, master.slaves) {
-      array.values.push_back(model(*slave));
+  writer.field("state_version", master.version);
+
+  // The slaves and frameworks were already rendered by 'update'.
+  writer.key("slaves");
+  writer.beginArray();
+  foreachvalue (const Model& slave, cache->slaves) {
+    slave.write(&writer);
+  }
+  writer.endArray();
+
+  writer.key("frameworks");
+  writer.beginArray();
+  foreachvalue (const Model& framework, cache->frameworks) {
+    framework.write(&writer);
+  }
+  writer.endArray();
+
+  writer.key("completed_frameworks");
+  writer.beginArray();
+  foreach (const memory::shared_ptr<Framework>& framework,
+           master.completedFrameworks) {
+    writer.rendered(cache->completedFrameworks[framework->id]);
+  }
+  writer.endArray();
+
+  writer.endObject();
+
+  cache->version = master.version;
+  cache->state = out.str();
+
+  return internal::http::json(cache->state.get(), request.query.get("jsonp"));
+}
+
+
+const string Master::Http::STATE_DIFF_HELP = HELP(
+    TLDR(
+        "Lists the changes to the state of the master."),
+    USAGE(
+        "/master/state-diff.json?id=ID&since=VERSION"),
+    DESCRIPTION(
+        "Returns the slaves and frameworks that changed after the",
+        "given version of the master's state (see 'state_version' in",
+        "/master/state.json), the frameworks that completed and the",
+        "ids of the slaves that were removed. The returned 'id' and",
+        "'version' can be used as 'id' and 'since' for the next request.",
+        "",
+        "If the changes since VERSION are no longer known, or ID is not",
+        "the id of this master (i.e., VERSION is from another master),",
+        "then 'full' is set and everything known to the master is",
+        "returned instead. Since every master starts counting versions",
+        "anew, clients that omit ID have to compare 'id' themselves."));
+
+
+Future<Response> Master::Http::stateDiff(const Request& request)
+{
+  LOG(INFO) << "HTTP request for '" << request.path << "'";
+
+  Result<uint64_t> result = numify<uint64_t>(request.query.get("since"));
+  if (result.isError()) {
+    return BadRequest("Failed to parse 'since': " + result.error() + ".\n");
+  }
+
+  uint64_t since = result.isSome() ? result.get() : 0;
+
+  // Versions of another master (e.g., the one before a failover)
+  // can't be compared with ours. Otherwise changes can only be
+  // computed while every removal after 'since' is still remembered.
+  Option<string> id = request.query.get("id");
+
+  bool full = (id.isSome() && id.get() != master.info.id()) ||
+    since > master.version ||
+    (master.removedSlaves.full() &&
+     since < master.removedSlaves.front().first) ||
+    (master.completedFrameworks.full() &&
+     since < master.completedFrameworks.front()->version);
+
+  if (full) {
+    since = 0;
+  }
+
+  update();
+
+  std::ostringstream out;
+  JSON::Writer writer(&out);
+
+  writer.beginObject();
+  writer.field("id", master.info.id());
+  writer.field("version", master.version);
+  writer.field("since", since);
+  writer.field("full", full);
+
+  writer.key("removed_slaves");
+  writer.beginArray();
+  typedef std::pair<uint64_t, SlaveID> RemovedSlave;
+  foreach (const RemovedSlave& removed, master.removedSlaves) {
+    if (removed.first > since) {
+      writer.value(removed.second.value());
     }
+  }
+  writer.endArray();
+
+  // Only visit the slaves and frameworks that changed after 'since'.
+  writer.key("slaves");
+  writer.beginArray();
+  for (std::map<uint64_t, SlaveID>::const_iterator iterator =
+         cache->slavesByVersion.upper_bound(since);
+       iterator != cache->slavesByVersion.end();
+       ++iterator) {
+    cache->slaves[iterator->second].write(&writer);
+  }
+  writer.endArray();
+
+  writer.key("frameworks");
+  writer.beginArray();
+  for (std::map<uint64_t, FrameworkID>::const_iterator iterator =
+         cache->frameworksByVersion.upper_bound(since);
+       iterator != cache->frameworksByVersion.end();
+       ++iterator) {
+    cache->frameworks[iterator->second].write(&writer);
+  }
+  writer.endArray();
 
-    object.values["slaves"] = array;
+  writer.key("completed_frameworks");
+  writer.beginArray();
+  foreach (const memory::shared_ptr<Framework>& framework,
+           master.completedFrameworks) {
+    if (framework->version > since) {
+      writer.rendered(cache->completedFrameworks[framework->id]);
+    }
   }
+  writer.endArray();
 
-  // Model all of the frameworks.
-  {
-    JSON::Array array;
-    foreachvalue (Framework* framework, master.frameworks) {
-      array.values.push_back(model(*framework));
+  writer.endObject();
+
+  return internal::http::json(out.str(), request.query.get("jsonp"));
+}
+
+
+void Master::Http::changed(const FrameworkID& frameworkId)
+{
+  cache->changedFrameworks.insert(frameworkId);
+}
+
+
+void Master::Http::changed(const SlaveID& slaveId)
+{
+  cache->changedSlaves.insert(slaveId);
+}
+
+
+void Master::Http::update()
+{
+  // Re-model only the slaves and frameworks that changed since they
+  // were last rendered, and forget those the master no longer knows.
+  // Their tasks are only re-modeled if more than their offers changed.
+  foreach (const SlaveID& slaveId, cache->changedSlaves) {
+    if (cache->slaves.contains(slaveId)) {
+      cache->slavesByVersion.erase(cache->slaves[slaveId].latest());
+    }
+
+    if (!master.slaves.contains(slaveId)) {
+      cache->slaves.erase(slaveId);
+      continue;
+    }
+
+    const Slave& slave = *master.slaves.get(slaveId).get();
+
+    Model& model = cache->slaves[slaveId];
+
+    if (model.version != slave.version) {
+      model.version = slave.version;
+      model.fields = render(&fields, slave);
     }
 
-    object.values["frameworks"] = array;
+    // The offer fields are cheap to render, so they get re-rendered
+    // on any change.
+    model.offersVersion = slave.offersVersion;
+    model.offers = render(&offerFields, slave);
+
+    cache->slavesByVersion[model.latest()] = slaveId;
   }
 
-  // Model all of the completed frameworks.
-  {
-    JSON::Array array;
+  cache->changedSlaves.clear();
+
+  bool completed = false;
 
-    foreach (const memory::shared_ptr<Framework>& framework,
-             master.completedFrameworks) {
-      array.values.push_back(model(*framework));
+  foreach (const FrameworkID& frameworkId, cache->changedFrameworks) {
+    if (cache->frameworks.contains(frameworkId)) {
+      cache->frameworksByVersion.erase(cache->frameworks[frameworkId].latest());
     }
 
-    object.values["completed_frameworks"] = array;
+    if (!master.frameworks.contains(frameworkId)) {
+      cache->frameworks.erase(frameworkId);
+      completed = true;
+      continue;
+    }
+
+    const Framework& framework = *master.frameworks.get(frameworkId).get();
+
+    Model& model = cache->frameworks[frameworkId];
+
+    if (model.version != framework.version) {
+      model.version = framework.version;
+      model.fields = render(&fields, framework);
+    }
+
+    // The resources of a framework change with its tasks as well as
+    // with its offers, so the (cheap) offer fields get re-rendered on
+    // any change.
+    model.offersVersion = framework.offersVersion;
+    model.offers = render(&offerFields, framework);
+
+    cache->frameworksByVersion[model.latest()] = frameworkId;
   }
 
-  return OK(object, request.query.get("jsonp"));
+  cache->changedFrameworks.clear();
+
+  if (!completed) {
+    return;
+  }
+
+  // Completed frameworks no longer change, so they only need to be
+  // rendered once. The number of completed frameworks is bounded
+  // (see MAX_COMPLETED_FRAMEWORKS), so they can all be visited.
+  hashset<FrameworkID> ids;
+  foreach (const memory::shared_ptr<Framework>& framework,
+           master.completedFrameworks) {
+    ids.insert(framework->id);
+    if (!cache->completedFrameworks.contains(framework->id)) {
+      cache->completedFrameworks[framework->id] = render(*framework);
+    }
+  }
+
+  foreach (const FrameworkID& frameworkId, cache->completedFrameworks.keys()) {
+    if (!ids.contains(frameworkId)) {
+      cache->completedFrameworks.erase(frameworkId);
+    }
+  }
+}
+
+
+void Master::Http::Model::write(JSON::Writer* writer) const
+{
+  writer->beginObject();
+  writer->rendered(fields);
+  writer->rendered(offers);
+  writer->endObject();
 }
 
 
@@ -467,19 +739,22 @@ Future<Response> Master::Http::roles(const Request& request)
 {
   LOG(INFO) << "HTTP request for '" << request.path << "'";
 
-  JSON::Object object;
+  std::ostringstream out;
+  JSON::Writer writer(&out);
 
-  // Model all of the roles.
-  {
-    JSON::Array array;
-    foreachvalue (Role* role, master.roles) {
-      array.values.push_back(model(*role));
-    }
+  writer.beginObject();
 
-    object.values["roles"] = array;
+  // Model all of the roles.
+  writer.key("roles");
+  writer.beginArray();
+  foreachvalue (Role* role, master.roles) {
+    json(&writer, *role);
   }
+  writer.endArray();
 
-  return OK(object, request.query.get("jsonp"));
+  writer.endObject();
+
+  return internal::http::json(out.str(), request.query.get("jsonp"));
 }
 
 
@@ -568,17 +843,21 @@ Future<Response> Master::Http::tasks(const Request& request)
     sort(tasks.begin(), tasks.end(), TaskComparator::descending);
   }
 
-  JSON::Array array;
+  std::ostringstream out;
+  JSON::Writer writer(&out);
+
+  writer.beginObject();
+  writer.key("tasks");
+  writer.beginArray();
   size_t end = std::min(offset + limit, tasks.size());
   for (size_t i = offset; i < end; i++) {
     const Task* task = tasks[i];
-    array.values.push_back(model(*task));
+    json(&writer, *task);
   }
+  writer.endArray();
+  writer.endObject();
 
-  JSON::Object object;
-  object.values["tasks"] = array;
-
-  return OK(object, request.query.get("jsonp"));
+  return internal::http::json(out.str(), request.query.get("jsonp"));
 }
 
 
@@ -16,11 +16,18 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <list>
+#include <map>
 #include <sstream>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <google/protobuf/wire_format_lite_inl.h>
+
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/id.hpp>
@@ -33,6 +40,7 @@
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/utils.hpp>
 #include <stout/uuid.hpp>
 
@@ -53,6 +61,8 @@ using std::list;
 using std::string;
 using std::vector;
 
+using google::protobuf::internal::WireFormatLite;
+
 using process::wait; // Necessary on some OS's to disambiguate.
 
 using memory::shared_ptr;
@@ -125,64 +135,229 @@ private:
 };
 
 
-class SlaveObserver : public Process<SlaveObserver>
+// Checks the health of all slaves by periodically sending each a
+// PING and expecting a PONG back before the next PING is due. A slave
+// that misses MAX_SLAVE_PING_TIMEOUTS consecutive PONGs gets
+// deactivated. All slaves are checked from this one process (rather
+// than a process per slave) using a single timer for the earliest
+// deadline, and the slaves whose deadlines fall within the same
+// SLAVE_PING_BATCH_INTERVAL are pinged together.
+class SlaveHealthChecker : public Process<SlaveHealthChecker>
 {
 public:
-  SlaveObserver(const UPID& _slave,
-                const SlaveInfo& _slaveInfo,
-                const SlaveID& _slaveId,
-                const PID<Master>& _master)
-    : ProcessBase(ID::generate("slave-observer")),
-      slave(_slave),
-      slaveInfo(_slaveInfo),
-      slaveId(_slaveId),
+  explicit SlaveHealthChecker(const PID<Master>& _master)
+    : ProcessBase(ID::generate("slave-health-checker")),
       master(_master),
-      timeouts(0),
-      pinged(false)
+      scheduled(false)
   {
-    install("PONG", &SlaveObserver::pong);
+    install("PONG", &SlaveHealthChecker::pong);
   }
 
-protected:
-  virtual void initialize()
+  void add(const SlaveID& slaveId, const UPID& pid)
+  {
+    CHECK(!slaves.contains(slaveId)) << "Slave " << slaveId << " added twice";
+
+    Observed& observed = slaves[slaveId];
+    observed.pid = pid;
+    observed.timeouts = 0;
+    observed.deadline = deadlines.end();
+
+    pids[pid] = slaveId;
+
+    ping(slaveId, &observed);
+    schedule();
+  }
+
+  // Starts checking the slave at its new pid after it re-registered.
+  void update(const SlaveID& slaveId, const UPID& pid)
+  {
+    if (!slaves.contains(slaveId)) {
+      return; // Already deactivated.
+    }
+
+    Observed& observed = slaves[slaveId];
+    if (observed.pid == pid) {
+      return;
+    }
+
+    pids.erase(observed.pid);
+    pids[pid] = slaveId;
+
+    observed.pid = pid;
+    observed.timeouts = 0;
+
+    deadlines.erase(observed.deadline);
+    ping(slaveId, &observed);
+    schedule();
+  }
+
+  void remove(const SlaveID& slaveId)
   {
-    send(slave, "PING");
-    pinged = true;
-    delay(SLAVE_PING_TIMEOUT, self(), &SlaveObserver::timeout);
+    if (!slaves.contains(slaveId)) {
+      return; // Already deactivated.
+    }
+
+    Observed& observed = slaves[slaveId];
+    deadlines.erase(observed.deadline);
+    pids.erase(observed.pid);
+    slaves.erase(slaveId);
   }
 
+protected:
   void pong(const UPID& from, const string& body)
   {
-    timeouts = 0;
-    pinged = false;
+    if (!pids.contains(from)) {
+      return; // The slave was removed after it was pinged.
+    }
+
+    Observed& observed = slaves[pids[from]];
+    observed.timeouts = 0;
+    observed.pinged = false;
   }
 
-  void timeout()
+  void check()
   {
-    if (pinged) { // So we haven't got back a pong yet ...
-      if (++timeouts >= MAX_SLAVE_PING_TIMEOUTS) {
-        deactivate();
-        return;
+    scheduled = false;
+
+    Time now = Clock::now();
+
+    while (!deadlines.empty() && deadlines.begin()->first <= now) {
+      const SlaveID slaveId = deadlines.begin()->second;
+      deadlines.erase(deadlines.begin());
+
+      Observed& observed = slaves[slaveId];
+      observed.deadline = deadlines.end();
+
+      if (observed.pinged) { // So we haven't got back a pong yet ...
+        if (++observed.timeouts >= MAX_SLAVE_PING_TIMEOUTS) {
+          // Stop checking the slave, the master will remove it.
+          pids.erase(observed.pid);
+          slaves.erase(slaveId);
+          dispatch(master, &Master::deactivateSlave, slaveId);
+          continue;
+        }
       }
+
+      ping(slaveId, &observed);
     }
 
-    send(slave, "PING");
-    pinged = true;
-    delay(SLAVE_PING_TIMEOUT, self(), &SlaveObserver::timeout);
+    schedule();
   }
 
-  void deactivate()
+private:
+  struct Observed
+  {
+    UPID pid;
+    uint32_t timeouts;
+    bool pinged;
+    std::multimap<Time, SlaveID>::iterator deadline;
+  };
+
+  void ping(const SlaveID& slaveId, Observed* observed)
   {
-    dispatch(master, &Master::deactivateSlave, slaveId);
+    send(observed->pid, "PING");
+    observed->pinged = true;
+    observed->deadline = deadlines.insert(
+        std::make_pair(Clock::now() + SLAVE_PING_TIMEOUT, slaveId));
+  }
+
+  // Arms the timer for the earliest deadline, unless it is already
+  // armed. The timer is only ever armed for a deadline that is due
+  // no later than every other deadline, since new deadlines are
+  // always a full SLAVE_PING_TIMEOUT away.
+  void schedule()
+  {
+    if (scheduled || deadlines.empty()) {
+      return;
+    }
+
+    Duration duration = std::max(
+        deadlines.begin()->first - Clock::now(),
+        SLAVE_PING_BATCH_INTERVAL);
+
+    delay(duration, self(), &SlaveHealthChecker::check);
+    scheduled = true;
   }
 
-private:
-  const UPID slave;
-  const SlaveInfo slaveInfo;
-  const SlaveID slaveId;
   const PID<Master> master;
-  uint32_t timeouts;
-  bool pinged;
+
+  hashmap<SlaveID, Observed> slaves;
+  hashmap<UPID, SlaveID> pids;
+
+  // When the next PONG is due from each slave.
+  std::multimap<Time, SlaveID> deadlines;
+
+  // Whether the timer is armed.
+  bool scheduled;
+};
+
+
+// Prepares the slaves re-registering after a master failover off
+// the master actor, so that the master only needs to add them (see
+// Master::readdSlave). The executors and the non-terminal tasks of
+// each slave get grouped by framework and the resources they use get
+// summed up.
+class SlaveReregistrar : public Process<SlaveReregistrar>
+{
+public:
+  SlaveReregistrar()
+    : ProcessBase(ID::generate("slave-reregistrar")) {}
+
+  vector<Master::Reregistration> prepare(vector<Master::Reregistration> batch)
+  {
+    foreach (Master::Reregistration& reregistration, batch) {
+      group(&reregistration);
+    }
+
+    return batch;
+  }
+
+private:
+  void group(Master::Reregistration* reregistration)
+  {
+    foreach (const ExecutorInfo& executorInfo,
+             reregistration->executorInfos) {
+      // TODO(bmahler): ExecutorInfo.framework_id is set by the
+      // Scheduler Driver in 0.14.0. Therefore, in 0.15.0, the slave
+      // no longer needs to set it, and we could remove this CHECK if
+      // desired.
+      CHECK(executorInfo.has_framework_id())
+        << "Executor " << executorInfo.executor_id()
+        << " doesn't have frameworkId set";
+
+      const FrameworkID& frameworkId = executorInfo.framework_id();
+
+      hashmap<ExecutorID, ExecutorInfo>& executors =
+        reregistration->executors[frameworkId];
+
+      if (!executors.contains(executorInfo.executor_id())) {
+        executors[executorInfo.executor_id()] = executorInfo;
+        reregistration->resources[frameworkId] += executorInfo.resources();
+        reregistration->used += executorInfo.resources();
+      }
+    }
+
+    foreach (const Task& task, reregistration->tasks) {
+      // Ignore tasks that have reached terminal state.
+      if (protobuf::isTerminalState(task.state())) {
+        continue;
+      }
+
+      const FrameworkID& frameworkId = task.framework_id();
+
+      hashmap<TaskID, Task>& tasks =
+        reregistration->frameworkTasks[frameworkId];
+
+      if (!tasks.contains(task.task_id())) {
+        tasks[task.task_id()] = task;
+        reregistration->resources[frameworkId] += task.resources();
+        reregistration->used += task.resources();
+      }
+    }
+
+    reregistration->executorInfos.clear();
+    reregistration->tasks.clear();
+  }
 };
 
 
@@ -201,7 +376,9 @@ Master::Master(
     files(_files),
     contender(_contender),
     detector(_detector),
-    completedFrameworks(MAX_COMPLETED_FRAMEWORKS) {}
+    completedFrameworks(MAX_COMPLETED_FRAMEWORKS),
+    version(0),
+    removedSlaves(MAX_REMOVED_SLAVES) {}
 
 
 Master::~Master()
@@ -263,15 +440,20 @@ Master::~Master()
       }
     }
 
-    // Kill the slave observer.
-    terminate(slave->observer);
-    wait(slave->observer);
-
-    delete slave->observer;
     delete slave;
   }
   slaves.clear();
 
+  terminate(healthChecker);
+  wait(healthChecker);
+
+  delete healthChecker;
+
+  terminate(reregistrar);
+  wait(reregistrar);
+
+  delete reregistrar;
+
   terminate(whitelistWatcher);
   wait(whitelistWatcher);
 
@@ -400,6 +582,12 @@ void Master::initialize()
   whitelistWatcher = new WhitelistWatcher(flags.whitelist, allocator);
   spawn(whitelistWatcher);
 
+  healthChecker = new SlaveHealthChecker(self());
+  spawn(healthChecker);
+
+  reregistrar = new SlaveReregistrar();
+  spawn(reregistrar);
+
   nextFrameworkId = 0;
   nextSlaveId = 0;
   nextOfferId = 0;
@@ -518,6 +706,9 @@ void Master::initialize()
   route("/state.json",
         None(),
         lambda::bind(&Http::state, http, lambda::_1));
+  route("/state-diff.json",
+        Http::STATE_DIFF_HELP,
+        lambda::bind(&Http::stateDiff, http, lambda::_1));
   route("/roles.json",
         None(),
         lambda::bind(&Http::roles, http, lambda::_1));
@@ -608,7 +799,7 @@ void Master::exited(const UPID& pid)
   //    fall into one of the 2 cases:
   //    2.1) Framework is checkpointing: No immediate action is taken.
   //         The slave is given a chance to reconnect until the slave
-  //         observer times out (75s) and removes the slave (Case 1).
+  //         health checker times out (75s) and removes the slave (Case 1).
   //    2.2) Framework is not-checkpointing: The slave is not removed
   //         but the framework is removed from the slave's structs,
   //         its tasks transitioned to LOST and resources recovered.
@@ -648,13 +839,8 @@ void Master::exited(const UPID& pid)
           }
         }
 
-        foreach (Offer* offer, utils::copy(slave->offers)) {
-          allocator->resourcesRecovered(
-              offer->framework_id(), slave->id, offer->resources());
-
-          // Remove and rescind offers.
-          removeOffer(offer, true); // Rescind!
-        }
+        // Remove and rescind offers.
+        removeOffers(slave, true); // Rescind!
       } else {
         LOG(WARNING) << "Ignoring duplicate exited() notification for "
                      << "checkpointing slave " << slave->id
@@ -729,6 +915,8 @@ void Master::detected(const Future<Option<UPID> >& _leader)
   bool wasElected = elected();
   leader = _leader.get();
 
+  changed();
+
   LOG(INFO) << "The newly elected leader is "
             << (leader.isSome() ? leader.get() : "None");
 
@@ -889,6 +1077,7 @@ void Master::reregisterFramework(
 
     Framework* framework = frameworks[frameworkInfo.id()];
     framework->reregisteredTime = Clock::now();
+    changed(framework);
 
     if (failover) {
       // We do not attempt to detect a duplicate re-registration
@@ -918,11 +1107,7 @@ void Master::reregisterFramework(
       // NOTE: We need to do this because the scheduler might have
       // replied to the offers but the driver might have dropped
       // those messages since it wasn't connected to the master.
-      foreach (Offer* offer, utils::copy(framework->offers)) {
-        allocator->resourcesRecovered(
-            offer->framework_id(), offer->slave_id(), offer->resources());
-        removeOffer(offer);
-      }
+      removeOffers(framework);
 
       FrameworkReregisteredMessage message;
       message.mutable_framework_id()->MergeFrom(frameworkInfo.id());
@@ -942,22 +1127,27 @@ void Master::reregisterFramework(
     // TODO(benh): Check for root submissions like above!
 
     // Add any running tasks reported by slaves for this framework.
-    foreachvalue (Slave* slave, slaves) {
-      foreachkey (const FrameworkID& frameworkId, slave->tasks) {
-        foreachvalue (Task* task, slave->tasks[frameworkId]) {
-          if (framework->id == task->framework_id()) {
-            framework->addTask(task);
-
-            // Also add the task's executor for resource accounting
-            // if it's still alive on the slave and we've not yet
-            // added it to the framework.
-            if (task->has_executor_id() &&
-                slave->hasExecutor(framework->id, task->executor_id()) &&
-                !framework->hasExecutor(slave->id, task->executor_id())) {
-              const ExecutorInfo& executorInfo =
-                slave->executors[framework->id][task->executor_id()];
-              framework->addExecutor(slave->id, executorInfo);
-            }
+    if (frameworkSlaves.contains(framework->id)) {
+      foreach (const SlaveID& slaveId, frameworkSlaves[framework->id]) {
+        Slave* slave = getSlave(slaveId);
+        CHECK_NOTNULL(slave);
+
+        if (!slave->tasks.contains(framework->id)) {
+          continue;
+        }
+
+        foreachvalue (Task* task, slave->tasks[framework->id]) {
+          framework->addTask(task);
+
+          // Also add the task's executor for resource accounting
+          // if it's still alive on the slave and we've not yet
+          // added it to the framework.
+          if (task->has_executor_id() &&
+              slave->hasExecutor(framework->id, task->executor_id()) &&
+              !framework->hasExecutor(slave->id, task->executor_id())) {
+            const ExecutorInfo& executorInfo =
+              slave->executors[framework->id][task->executor_id()];
+            framework->addExecutor(slave->id, executorInfo);
           }
         }
       }
@@ -972,15 +1162,20 @@ void Master::reregisterFramework(
   CHECK(frameworks.contains(frameworkInfo.id()))
     << "Unknown framework " << frameworkInfo.id();
 
-  // Broadcast the new framework pid to all the slaves. We have to
-  // broadcast because an executor might be running on a slave but
-  // it currently isn't running any tasks. This could be a
-  // potential scalability issue ...
-  foreachvalue (Slave* slave, slaves) {
+  // Send the new framework pid to the slaves that have tasks or
+  // executors of the framework (an executor might be running on a
+  // slave but it currently isn't running any tasks). Slaves that
+  // re-register later get the pid in 'updateFrameworkPids'.
+  if (frameworkSlaves.contains(frameworkInfo.id())) {
     UpdateFrameworkMessage message;
     message.mutable_framework_id()->MergeFrom(frameworkInfo.id());
     message.set_pid(from);
-    send(slave->pid, message);
+
+    foreach (const SlaveID& slaveId, frameworkSlaves[frameworkInfo.id()]) {
+      Slave* slave = getSlave(slaveId);
+      CHECK_NOTNULL(slave);
+      send(slave->pid, message);
+    }
   }
 
   return;
@@ -1040,6 +1235,7 @@ void Master::deactivate(Framework* framework)
 
   // Stop sending offers here for now.
   framework->active = false;
+  changed(framework);
 
   // Tell the allocator to stop allocating resources to this framework.
   allocator->frameworkDeactivated(framework->id);
@@ -1049,14 +1245,7 @@ void Master::deactivate(Framework* framework)
   authenticated.erase(framework->pid);
 
   // Remove the framework's offers.
-  foreach (Offer* offer, utils::copy(framework->offers)) {
-    allocator->resourcesRecovered(
-        offer->framework_id(),
-        offer->slave_id(),
-        Resources(offer->resources()));
-
-    removeOffer(offer);
-  }
+  removeOffers(framework);
 }
 
 
@@ -1420,6 +1609,10 @@ void Master::reregisterSlave(
       slave->pid = from;
       link(slave->pid);
 
+      dispatch(healthChecker, &SlaveHealthChecker::update, slave->id, from);
+
+      changed(slave);
+
       // Reconcile tasks between master and the slave.
       // NOTE: This needs to be done after the registration message is
       // sent to the slave and the new pid is linked.
@@ -1433,31 +1626,120 @@ void Master::reregisterSlave(
         slave->disconnected = false; // Reset the flag.
         allocator->slaveReconnected(slaveId);
       }
+
+      updateFrameworkPids(slave, tasks);
+    } else if (reregistering.contains(slaveId)) {
+      if (reregistering[slaveId] == from) {
+        LOG(INFO) << "Ignoring re-register slave message from " << from
+                  << " since slave " << slaveId
+                  << " is already re-registering";
+      } else {
+        // The slave (e.g., restarted and) retried from another pid
+        // while its re-registration was queued up, so re-add it at
+        // its current pid.
+        LOG(INFO) << "Slave " << slaveId << " is re-registering from "
+                  << from << " instead of " << reregistering[slaveId];
+
+        reregistering[slaveId] = from;
+      }
     } else {
       // NOTE: This handles the case when the slave tries to
-      // re-register with a failed over master.
-      slave = new Slave(slaveInfo, slaveId, from, Clock::now());
-      slave->reregisteredTime = Clock::now();
+      // re-register with a failed over master. After a failover all
+      // of the slaves re-register at once, so the re-registrations
+      // are queued up and re-added together, see '_reregisterSlaves'.
+      reregistering[slaveId] = from;
+
+      reregistrations.push_back(Reregistration());
+
+      Reregistration& reregistration = reregistrations.back();
+      reregistration.from = from;
+      reregistration.slaveId = slaveId;
+      reregistration.slaveInfo = slaveInfo;
+      reregistration.executorInfos = executorInfos;
+      reregistration.tasks = tasks;
+
+      if (reregistrations.size() == 1) {
+        dispatch(self(), &Self::_reregisterSlaves);
+      }
+    }
+  }
+}
 
-      LOG(INFO) << "Attempting to re-register slave " << slave->id << " at "
-                << slave->pid << " (" << slave->info.hostname() << ")";
 
-      readdSlave(slave, executorInfos, tasks);
-    }
+void Master::_reregisterSlaves()
+{
+  // Prepare all of the slaves that re-registered since the last
+  // batch, i.e., while the master was handling earlier events.
+  vector<Reregistration> batch;
+  batch.swap(reregistrations);
+
+  dispatch(reregistrar, &SlaveReregistrar::prepare, batch)
+    .onAny(defer(self(), &Self::__reregisterSlaves, lambda::_1));
+}
 
-    // Send the latest framework pids to the slave.
-    CHECK_NOTNULL(slave);
-    hashset<UPID> pids;
-    foreach (const Task& task, tasks) {
-      Framework* framework = getFramework(task.framework_id());
-      if (framework != NULL && !pids.contains(framework->pid)) {
-        UpdateFrameworkMessage message;
-        message.mutable_framework_id()->MergeFrom(framework->id);
-        message.set_pid(framework->pid);
-        send(slave->pid, message);
 
-        pids.insert(framework->pid);
-      }
+void Master::__reregisterSlaves(const Future<vector<Reregistration> >& batch)
+{
+  // NOTE: The reregistrar only goes away along with the master.
+  CHECK(batch.isReady()) << "Failed to prepare re-registering slaves";
+
+  bool readding = !prepared.empty();
+
+  foreach (const Reregistration& reregistration, batch.get()) {
+    prepared.push_back(reregistration);
+  }
+
+  // Unless the master is still re-adding an earlier batch.
+  if (!readding) {
+    readdSlaves();
+  }
+}
+
+
+void Master::readdSlaves()
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // Re-add the prepared slaves a slice at a time, so that the master
+  // gets to handle other events (e.g., allocations) in between.
+  uint32_t count = 0;
+  while (!prepared.empty() && count < MAX_REREGISTRATIONS_PER_SLICE) {
+    Reregistration& reregistration = prepared.front();
+
+    CHECK(reregistering.contains(reregistration.slaveId));
+    reregistration.from = reregistering[reregistration.slaveId];
+    reregistering.erase(reregistration.slaveId);
+
+    readdSlave(reregistration);
+    prepared.pop_front();
+    count++;
+  }
+
+  LOG(INFO) << "Re-added " << count << " slave(s) in " << stopwatch.elapsed()
+            << ", " << prepared.size() << " slave(s) left to re-add";
+
+  if (!prepared.empty()) {
+    dispatch(self(), &Self::readdSlaves);
+  }
+}
+
+
+void Master::updateFrameworkPids(Slave* slave, const vector<Task>& tasks)
+{
+  CHECK_NOTNULL(slave);
+
+  // Send the latest framework pids to the slave.
+  hashset<UPID> pids;
+  foreach (const Task& task, tasks) {
+    Framework* framework = getFramework(task.framework_id());
+    if (framework != NULL && !pids.contains(framework->pid)) {
+      UpdateFrameworkMessage message;
+      message.mutable_framework_id()->MergeFrom(framework->id);
+      message.set_pid(framework->pid);
+      send(slave->pid, message);
+
+      pids.insert(framework->pid);
     }
   }
 }
@@ -1546,6 +1828,8 @@ void Master::statusUpdate(const StatusUpdate& update, const UPID& pid)
   task->add_statuses()->CopyFrom(status);
   task->set_state(status.state());
 
+  changed(framework);
+
   // Handle the task appropriately if it's terminated.
   if (protobuf::isTerminalState(status.state())) {
     removeTask(task);
@@ -1608,6 +1892,7 @@ void Master::exitedExecutor(
 
     // Remove executor from slave and framework.
     slave->removeExecutor(frameworkId, executorId);
+    index(slave, frameworkId);
   } else {
     LOG(WARNING) << "Ignoring unknown exited executor "
                  << executorId << " on slave " << slaveId
@@ -1617,6 +1902,7 @@ void Master::exitedExecutor(
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
     framework->removeExecutor(slave->id, executorId);
+    changed(framework);
 
     // TODO(benh): Send the framework its executor's exit status?
     // Or maybe at least have something like
@@ -1628,8 +1914,8 @@ void Master::exitedExecutor(
 void Master::deactivateSlave(const SlaveID& slaveId)
 {
   if (!slaves.contains(slaveId)) {
-    // Possible when the SlaveObserver dispatched to deactivate a slave,
-    // but exited() was already called for this slave.
+    // Possible when the SlaveHealthChecker dispatched to deactivate a
+    // slave, but exited() was already called for this slave.
     LOG(WARNING) << "Unable to deactivate unknown slave " << slaveId;
     return;
   }
@@ -1726,8 +2012,14 @@ void Master::offer(const FrameworkID& frameworkId,
     return;
   }
 
-  // Create an offer for each slave and add it to the message.
-  ResourceOffersMessage message;
+  // Create an offer for each slave and serialize it directly into a
+  // ResourceOffersMessage. Each offer is followed by the slave's
+  // pre-serialized attributes (see Slave::attributes), which the
+  // scheduler parses as part of the same offer. This avoids copying
+  // the attributes into every offer and then copying every offer
+  // again into the message.
+  string data;
+  int count = 0;
 
   Framework* framework = frameworks[frameworkId];
   foreachpair (const SlaveID& slaveId, const Resources& offered, resources) {
@@ -1763,7 +2055,9 @@ void Master::offer(const FrameworkID& frameworkId,
     offer->mutable_slave_id()->MergeFrom(slave->id);
     offer->set_hostname(slave->info.hostname());
     offer->mutable_resources()->MergeFrom(offered);
-    offer->mutable_attributes()->MergeFrom(slave->info.attributes());
+
+    // NOTE: The master does not keep the attributes in its copy of
+    // the offer, they are only sent to the framework (see below).
 
     // Add all framework's executors running on this slave.
     if (slave->executors.contains(framework->id)) {
@@ -1779,19 +2073,43 @@ void Master::offer(const FrameworkID& frameworkId,
     framework->addOffer(offer);
     slave->addOffer(offer);
 
+    offersChanged(framework, slave);
+
     // Add the offer *AND* the corresponding slave's PID.
-    message.add_offers()->MergeFrom(*offer);
-    message.add_pids(slave->pid);
+    {
+      // NOTE: The streams append to 'data' and are flushed when they
+      // go out of scope.
+      google::protobuf::io::StringOutputStream stream(&data);
+      google::protobuf::io::CodedOutputStream output(&stream);
+
+      WireFormatLite::WriteTag(
+          ResourceOffersMessage::kOffersFieldNumber,
+          WireFormatLite::WIRETYPE_LENGTH_DELIMITED,
+          &output);
+      output.WriteVarint32(offer->ByteSize() + slave->attributes.size());
+      offer->SerializeWithCachedSizes(&output);
+      output.WriteString(slave->attributes);
+
+      WireFormatLite::WriteString(
+          ResourceOffersMessage::kPidsFieldNumber,
+          slave->pid,
+          &output);
+    }
+
+    count++;
   }
 
-  if (message.offers().size() == 0) {
+  if (count == 0) {
     return;
   }
 
-  LOG(INFO) << "Sending " << message.offers().size()
+  LOG(INFO) << "Sending " << count
             << " offers to framework " << framework->id;
 
-  send(framework->pid, message);
+  send(framework->pid,
+       ResourceOffersMessage().GetTypeName(),
+       data.data(),
+       data.size());
 }
 
 
@@ -1818,6 +2136,14 @@ void Master::authenticate(const UPID& from, const UPID& pid)
 
   authenticated.erase(pid);
 
+  if (queuedAuthentications.contains(pid)) {
+    // The authentication has not started yet, so it can simply use
+    // the latest authenticatee.
+    LOG(INFO) << "Replacing queued up authentication request from " << pid;
+    queuedAuthentications[pid].from = from;
+    return;
+  }
+
   if (authenticating.contains(pid)) {
     LOG(INFO) << "Queuing up authentication request from " << pid
               << " because authentication is still in progress";
@@ -1833,12 +2159,41 @@ void Master::authenticate(const UPID& from, const UPID& pid)
     return;
   }
 
-  LOG(INFO) << "Authenticating framework at " << pid;
-
   // Create a promise to capture the entire "authenticating"
   // procedure. We'll set this _after_ we finish _authenticate.
   Owned<Promise<Nothing> > promise(new Promise<Nothing>());
 
+  authenticating[pid] = promise->future();
+
+  // Bound the number of authentications in progress, so that a lot
+  // of frameworks (re-)authenticating at once (e.g., after a master
+  // failover) don't all compete with each other and run into the
+  // authentication timeout.
+  if (authenticators.size() >= MAX_CONCURRENT_AUTHENTICATIONS) {
+    VLOG(1) << "Queuing up authentication request from " << pid
+            << " because " << authenticators.size()
+            << " authentications are in progress";
+
+    QueuedAuthentication queued;
+    queued.from = from;
+    queued.promise = promise;
+
+    authenticationQueue.push_back(pid);
+    queuedAuthentications[pid] = queued;
+    return;
+  }
+
+  doAuthenticate(from, pid, promise);
+}
+
+
+void Master::doAuthenticate(
+    const UPID& from,
+    const UPID& pid,
+    const Owned<Promise<Nothing> >& promise)
+{
+  LOG(INFO) << "Authenticating framework at " << pid;
+
   // Create the authenticator.
   Owned<sasl::Authenticator> authenticator(new sasl::Authenticator(from));
 
@@ -1852,8 +2207,6 @@ void Master::authenticate(const UPID& from, const UPID& pid)
         &Self::authenticationTimeout,
         future);
 
-  // Save our state.
-  authenticating[pid] = promise->future();
   authenticators.put(pid, authenticator);
 }
 
@@ -1881,6 +2234,19 @@ void Master::_authenticate(
 
   authenticators.erase(pid);
   authenticating.erase(pid);
+
+  // Start the queued up authentications that now fit.
+  while (!authenticationQueue.empty() &&
+         authenticators.size() < MAX_CONCURRENT_AUTHENTICATIONS) {
+    const UPID next = authenticationQueue.front();
+    authenticationQueue.pop_front();
+
+    CHECK(queuedAuthentications.contains(next));
+    const QueuedAuthentication queued = queuedAuthentications[next];
+    queuedAuthentications.erase(next);
+
+    doAuthenticate(queued.from, next, queued.promise);
+  }
 }
 
 
@@ -1999,15 +2365,21 @@ struct ResourceUsageChecker : TaskInfoVisitor
       }
     }
 
+    // Only convert the offered resources once per offer, rather than
+    // for every check of every task launched with the offer.
+    if (offered.isNone()) {
+      offered = Resources(offer->resources());
+    }
+
     // Check if this task uses more resources than offered.
     Resources taskResources = task.resources();
 
-    if (!((usedResources + taskResources) <= offer->resources())) {
+    if (!((usedResources + taskResources) <= offered.get())) {
       return TaskInfoError::some(
           "Task " + stringify(task.task_id()) + " attempted to use " +
           stringify(taskResources) + " combined with already used " +
           stringify(usedResources) + " is greater than offered " +
-          stringify(offer->resources()));
+          stringify(offered.get()));
     }
 
     // Check this task's executor's resources.
@@ -2028,12 +2400,12 @@ struct ResourceUsageChecker : TaskInfoVisitor
       if (!executors.contains(task.executor().executor_id())) {
         if (!slave->hasExecutor(framework->id, task.executor().executor_id())) {
           taskResources += task.executor().resources();
-          if (!((usedResources + taskResources) <= offer->resources())) {
+          if (!((usedResources + taskResources) <= offered.get())) {
             return TaskInfoError::some(
                 "Task " + stringify(task.task_id()) + " + executor attempted" +
                 " to use " + stringify(taskResources) + " combined with" +
                 " already used " + stringify(usedResources) + " is greater" +
-                " than offered " + stringify(offer->resources()));
+                " than offered " + stringify(offered.get()));
           }
         }
         executors.insert(task.executor().executor_id());
@@ -2045,6 +2417,7 @@ struct ResourceUsageChecker : TaskInfoVisitor
     return TaskInfoError::none();
   }
 
+  Option<Resources> offered;
   Resources usedResources;
   hashset<ExecutorID> executors;
 };
@@ -2245,6 +2618,9 @@ Resources Master::launchTask(const TaskInfo& task,
   framework->addTask(t);
 
   slave->addTask(t);
+  index(slave, framework->id);
+
+  changed(framework);
 
   resources += task.resources();
 
@@ -2349,9 +2725,11 @@ void Master::reconcile(
             slave->executors[frameworkId][executorId].resources());
 
         slave->removeExecutor(frameworkId, executorId);
+        index(slave, frameworkId);
 
         if (frameworks.contains(frameworkId)) {
           frameworks[frameworkId]->removeExecutor(slave->id, executorId);
+          changed(frameworks[frameworkId]);
         }
       }
     }
@@ -2405,6 +2783,8 @@ void Master::addFramework(Framework* framework)
 
   frameworks[framework->id] = framework;
 
+  changed(framework);
+
   link(framework->pid);
 
   // Enforced by Master::registerFramework.
@@ -2451,6 +2831,8 @@ void Master::failoverFramework(Framework* framework, const UPID& newPid)
   framework->pid = newPid;
   link(newPid);
 
+  changed(framework);
+
   // Make sure we can get offers again.
   if (!framework->active) {
     framework->active = true;
@@ -2471,12 +2853,7 @@ void Master::failoverFramework(Framework* framework, const UPID& newPid)
   // registered message so that the allocator can immediately re-offer
   // these resources to this framework if it wants.
   // TODO(benh): Consider just reoffering these to
-  foreach (Offer* offer, utils::copy(framework->offers)) {
-    allocator->resourcesRecovered(offer->framework_id(),
-                                  offer->slave_id(),
-                                  Resources(offer->resources()));
-    removeOffer(offer);
-  }
+  removeOffers(framework);
 }
 
 
@@ -2511,12 +2888,7 @@ void Master::removeFramework(Framework* framework)
   }
 
   // Remove the framework's offers (if they weren't removed before).
-  foreach (Offer* offer, utils::copy(framework->offers)) {
-    allocator->resourcesRecovered(offer->framework_id(),
-                                  offer->slave_id(),
-                                  Resources(offer->resources()));
-    removeOffer(offer);
-  }
+  removeOffers(framework);
 
   // Remove the framework's executors for correct resource accounting.
   foreachkey (const SlaveID& slaveId, framework->executors) {
@@ -2530,6 +2902,7 @@ void Master::removeFramework(Framework* framework)
                                       executorInfo.resources());
         slave->removeExecutor(framework->id, executorId);
       }
+      index(slave, framework->id);
     }
   }
 
@@ -2540,6 +2913,8 @@ void Master::removeFramework(Framework* framework)
 
   framework->unregisteredTime = Clock::now();
 
+  changed(framework);
+
   // The completedFramework buffer now owns the framework pointer.
   completedFrameworks.push_back(shared_ptr<Framework>(framework));
 
@@ -2604,6 +2979,9 @@ void Master::removeFramework(Slave* slave, Framework* framework)
       framework->removeExecutor(slave->id, executorId);
       slave->removeExecutor(framework->id, executorId);
     }
+
+    index(slave, framework->id);
+    changed(framework);
   }
 }
 
@@ -2619,6 +2997,8 @@ void Master::addSlave(Slave* slave, bool reregister)
   deactivatedSlaves.erase(slave->pid);
   slaves[slave->id] = slave;
 
+  changed(slave);
+
   link(slave->pid);
 
   if (!reregister) {
@@ -2636,10 +3016,8 @@ void Master::addSlave(Slave* slave, bool reregister)
   //     dispatch(slavesManager->self(), &SlavesManager::monitor,
   //              slave->pid, slave->info, slave->id);
 
-  // Set up an observer for the slave.
-  slave->observer = new SlaveObserver(slave->pid, slave->info,
-                                      slave->id, self());
-  spawn(slave->observer);
+  // Start checking the health of the slave.
+  dispatch(healthChecker, &SlaveHealthChecker::add, slave->id, slave->pid);
 
   if (!reregister) {
     allocator->slaveAdded(slave->id,
@@ -2649,74 +3027,86 @@ void Master::addSlave(Slave* slave, bool reregister)
 }
 
 
-void Master::readdSlave(Slave* slave,
-    const vector<ExecutorInfo>& executorInfos,
-    const vector<Task>& tasks)
+void Master::readdSlave(const Reregistration& reregistration)
 {
-  CHECK_NOTNULL(slave);
+  Slave* slave = new Slave(
+      reregistration.slaveInfo,
+      reregistration.slaveId,
+      reregistration.from,
+      Clock::now());
 
-  addSlave(slave, true);
+  slave->reregisteredTime = Clock::now();
 
-  // Add the executors and tasks to the slave and framework state and
-  // determine the resources that have been allocated to frameworks.
-  hashmap<FrameworkID, Resources> resources;
+  LOG(INFO) << "Re-adding slave " << slave->id << " at " << slave->pid
+            << " (" << slave->info.hostname() << ")";
 
-  foreach (const ExecutorInfo& executorInfo, executorInfos) {
-    // TODO(bmahler): ExecutorInfo.framework_id is set by the Scheduler
-    // Driver in 0.14.0. Therefore, in 0.15.0, the slave no longer needs
-    // to set it, and we could remove this CHECK if desired.
-    CHECK(executorInfo.has_framework_id())
-      << "Executor " << executorInfo.executor_id()
-      << " doesn't have frameworkId set";
+  // The executors (and the resources used by them and the tasks) were
+  // prepared by the reregistrar, so they are not added one by one.
+  slave->executors = reregistration.executors;
+  slave->resourcesInUse = reregistration.used;
 
-    if (!slave->hasExecutor(executorInfo.framework_id(),
-                            executorInfo.executor_id())) {
-      slave->addExecutor(executorInfo.framework_id(), executorInfo);
-    }
+  addSlave(slave, true);
+
+  // Add the executors and tasks to the framework state.
+  typedef hashmap<ExecutorID, ExecutorInfo> ExecutorInfos;
+  foreachpair (const FrameworkID& frameworkId,
+               const ExecutorInfos& executorInfos,
+               reregistration.executors) {
+    index(slave, frameworkId);
 
-    Framework* framework = getFramework(executorInfo.framework_id());
+    Framework* framework = getFramework(frameworkId);
     if (framework != NULL) {
-      if (!framework->hasExecutor(slave->id, executorInfo.executor_id())) {
-        framework->addExecutor(slave->id, executorInfo);
+      foreachvalue (const ExecutorInfo& executorInfo, executorInfos) {
+        if (!framework->hasExecutor(slave->id, executorInfo.executor_id())) {
+          framework->addExecutor(slave->id, executorInfo);
+        }
       }
+      changed(framework);
     }
-
-    resources[executorInfo.framework_id()] += executorInfo.resources();
   }
 
-  foreach (const Task& task, tasks) {
-    // Ignore tasks that have reached terminal state.
-    if (protobuf::isTerminalState(task.state())) {
-      continue;
-    }
+  typedef hashmap<TaskID, Task> Tasks;
+  foreachpair (const FrameworkID& frameworkId,
+               const Tasks& tasks,
+               reregistration.frameworkTasks) {
+    // Try and add the tasks to the framework too, but since the
+    // framework might not yet be connected we won't be able to add
+    // them. However, when the framework connects later we will add
+    // them then. Again, we do the same thing if a framework
+    // currently isn't registered.
+    Framework* framework = getFramework(frameworkId);
 
-    Task* t = new Task(task);
+    foreachvalue (const Task& task, tasks) {
+      Task* t = new Task(task);
+      slave->tasks[frameworkId][task.task_id()] = t;
 
-    // Add the task to the slave.
-    slave->addTask(t);
+      if (framework != NULL) {
+        framework->addTask(t);
+      }
+    }
+
+    index(slave, frameworkId);
 
-    // Try and add the task to the framework too, but since the
-    // framework might not yet be connected we won't be able to
-    // add them. However, when the framework connects later we
-    // will add them then. Again, we do the same thing
-    // if a framework currently isn't registered.
-    Framework* framework = getFramework(task.framework_id());
     if (framework != NULL) {
-      framework->addTask(t);
+      changed(framework);
+
+      // Send the latest framework pid to the slave.
+      UpdateFrameworkMessage message;
+      message.mutable_framework_id()->MergeFrom(framework->id);
+      message.set_pid(framework->pid);
+      send(slave->pid, message);
     } else {
       // TODO(benh): We should really put a timeout on how long we
       // keep tasks running on a slave that never have frameworks
       // reregister and claim them.
-      LOG(WARNING) << "Possibly orphaned task " << task.task_id()
-                   << " of framework " << task.framework_id()
+      LOG(WARNING) << "Possibly orphaned " << tasks.size() << " task(s)"
+                   << " of framework " << frameworkId
                    << " running on slave " << slave->id << " ("
                    << slave->info.hostname() << ")";
     }
-
-    resources[task.framework_id()] += task.resources();
   }
 
-  allocator->slaveAdded(slave->id, slave->info, resources);
+  allocator->slaveAdded(slave->id, slave->info, reregistration.resources);
 }
 
 
@@ -2761,15 +3151,10 @@ void Master::removeSlave(Slave* slave)
     }
   }
 
-  foreach (Offer* offer, utils::copy(slave->offers)) {
-    // TODO(vinod): We don't need to call 'Allocator::resourcesRecovered'
-    // once MESOS-621 is fixed.
-    allocator->resourcesRecovered(
-        offer->framework_id(), slave->id, offer->resources());
-
-    // Remove and rescind offers.
-    removeOffer(offer, true); // Rescind!
-  }
+  // Remove and rescind offers.
+  // TODO(vinod): We don't need to call 'Allocator::resourcesRecovered'
+  // for these offers once MESOS-621 is fixed.
+  removeOffers(slave, true); // Rescind!
 
   // Remove executors from the slave for proper resource accounting.
   foreachkey (const FrameworkID& frameworkId, slave->executors) {
@@ -2785,6 +3170,8 @@ void Master::removeSlave(Slave* slave)
 
         framework->removeExecutor(slave->id, executorId);
       }
+
+      changed(framework);
     }
   }
 
@@ -2801,17 +3188,29 @@ void Master::removeSlave(Slave* slave)
   //     dispatch(slavesManager->self(), &SlavesManager::forget,
   //              slave->pid, slave->info, slave->id);
 
-  // Kill the slave observer.
-  terminate(slave->observer);
-  wait(slave->observer);
-
-  delete slave->observer;
+  // Stop checking the health of the slave.
+  dispatch(healthChecker, &SlaveHealthChecker::remove, slave->id);
 
   // TODO(benh): unlink(slave->pid);
 
+  // Remove the slave from 'frameworkSlaves'. Tasks of frameworks that
+  // have not re-registered, as well as all the executors, are still
+  // on the slave at this point.
+  foreachkey (const FrameworkID& frameworkId, slave->tasks) {
+    unindex(slave, frameworkId);
+  }
+
+  foreachkey (const FrameworkID& frameworkId, slave->executors) {
+    unindex(slave, frameworkId);
+  }
+
   // Mark the slave as deactivated.
   deactivatedSlaves.insert(slave->pid);
   slaves.erase(slave->id);
+
+  changed(slave);
+  removedSlaves.push_back(std::make_pair(version, slave->id));
+
   delete slave;
 }
 
@@ -2824,12 +3223,14 @@ void Master::removeTask(Task* task)
   Framework* framework = getFramework(task->framework_id());
   if (framework != NULL) { // A framework might not be re-connected yet.
     framework->removeTask(task);
+    changed(framework);
   }
 
   // Remove from slave.
   Slave* slave = getSlave(task->slave_id());
   CHECK_NOTNULL(slave);
   slave->removeTask(task);
+  index(slave, task->framework_id());
 
   // Tell the allocator about the recovered resources.
   allocator->resourcesRecovered(
@@ -2857,6 +3258,8 @@ void Master::removeOffer(Offer* offer, bool rescind)
 
   slave->removeOffer(offer);
 
+  offersChanged(framework, slave);
+
   if (rescind) {
     RescindResourceOfferMessage message;
     message.mutable_offer_id()->MergeFrom(offer->id());
@@ -2869,6 +3272,102 @@ void Master::removeOffer(Offer* offer, bool rescind)
 }
 
 
+void Master::removeOffers(Framework* framework, bool rescind)
+{
+  CHECK_NOTNULL(framework);
+
+  // NOTE: Each removal erases the offer from 'framework->offers', so
+  // we drain the set rather than iterate over a copy of it.
+  while (!framework->offers.empty()) {
+    Offer* offer = *framework->offers.begin();
+
+    allocator->resourcesRecovered(
+        offer->framework_id(), offer->slave_id(), offer->resources());
+
+    removeOffer(offer, rescind);
+  }
+}
+
+
+void Master::removeOffers(Slave* slave, bool rescind)
+{
+  CHECK_NOTNULL(slave);
+
+  // NOTE: Each removal erases the offer from 'slave->offers', so we
+  // drain the set rather than iterate over a copy of it.
+  while (!slave->offers.empty()) {
+    Offer* offer = *slave->offers.begin();
+
+    allocator->resourcesRecovered(
+        offer->framework_id(), offer->slave_id(), offer->resources());
+
+    removeOffer(offer, rescind);
+  }
+}
+
+
+void Master::changed()
+{
+  version++;
+}
+
+
+void Master::changed(Framework* framework)
+{
+  CHECK_NOTNULL(framework);
+  changed();
+  framework->version = version;
+  http.changed(framework->id);
+}
+
+
+void Master::changed(Slave* slave)
+{
+  CHECK_NOTNULL(slave);
+  changed();
+  slave->version = version;
+  http.changed(slave->id);
+}
+
+
+void Master::offersChanged(Framework* framework, Slave* slave)
+{
+  CHECK_NOTNULL(framework);
+  CHECK_NOTNULL(slave);
+  changed();
+  framework->offersVersion = version;
+  slave->offersVersion = version;
+  http.changed(framework->id);
+  http.changed(slave->id);
+}
+
+
+void Master::index(Slave* slave, const FrameworkID& frameworkId)
+{
+  CHECK_NOTNULL(slave);
+
+  if (slave->tasks.contains(frameworkId) ||
+      slave->executors.contains(frameworkId)) {
+    frameworkSlaves[frameworkId].insert(slave->id);
+  } else {
+    unindex(slave, frameworkId);
+  }
+}
+
+
+void Master::unindex(Slave* slave, const FrameworkID& frameworkId)
+{
+  CHECK_NOTNULL(slave);
+
+  if (frameworkSlaves.contains(frameworkId)) {
+    frameworkSlaves[frameworkId].erase(slave->id);
+    if (frameworkSlaves[frameworkId].empty()) {
+      frameworkSlaves.erase(frameworkId);
+    }
+  }
+}
+
+
 Framework* Master::getFramework(const FrameworkID& frameworkId)
 {
   return frameworks.contains(frameworkId) ? frameworks[frameworkId] : NULL;
@@ -19,7 +19,10 @@
 #ifndef __MASTER_HPP__
 #define __MASTER_HPP__
 
+#include <algorithm>
+#include <deque>
 #include <list>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -27,6 +30,7 @@
 
 #include <mesos/resources.hpp>
 
+#include <process/future.hpp>
 #include <process/http.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
@@ -35,6 +39,7 @@
 #include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
+#include <stout/json.hpp>
 #include <stout/memory.hpp>
 #include <stout/multihashmap.hpp>
 #include <stout/option.hpp>
@@ -72,7 +77,8 @@ class Allocator;
 
 }
 
-class SlaveObserver;
+class SlaveHealthChecker;
+class SlaveReregistrar;
 class WhitelistWatcher;
 
 struct Framework;
@@ -139,6 +145,8 @@ public:
       const SlaveInfo& slaveInfo,
       const std::vector<ExecutorInfo>& executorInfos,
       const std::vector<Task>& tasks);
+  void _reregisterSlaves();
+  void readdSlaves();
   void unregisterSlave(
       const SlaveID& slaveId);
   void statusUpdate(
@@ -184,6 +192,13 @@ protected:
 
   void deactivate(Framework* framework);
 
+  // Starts authenticating the framework at 'pid' using the
+  // authenticatee at 'from'.
+  void doAuthenticate(
+      const UPID& from,
+      const UPID& pid,
+      const Owned<Promise<Nothing> >& promise);
+
   // 'promise' is used to signal finish of authentication.
   // 'future' is the future returned by the authenticator.
   void _authenticate(
@@ -240,9 +255,41 @@ protected:
   // Add a slave.
   void addSlave(Slave* slave, bool reregister = false);
 
-  void readdSlave(Slave* slave,
-		  const std::vector<ExecutorInfo>& executorInfos,
-		  const std::vector<Task>& tasks);
+  // A slave re-registering after a master failover. After a failover
+  // all of the slaves re-register at once, so they are queued up and
+  // prepared in batches off the master actor (see SlaveReregistrar)
+  // before the master re-adds them (see '_reregisterSlaves').
+  struct Reregistration
+  {
+    UPID from;
+    SlaveID slaveId;
+    SlaveInfo slaveInfo;
+
+    // As sent by the slave, cleared once prepared.
+    std::vector<ExecutorInfo> executorInfos;
+    std::vector<Task> tasks;
+
+    // The executors and the non-terminal tasks of the slave grouped
+    // by framework, along with the resources used by each framework
+    // and by all of them.
+    hashmap<FrameworkID, hashmap<ExecutorID, ExecutorInfo> > executors;
+    hashmap<FrameworkID, hashmap<TaskID, Task> > frameworkTasks;
+    hashmap<FrameworkID, Resources> resources;
+    Resources used;
+  };
+
+  void __reregisterSlaves(
+      const process::Future<std::vector<Reregistration> >& batch);
+
+  // Add a slave that re-registered after a master failover, along
+  // with its (prepared) executors and tasks.
+  void readdSlave(const Reregistration& reregistration);
+
+  // Send the latest pids of the frameworks of the given tasks to the
+  // slave.
+  void updateFrameworkPids(
+      Slave* slave,
+      const std::vector<Task>& tasks);
 
   // Lose all of a slave's tasks and delete the slave object
   void removeSlave(Slave* slave);
@@ -259,6 +306,29 @@ protected:
   // Remove an offer and optionally rescind the offer as well.
   void removeOffer(Offer* offer, bool rescind = false);
 
+  // Remove all of a framework's (or slave's) outstanding offers,
+  // recovering their resources in the allocator, and optionally
+  // rescind the offers as well.
+  void removeOffers(Framework* framework, bool rescind = false);
+  void removeOffers(Slave* slave, bool rescind = false);
+
+  // Record that the state exported over HTTP has changed, either in
+  // general or for the given framework or slave (see 'version').
+  void changed();
+  void changed(Framework* framework);
+  void changed(Slave* slave);
+
+  // Record that an offer of the framework on the slave was added or
+  // removed. Offers come and go every allocation, so they are
+  // versioned separately (see 'offersVersion'), otherwise each
+  // allocation would re-model the frameworks and slaves with offers.
+  void offersChanged(Framework* framework, Slave* slave);
+
+  // Update 'frameworkSlaves' after the framework's tasks or executors
+  // on the slave have changed, or remove the slave from it.
+  void index(Slave* slave, const FrameworkID& frameworkId);
+  void unindex(Slave* slave, const FrameworkID& frameworkId);
+
   Framework* getFramework(const FrameworkID& frameworkId);
   Slave* getSlave(const SlaveID& slaveId);
   Offer* getOffer(const OfferID& offerId);
@@ -273,7 +343,7 @@ private:
   class Http
   {
   public:
-    Http(const Master& _master) : master(_master) {}
+    Http(const Master& _master) : master(_master), cache(new Cache()) {}
 
     // /master/health
     process::Future<process::http::Response> health(
@@ -291,6 +361,10 @@ private:
     process::Future<process::http::Response> state(
         const process::http::Request& request);
 
+    // /master/state-diff.json
+    process::Future<process::http::Response> stateDiff(
+        const process::http::Request& request);
+
     // /master/roles.json
     process::Future<process::http::Response> roles(
         const process::http::Request& request);
@@ -299,19 +373,76 @@ private:
     process::Future<process::http::Response> tasks(
         const process::http::Request& request);
 
+    // Record that the given framework or slave changed (or was
+    // removed), so that it gets re-modeled on the next request.
+    void changed(const FrameworkID& frameworkId);
+    void changed(const SlaveID& slaveId);
+
     const static std::string HEALTH_HELP;
     const static std::string REDIRECT_HELP;
+    const static std::string STATE_DIFF_HELP;
     const static std::string TASKS_HELP;
 
   private:
+    // Rendered model of a framework or slave. The fields that depend
+    // on the offers are rendered separately from the rest (see
+    // Master::offersChanged), so that offers coming and going do not
+    // re-model the tasks of a framework.
+    struct Model
+    {
+      Model() : version(0), offersVersion(0) {}
+
+      // Returns the version of the most recent change to the model.
+      uint64_t latest() const { return std::max(version, offersVersion); }
+
+      // Writes the model as a JSON object.
+      void write(JSON::Writer* writer) const;
+
+      uint64_t version; // Of 'fields', see Framework::version.
+      std::string fields;
+
+      uint64_t offersVersion; // See Framework::offersVersion.
+      std::string offers;
+    };
+
+    // Rendered models of the frameworks and slaves, indexed by the
+    // version of their most recent change so that a delta only visits
+    // what changed. Only the frameworks and slaves that changed since
+    // the last request get re-modeled. The complete rendered state is
+    // kept as well, for as long as the master's state does not change.
+    struct Cache
+    {
+      Cache() : version(0) {}
+
+      hashmap<FrameworkID, Model> frameworks;
+      hashmap<FrameworkID, std::string> completedFrameworks;
+      hashmap<SlaveID, Model> slaves;
+
+      std::map<uint64_t, FrameworkID> frameworksByVersion;
+      std::map<uint64_t, SlaveID> slavesByVersion;
+
+      // Frameworks and slaves that changed since the last update.
+      hashset<FrameworkID> changedFrameworks;
+      hashset<SlaveID> changedSlaves;
+
+      uint64_t version;
+      Option<std::string> state;
+    };
+
+    // Brings the cached models up to date with the master.
+    void update();
+
     const Master& master;
+
+    // Shared because the route handlers are bound to copies of this.
+    memory::shared_ptr<Cache> cache;
   } http;
 
   Master(const Master&);              // No copying.
   Master& operator = (const Master&); // No assigning.
 
   friend struct SlaveRegistrar;
-  friend struct SlaveReregistrar;
+  friend class SlaveReregistrar;
 
   const Flags flags;
 
@@ -322,6 +453,8 @@ private:
 
   allocator::Allocator* allocator;
   WhitelistWatcher* whitelistWatcher;
+  SlaveHealthChecker* healthChecker;
+  SlaveReregistrar* reregistrar;
   Registrar* registrar;
   Files* files;
 
@@ -334,6 +467,10 @@ private:
 
   hashmap<SlaveID, Slave*> slaves;
 
+  // The slaves that have tasks or executors of each framework, so
+  // that a (re-)registering framework need not look at every slave.
+  hashmap<FrameworkID, hashset<SlaveID> > frameworkSlaves;
+
   // Ideally we could use SlaveIDs to track deactivated slaves.
   // However, we would not know when to remove the SlaveID from this
   // set. After deactivation, the same slave machine can register with
@@ -341,6 +478,16 @@ private:
   // slave PID once any slave registers with the same PID!
   hashset<UPID> deactivatedSlaves;
 
+  // Re-registrations waiting to be prepared and, once prepared,
+  // waiting to be re-added (see '_reregisterSlaves').
+  std::vector<Reregistration> reregistrations;
+  std::deque<Reregistration> prepared;
+
+  // The slaves that are being re-registered, i.e., that are queued
+  // up, being prepared, or prepared but not yet re-added, along with
+  // the pid they last re-registered from (at which they get re-added).
+  hashmap<SlaveID, UPID> reregistering;
+
   hashmap<OfferID, Offer*> offers;
 
   hashmap<std::string, Role*> roles;
@@ -352,11 +499,32 @@ private:
 
   hashmap<UPID, Owned<sasl::Authenticator> > authenticators;
 
+  // Authentications that wait for an authenticator, since
+  // MAX_CONCURRENT_AUTHENTICATIONS are already in progress. They get
+  // started in the order they were requested.
+  struct QueuedAuthentication
+  {
+    UPID from; // The authenticatee.
+    Owned<Promise<Nothing> > promise;
+  };
+
+  std::deque<UPID> authenticationQueue;
+  hashmap<UPID, QueuedAuthentication> queuedAuthentications;
+
   // Authenticated frameworks keyed by framework's PID.
   hashset<UPID> authenticated;
 
   boost::circular_buffer<memory::shared_ptr<Framework> > completedFrameworks;
 
+  // Version of the state exported over HTTP, incremented on every
+  // change to it. Each framework and slave also records the version
+  // it last changed at (see Master::changed).
+  uint64_t version;
+
+  // Slaves removed from the master along with the version at which
+  // they were removed, used to compute state deltas.
+  boost::circular_buffer<std::pair<uint64_t, SlaveID> > removedSlaves;
+
   int64_t nextFrameworkId; // Used to give each framework a unique ID.
   int64_t nextOfferId;     // Used to give each slot offer a unique ID.
   int64_t nextSlaveId;     // Used to give each slave a unique ID.
@@ -387,7 +555,17 @@ struct Slave
       registeredTime(time),
       lastHeartbeat(time),
       disconnected(false),
-      observer(NULL) {}
+      version(0),
+      offersVersion(0)
+  {
+    // 'info' is fixed for the lifetime of this object (a slave that
+    // re-registers keeps its original info, and a failed over master
+    // creates a new Slave), so the attributes are serialized once
+    // here rather than copied into every offer for this slave.
+    Offer offer;
+    offer.mutable_attributes()->MergeFrom(info.attributes());
+    offer.SerializePartialToString(&attributes);
+  }
 
   ~Slave() {}
 
@@ -487,6 +665,10 @@ struct Slave
   const SlaveID id;
   const SlaveInfo info;
 
+  // The 'attributes' of 'info' as serialized Offer fields, appended
+  // to each offer sent for this slave (see Master::offer).
+  std::string attributes;
+
   UPID pid;
 
   Time registeredTime;
@@ -500,6 +682,9 @@ struct Slave
   Resources resourcesOffered; // Resources offered.
   Resources resourcesInUse;   // Resources used by tasks and executors.
 
+  uint64_t version; // See Master::changed.
+  uint64_t offersVersion; // See Master::offersChanged.
+
   // Executors running on this slave.
   hashmap<FrameworkID, hashmap<ExecutorID, ExecutorInfo> > executors;
 
@@ -516,8 +701,6 @@ struct Slave
   // Active offers on this slave.
   hashset<Offer*> offers;
 
-  SlaveObserver* observer;
-
 private:
   Slave(const Slave&);              // No copying.
   Slave& operator = (const Slave&); // No assigning.
@@ -537,7 +720,9 @@ struct Framework
       active(true),
       registeredTime(time),
       reregisteredTime(time),
-      completedTasks(MAX_COMPLETED_TASKS_PER_FRAMEWORK) {}
+      completedTasks(MAX_COMPLETED_TASKS_PER_FRAMEWORK),
+      version(0),
+      offersVersion(0) {}
 
   ~Framework() {}
 
@@ -576,6 +761,7 @@ struct Framework
     CHECK(!offers.contains(offer)) << "Duplicate offer " << offer->id();
     offers.insert(offer);
     resources += offer->resources();
+    resourcesOffered += offer->resources();
   }
 
   void removeOffer(Offer* offer)
@@ -585,6 +771,7 @@ struct Framework
 
     offers.erase(offer);
     resources -= offer->resources();
+    resourcesOffered -= offer->resources();
   }
 
   bool hasExecutor(const SlaveID& slaveId,
@@ -643,8 +830,13 @@ struct Framework
 
   Resources resources; // Total resources (tasks + offers + executors).
 
+  Resources resourcesOffered; // Resources in active offers.
+
   hashmap<SlaveID, hashmap<ExecutorID, ExecutorInfo> > executors;
 
+  uint64_t version; // See Master::changed.
+  uint64_t offersVersion; // See Master::offersChanged.
+
 private:
   Framework(const Framework&);              // No copying.
   Framework& operator = (const Framework&); // No assigning.
@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <deque>
 #include <string>
 
@@ -24,6 +25,8 @@
 #include <process/future.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/lambda.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
@@ -31,6 +34,7 @@
 
 #include "common/type_utils.hpp"
 
+#include "master/constants.hpp"
 #include "master/registrar.hpp"
 #include "master/registry.hpp"
 
@@ -60,6 +64,9 @@ public:
       state(_state)
   {
     slaves.variable = None();
+    slaves.changes = None();
+    slaves.sequence = 0;
+    slaves.compacted = 0;
     slaves.updating = false;
   }
 
@@ -71,32 +78,39 @@ public:
   Future<bool> remove(const SlaveInfo& info);
 
 private:
-  template <typename T>
+  typedef hashmap<SlaveID, registry::Slave> Index;
+
   struct Mutation : process::Promise<bool>
   {
-    virtual Try<T> apply(T t) = 0;
+    virtual ~Mutation() {}
+
+    // Applies the mutation to the index of the slaves and returns the
+    // change that needs to be stored, if any. A mutation that does
+    // not change the slaves sets its own result.
+    virtual Option<registry::Change> apply(Index* index) = 0;
   };
 
-  struct Admit : Mutation<registry::Slaves>
+  struct Admit : Mutation
   {
     Admit(const SlaveID& _id, const SlaveInfo& _info)
       : id(_id), info(_info) {}
 
-    virtual Try<registry::Slaves> apply(registry::Slaves slaves)
+    virtual Option<registry::Change> apply(Index* index)
     {
       // Check and see if this slave already exists.
-      foreach (const registry::Slave& slave, slaves.slaves()) {
-        if (slave.info().id() == id) {
-          set(false);
-          return slaves; // No mutation.
-        }
+      if (index->contains(id)) {
+        set(false);
+        return None(); // No mutation.
       }
 
       // Okay, add the slave!
-      registry::Slave* slave = slaves.add_slaves();
+      registry::Change change;
+      registry::Slave* slave = change.mutable_admitted();
       slave->mutable_info()->CopyFrom(info);
       slave->mutable_info()->mutable_id()->MergeFrom(id);
-      return slaves;
+
+      (*index)[id] = *slave;
+      return change;
     }
 
     const SlaveID id;
@@ -106,58 +120,54 @@ private:
   // NOTE: even thought readmission does not mutate the state we model
   // it as a mutation so that it is performed in sequence with other
   // mutations.
-  struct Readmit : Mutation<registry::Slaves>
+  struct Readmit : Mutation
   {
     Readmit(const SlaveInfo& _info) : info(_info) { CHECK(info.has_id()); }
 
-    virtual Try<registry::Slaves> apply(registry::Slaves slaves)
+    virtual Option<registry::Change> apply(Index* index)
     {
-      bool found = false;
-      foreach (const registry::Slave& slave, slaves.slaves()) {
-        if (slave.info().id() == info.id()) {
-          set(true);
-          found = true;
-        }
-      }
-      if (!found) {
-        set(false);
-      }
-      return slaves;
+      set(index->contains(info.id()));
+      return None();
     }
 
     const SlaveInfo info;
   };
 
-  struct Remove : Mutation<registry::Slaves>
+  struct Remove : Mutation
   {
     Remove(const SlaveInfo& _info) : info(_info) { CHECK(info.has_id()); }
 
-    virtual Try<registry::Slaves> apply(registry::Slaves slaves)
+    virtual Option<registry::Change> apply(Index* index)
     {
-      bool removed = false;
-      for (int i = 0; i < slaves.slaves().size(); i++) {
-        const registry::Slave& slave = slaves.slaves(i);
-        if (slave.info().id() == info.id()) {
-          for (int j = i + 1; j < slaves.slaves().size(); j++) {
-            slaves.mutable_slaves()->SwapElements(i, j);
-          }
-          slaves.mutable_slaves()->RemoveLast();
-          removed = true;
-          break;
-        }
-      }
-      if (!removed) {
+      if (!index->contains(info.id())) {
         set(false);
+        return None(); // No mutation.
       }
-      return slaves; // May or may not have been mutated.
+
+      index->erase(info.id());
+
+      registry::Change change;
+      change.mutable_removed()->CopyFrom(info.id());
+      return change;
     }
 
     const SlaveInfo info;
   };
 
+  // The slaves are stored as the 'slaves' variable plus the 'changes'
+  // made since, so the cost of storing a mutation does not depend on
+  // the number of slaves. Once there are more than
+  // MAX_REGISTRY_CHANGES changes all of the slaves are stored again
+  // (i.e., the changes are compacted). The changes that a stored
+  // 'slaves' reflects are identified by its sequence number, so that
+  // the stored changes can be truncated afterwards.
   struct {
     Option<Variable<registry::Slaves> > variable;
-    std::deque<Mutation<registry::Slaves>*> mutations;
+    Option<Variable<registry::Changes> > changes;
+    Index index; // The stored slaves with all of the changes applied.
+    uint64_t sequence; // Of the last change.
+    uint64_t compacted; // Of the last change the stored slaves reflect.
+    std::deque<Mutation*> mutations;
     bool updating; // Used to signify fetching (recovering) or storing.
   } slaves;
 
@@ -169,12 +179,21 @@ private:
   // Helper for recovering state (performing fetch).
   Future<Nothing> recover();
   void _recover(const Future<Variable<registry::Slaves> >& recovery);
+  void __recover(const Future<Variable<registry::Changes> >& recovery);
+
+  // Helper for (re)building the index from the stored slaves and
+  // changes.
+  void index();
 
   // Helper for updating state (performing store).
   void update();
-  Future<bool> _update(const Option<Variable<registry::Slaves> >& variable);
+  Future<bool> _update(const Option<Variable<registry::Changes> >& variable);
   void __update();
 
+  // Helpers for compacting the changes (storing all of the slaves).
+  Future<bool> compact(const Option<Variable<registry::Slaves> >& variable);
+  void _compact(const Future<Option<Variable<registry::Changes> > >& future);
+
   State* state;
 
   // Used to compose our operations with recovery.
@@ -188,6 +207,8 @@ Future<Nothing> RegistrarProcess::recover()
 
   // "Recover" the 'slaves' variable by fetching it from the state.
   if (slaves.variable.isNone() && !slaves.updating) {
+    slaves.updating = true;
+
     state->fetch<registry::Slaves>("slaves")
       .onAny(defer(self(), &Self::_recover, lambda::_1));
 
@@ -203,20 +224,45 @@ Future<Nothing> RegistrarProcess::recover()
 void RegistrarProcess::_recover(
     const Future<Variable<registry::Slaves> >& recovery)
 {
-  slaves.updating = false;
+  CHECK(!recovery.isPending());
+
+  if (recovery.isFailed() || recovery.isDiscarded()) {
+    LOG(WARNING)
+      << "Failed to recover registrar: "
+      << (recovery.isFailed() ? recovery.failure() : "future discarded");
+    slaves.updating = false;
+    recover(); // Retry! TODO(benh): Don't retry forever?
+  } else {
+    // Save the slaves variable and fetch the changes made since.
+    slaves.variable = recovery.get();
+
+    state->fetch<registry::Changes>("changes")
+      .onAny(defer(self(), &Self::__recover, lambda::_1));
+  }
+}
+
 
+void RegistrarProcess::__recover(
+    const Future<Variable<registry::Changes> >& recovery)
+{
   CHECK(!recovery.isPending());
 
   if (recovery.isFailed() || recovery.isDiscarded()) {
     LOG(WARNING)
       << "Failed to recover registrar: "
       << (recovery.isFailed() ? recovery.failure() : "future discarded");
+    slaves.variable = None();
+    slaves.updating = false;
     recover(); // Retry! TODO(benh): Don't retry forever?
   } else {
     LOG(INFO) << "Successfully recovered registrar";
 
-    // Save the slaves variable.
-    slaves.variable = recovery.get();
+    slaves.updating = false;
+
+    // Save the changes variable.
+    slaves.changes = recovery.get();
+
+    index();
 
     // Signal the recovery is complete.
     recovered.set(Nothing());
@@ -224,6 +270,47 @@ void RegistrarProcess::_recover(
 }
 
 
+void RegistrarProcess::index()
+{
+  CHECK_SOME(slaves.variable);
+  CHECK_SOME(slaves.changes);
+
+  slaves.index.clear();
+
+  const registry::Slaves& stored = slaves.variable.get().get();
+
+  foreach (const registry::Slave& slave, stored.slaves()) {
+    slaves.index[slave.info().id()] = slave;
+  }
+
+  slaves.compacted = stored.sequence();
+  slaves.sequence = std::max(slaves.sequence, slaves.compacted);
+
+  // Apply the changes that the stored slaves do not reflect yet, in
+  // order. Changes that the stored slaves do reflect are left behind
+  // if storing all of the slaves was not followed by truncating the
+  // changes.
+  const registry::Changes& changes = slaves.changes.get().get();
+
+  foreach (const registry::Change& change, changes.changes()) {
+    if (change.sequence() <= slaves.compacted) {
+      continue;
+    }
+
+    if (change.has_admitted()) {
+      const registry::Slave& slave = change.admitted();
+      slaves.index[slave.info().id()] = slave;
+    }
+
+    if (change.has_removed()) {
+      slaves.index.erase(change.removed());
+    }
+
+    slaves.sequence = std::max(slaves.sequence, change.sequence());
+  }
+}
+
+
 Future<bool> RegistrarProcess::admit(
     const SlaveID& id,
     const SlaveInfo& info)
@@ -238,7 +325,7 @@ Future<bool> RegistrarProcess::_admit(
     const SlaveInfo& info)
 {
   CHECK_SOME(slaves.variable);
-  Mutation<registry::Slaves>* mutation = new Admit(id, info);
+  Mutation* mutation = new Admit(id, info);
   slaves.mutations.push_back(mutation);
   Future<bool> future = mutation->future();
   if (!slaves.updating) {
@@ -264,7 +351,7 @@ Future<bool> RegistrarProcess::_readmit(
     return Failure("Expecting SlaveInfo to have a SlaveID");
   }
 
-  Mutation<registry::Slaves>* mutation = new Readmit(info);
+  Mutation* mutation = new Readmit(info);
   slaves.mutations.push_back(mutation);
   Future<bool> future = mutation->future();
   if (!slaves.updating) {
@@ -290,7 +377,7 @@ Future<bool> RegistrarProcess::_remove(
     return Failure("Expecting SlaveInfo to have a SlaveID");
   }
 
-  Mutation<registry::Slaves>* mutation = new Remove(info);
+  Mutation* mutation = new Remove(info);
   slaves.mutations.push_back(mutation);
   Future<bool> future = mutation->future();
   if (!slaves.updating) {
@@ -305,32 +392,65 @@ void RegistrarProcess::update()
   if (!slaves.mutations.empty()) {
     CHECK(!slaves.updating);
 
-    slaves.updating = true;
+    CHECK_SOME(slaves.variable);
+    CHECK_SOME(slaves.changes);
 
-    LOG(INFO) << "Attempting to update 'slaves'";
+    // Start from the stored changes that the stored slaves do not
+    // reflect yet.
+    const registry::Changes& stored = slaves.changes.get().get();
 
-    CHECK_SOME(slaves.variable);
+    registry::Changes changes;
+    foreach (const registry::Change& change, stored.changes()) {
+      if (change.sequence() > slaves.compacted) {
+        changes.add_changes()->CopyFrom(change);
+      }
+    }
+
+    // Apply the mutations to the index, which is rebuilt in case the
+    // store fails (see '__update').
+    bool changed = false;
+    foreach (Mutation* mutation, slaves.mutations) {
+      Option<registry::Change> change = mutation->apply(&slaves.index);
+      if (change.isSome()) {
+        registry::Change* added = changes.add_changes();
+        added->CopyFrom(change.get());
+        added->set_sequence(++slaves.sequence);
+        changed = true;
+      }
+    }
 
-    Variable<registry::Slaves> variable = slaves.variable.get();
-
-    foreach (Mutation<registry::Slaves>* mutation, slaves.mutations) {
-      Try<registry::Slaves> slaves = mutation->apply(variable.get());
-      if (slaves.isError()) {
-        mutation->fail("Failed to mutate 'slaves': " + slaves.error());
-      } else {
-        Try<Variable<registry::Slaves> > v = variable.mutate(slaves.get());
-        if (v.isError()) {
-          mutation->fail("Failed to mutate 'slaves': " + v.error());
-        } else {
-          variable = v.get();
-        }
+    if (!changed) {
+      // Nothing to store, all of the mutations have their results.
+      while (!slaves.mutations.empty()) {
+        delete slaves.mutations.front();
+        slaves.mutations.pop_front();
       }
+      return;
     }
 
-    // Perform the store! Save the future so we can associate it with
-    // the mutations that are part of this update.
-    Future<bool> future =
-      state->store(variable).then(defer(self(), &Self::_update, lambda::_1));
+    slaves.updating = true;
+
+    Future<bool> future;
+
+    if (changes.changes_size() > (int) MAX_REGISTRY_CHANGES) {
+      LOG(INFO) << "Attempting to update 'slaves'";
+
+      registry::Slaves stored;
+      foreachvalue (const registry::Slave& slave, slaves.index) {
+        stored.add_slaves()->CopyFrom(slave);
+      }
+      stored.set_sequence(slaves.sequence);
+
+      // Perform the store! Save the future so we can associate it
+      // with the mutations that are part of this update.
+      future = state->store(slaves.variable.get().mutate(&stored))
+        .then(defer(self(), &Self::compact, lambda::_1));
+    } else {
+      LOG(INFO) << "Attempting to update 'changes'";
+
+      future = state->store(slaves.changes.get().mutate(&changes))
+        .then(defer(self(), &Self::_update, lambda::_1));
+    }
 
     // TODO(benh): Add a timeout so we don't wait forever.
 
@@ -341,9 +461,9 @@ void RegistrarProcess::update()
 
     // Now associate the store with all the mutations.
     while (!slaves.mutations.empty()) {
-      Mutation<registry::Slaves>* mutation = slaves.mutations.front();
+      Mutation* mutation = slaves.mutations.front();
       slaves.mutations.pop_front();
-      mutation->associate(future); // No-op if already failed above.
+      mutation->associate(future); // No-op if already set above.
       delete mutation;
     }
   }
@@ -351,10 +471,41 @@ void RegistrarProcess::update()
 
 
 Future<bool> RegistrarProcess::_update(
-    const Option<Variable<registry::Slaves> >& variable)
+    const Option<Variable<registry::Changes> >& variable)
+{
+  if (variable.isNone()) {
+    LOG(WARNING) << "Failed to update 'changes': version mismatch";
+    return Failure("Failed to update 'changes': version mismatch");
+  }
+
+  LOG(INFO) << "Successfully updated 'changes'";
+
+  slaves.updating = false;
+
+  slaves.changes = variable.get();
+
+  if (!slaves.mutations.empty()) {
+    update();
+  }
+
+  return true;
+}
+
+
+void RegistrarProcess::__update()
 {
+  LOG(WARNING) << "Failed to update 'slaves'";
+
+  // Undo the mutations that did not get stored.
+  index();
+
   slaves.updating = false;
+}
+
 
+Future<bool> RegistrarProcess::compact(
+    const Option<Variable<registry::Slaves> >& variable)
+{
   if (variable.isNone()) {
     LOG(WARNING) << "Failed to update 'slaves': version mismatch";
     return Failure("Failed to update 'slaves': version mismatch");
@@ -363,19 +514,35 @@ Future<bool> RegistrarProcess::_update(
   LOG(INFO) << "Successfully updated 'slaves'";
 
   slaves.variable = variable.get();
+  slaves.compacted = slaves.sequence;
 
-  if (!slaves.mutations.empty()) {
-    update();
-  }
+  // The stored slaves now reflect all of the changes, so truncate
+  // them. The mutations do not need to wait for this, since the
+  // changes are ignored during recovery either way.
+  state->store(slaves.changes.get().mutate(registry::Changes()))
+    .onAny(defer(self(), &Self::_compact, lambda::_1));
 
   return true;
 }
 
 
-void RegistrarProcess::__update()
+void RegistrarProcess::_compact(
+    const Future<Option<Variable<registry::Changes> > >& future)
 {
-  LOG(WARNING) << "Failed to update 'slaves'";
+  if (!future.isReady() || future.get().isNone()) {
+    LOG(WARNING) << "Failed to truncate 'changes': "
+                 << (future.isFailed() ? future.failure() :
+                     future.isDiscarded() ? "future discarded" :
+                     "version mismatch");
+  } else {
+    slaves.changes = future.get().get();
+  }
+
   slaves.updating = false;
+
+  if (!slaves.mutations.empty()) {
+    update();
+  }
 }
 
 
@@ -10,7 +10,8 @@ namespace internal {
 namespace sasl {
 
 // Storage for the static members.
-Multimap<string, Property> InMemoryAuxiliaryPropertyPlugin::properties;
+InMemoryAuxiliaryPropertyPlugin::Index
+  InMemoryAuxiliaryPropertyPlugin::properties;
 sasl_auxprop_plug_t InMemoryAuxiliaryPropertyPlugin::plugin;
 
 
@@ -22,9 +22,11 @@
 #include <sasl/sasl.h>
 #include <sasl/saslplug.h>
 
+#include <list>
 #include <string>
 
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/multimap.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
@@ -47,18 +49,29 @@ public:
 
   static void load(const Multimap<std::string, Property>& _properties)
   {
-    properties = _properties;
+    // The properties get looked up on every authentication, so we
+    // index them by user and property name up front. Like before,
+    // the first property with a given name wins.
+    properties.clear();
+
+    foreachpair (const std::string& user,
+                 const Property& property,
+                 _properties) {
+      if (!properties[user].contains(property.name)) {
+        properties[user][property.name] = property.values;
+      }
+    }
   }
 
   static Option<std::list<std::string> > lookup(
       const std::string& user,
       const std::string& name)
   {
-    if (properties.contains(user)) {
-      foreach (const Property& property, properties.get(user)) {
-        if (property.name == name) {
-          return property.values;
-        }
+    Index::const_iterator i = properties.find(user);
+    if (i != properties.end()) {
+      Values::const_iterator j = i->second.find(name);
+      if (j != i->second.end()) {
+        return j->second;
       }
     }
     return None();
@@ -84,7 +97,13 @@ private:
       const char* user,
       unsigned length);
 
-  static Multimap<std::string, Property> properties;
+  // Property values by property name.
+  typedef hashmap<std::string, std::list<std::string> > Values;
+
+  // Property values by user.
+  typedef hashmap<std::string, Values> Index;
+
+  static Index properties;
 
   static sasl_auxprop_plug_t plugin;
 };
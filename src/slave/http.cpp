@@ -36,6 +36,7 @@
 
 #include "common/attributes.hpp"
 #include "common/build.hpp"
+#include "common/http.hpp"
 #include "common/type_utils.hpp"
 
 #include "slave/slave.hpp"
@@ -161,20 +162,6 @@ JSON::Object model(const ExecutorInfo& executorInfo)
 }
 
 
-JSON::Object model(const Task& task)
-{
-  JSON::Object object;
-  object.values["id"] = task.task_id().value();
-  object.values["name"] = task.name();
-  object.values["executor_id"] = task.executor_id().value();
-  object.values["framework_id"] = task.framework_id().value();
-  object.values["slave_id"] = task.slave_id().value();
-  object.values["state"] = TaskState_Name(task.state());
-  object.values["resources"] = model(task.resources());
-  return object;
-}
-
-
 JSON::Object model(const TaskInfo& task)
 {
   JSON::Object object;
@@ -195,31 +182,50 @@ JSON::Object model(const TaskInfo& task)
 }
 
 
-JSON::Object model(const Executor& executor)
+// Writes a JSON object modeled on a Task.
+void json(JSON::Writer* writer, const Task& task)
 {
-  JSON::Object object;
-  object.values["id"] = executor.id.value();
-  object.values["name"] = executor.info.name();
-  object.values["source"] = executor.info.source();
-  object.values["uuid"] = executor.uuid.toString();
-  object.values["directory"] = executor.directory;
-  object.values["resources"] = model(executor.resources);
-
-  JSON::Array tasks;
+  writer->beginObject();
+  writer->field("id", task.task_id().value());
+  writer->field("name", task.name());
+  writer->field("executor_id", task.executor_id().value());
+  writer->field("framework_id", task.framework_id().value());
+  writer->field("slave_id", task.slave_id().value());
+  writer->field("state", TaskState_Name(task.state()));
+  writer->field("resources", model(task.resources()));
+  writer->endObject();
+}
+
+
+// Writes a JSON object modeled on an Executor.
+void json(JSON::Writer* writer, const Executor& executor)
+{
+  writer->beginObject();
+  writer->field("id", executor.id.value());
+  writer->field("name", executor.info.name());
+  writer->field("source", executor.info.source());
+  writer->field("uuid", executor.uuid.toString());
+  writer->field("directory", executor.directory);
+  writer->field("resources", model(executor.resources));
+
+  writer->key("tasks");
+  writer->beginArray();
   foreach (Task* task, executor.launchedTasks.values()) {
-    tasks.values.push_back(model(*task));
+    json(writer, *task);
   }
-  object.values["tasks"] = tasks;
+  writer->endArray();
 
-  JSON::Array queued;
+  writer->key("queued_tasks");
+  writer->beginArray();
   foreach (const TaskInfo& task, executor.queuedTasks.values()) {
-    queued.values.push_back(model(task));
+    writer->value(model(task));
   }
-  object.values["queued_tasks"] = queued;
+  writer->endArray();
 
-  JSON::Array completed;
+  writer->key("completed_tasks");
+  writer->beginArray();
   foreach (const memory::shared_ptr<Task>& task, executor.completedTasks) {
-    completed.values.push_back(model(*task));
+    json(writer, *task);
   }
 
   // NOTE: We add 'terminatedTasks' to 'completed_tasks' for
@@ -227,38 +233,40 @@ JSON::Object model(const Executor& executor)
   // TODO(vinod): Use foreachvalue instead once LinkedHashmap
   // supports it.
   foreach (Task* task, executor.terminatedTasks.values()) {
-    completed.values.push_back(model(*task));
+    json(writer, *task);
   }
-  object.values["completed_tasks"] = completed;
+  writer->endArray();
 
-  return object;
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled after a Framework.
-JSON::Object model(const Framework& framework)
+// Writes a JSON object modeled after a Framework.
+void json(JSON::Writer* writer, const Framework& framework)
 {
-  JSON::Object object;
-  object.values["id"] = framework.id.value();
-  object.values["name"] = framework.info.name();
-  object.values["user"] = framework.info.user();
-  object.values["failover_timeout"] = framework.info.failover_timeout();
-  object.values["checkpoint"] = framework.info.checkpoint();
-  object.values["role"] = framework.info.role();
-
-  JSON::Array executors;
+  writer->beginObject();
+  writer->field("id", framework.id.value());
+  writer->field("name", framework.info.name());
+  writer->field("user", framework.info.user());
+  writer->field("failover_timeout", framework.info.failover_timeout());
+  writer->field("checkpoint", framework.info.checkpoint());
+  writer->field("role", framework.info.role());
+
+  writer->key("executors");
+  writer->beginArray();
   foreachvalue (Executor* executor, framework.executors) {
-    executors.values.push_back(model(*executor));
+    json(writer, *executor);
   }
-  object.values["executors"] = executors;
+  writer->endArray();
 
-  JSON::Array completedExecutors;
+  writer->key("completed_executors");
+  writer->beginArray();
   foreach (const Owned<Executor>& executor, framework.completedExecutors) {
-    completedExecutors.values.push_back(model(*executor));
+    json(writer, *executor);
   }
-  object.values["completed_executors"] = completedExecutors;
+  writer->endArray();
 
-  return object;
+  writer->endObject();
 }
 
 
@@ -304,70 +312,81 @@ Future<Response> Slave::Http::state(const Request& request)
 {
   LOG(INFO) << "HTTP request for '" << request.path << "'";
 
-  JSON::Object object;
-  object.values["version"] = MESOS_VERSION;
+  // The state is streamed into the body rather than modeled as a
+  // JSON::Object first, since a slave can have many (completed)
+  // executors and tasks.
+  std::ostringstream out;
+  JSON::Writer writer(&out);
+
+  writer.beginObject();
+  writer.field("version", MESOS_VERSION);
 
   if (build::GIT_SHA.isSome()) {
-    object.values["git_sha"] = build::GIT_SHA.get();
+    writer.field("git_sha", build::GIT_SHA.get());
   }
 
   if (build::GIT_BRANCH.isSome()) {
-    object.values["git_branch"] = build::GIT_BRANCH.get();
+    writer.field("git_branch", build::GIT_BRANCH.get());
   }
 
   if (build::GIT_TAG.isSome()) {
-    object.values["git_tag"] = build::GIT_TAG.get();
+    writer.field("git_tag", build::GIT_TAG.get());
   }
 
-  object.values["build_date"] = build::DATE;
-  object.values["build_time"] = build::TIME;
-  object.values["build_user"] = build::USER;
-  object.values["start_time"] = slave.startTime.secs();
-  object.values["id"] = slave.info.id().value();
-  object.values["pid"] = string(slave.self());
-  object.values["hostname"] = slave.info.hostname();
-  object.values["resources"] = model(slave.resources);
-  object.values["attributes"] = model(slave.attributes);
-  object.values["staged_tasks"] = slave.stats.tasks[TASK_STAGING];
-  object.values["started_tasks"] = slave.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = slave.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = slave.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = slave.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = slave.stats.tasks[TASK_LOST];
+  writer.field("build_date", build::DATE);
+  writer.field("build_time", build::TIME);
+  writer.field("build_user", build::USER);
+  writer.field("start_time", slave.startTime.secs());
+  writer.field("id", slave.info.id().value());
+  writer.field("pid", string(slave.self()));
+  writer.field("hostname", slave.info.hostname());
+  writer.field("resources", model(slave.resources));
+  writer.field("attributes", model(slave.attributes));
+  writer.field("staged_tasks", slave.stats.tasks[TASK_STAGING]);
+  writer.field("started_tasks", slave.stats.tasks[TASK_STARTING]);
+  writer.field("finished_tasks", slave.stats.tasks[TASK_FINISHED]);
+  writer.field("killed_tasks", slave.stats.tasks[TASK_KILLED]);
+  writer.field("failed_tasks", slave.stats.tasks[TASK_FAILED]);
+  writer.field("lost_tasks", slave.stats.tasks[TASK_LOST]);
 
   if (slave.master.isSome()) {
     Try<string> masterHostname = net::getHostname(slave.master.get().ip);
     if (masterHostname.isSome()) {
-      object.values["master_hostname"] = masterHostname.get();
+      writer.field("master_hostname", masterHostname.get());
     }
   }
 
   if (slave.flags.log_dir.isSome()) {
-    object.values["log_dir"] = slave.flags.log_dir.get();
+    writer.field("log_dir", slave.flags.log_dir.get());
   }
 
-  JSON::Array frameworks;
+  writer.key("frameworks");
+  writer.beginArray();
   foreachvalue (Framework* framework, slave.frameworks) {
-    frameworks.values.push_back(model(*framework));
+    json(&writer, *framework);
   }
-  object.values["frameworks"] = frameworks;
+  writer.endArray();
 
-  JSON::Array completedFrameworks;
+  writer.key("completed_frameworks");
+  writer.beginArray();
   foreach (const Owned<Framework>& framework, slave.completedFrameworks) {
-    completedFrameworks.values.push_back(model(*framework));
+    json(&writer, *framework);
   }
-  object.values["completed_frameworks"] = completedFrameworks;
+  writer.endArray();
 
-  JSON::Object flags;
+  writer.key("flags");
+  writer.beginObject();
   foreachpair (const string& name, const flags::Flag& flag, slave.flags) {
     Option<string> value = flag.stringify(slave.flags);
     if (value.isSome()) {
-      flags.values[name] = value.get();
+      writer.field(name, value.get());
     }
   }
-  object.values["flags"] = flags;
+  writer.endObject();
 
-  return OK(object, request.query.get("jsonp"));
+  writer.endObject();
+
+  return internal::http::json(out.str(), request.query.get("jsonp"));
 }
 
 } // namespace slave {
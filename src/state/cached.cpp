@@ -0,0 +1,184 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <string>
+
+#include <process/defer.hpp>
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+
+#include <stout/check.hpp>
+#include <stout/lambda.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/uuid.hpp>
+
+#include "messages/state.hpp"
+
+#include "state/cached.hpp"
+#include "state/storage.hpp"
+
+using namespace process;
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+// The maximum number of entries to keep in memory.
+static const size_t CACHED_ENTRIES = 1024;
+
+
+CachedStorageProcess::CachedStorageProcess(Storage* _storage)
+  : ProcessBase(ID::generate("cached-storage")),
+    storage(_storage),
+    entries(CACHED_ENTRIES) {}
+
+
+CachedStorageProcess::~CachedStorageProcess() {}
+
+
+Future<Option<Entry> > CachedStorageProcess::get(const string& name)
+{
+  Option<Option<Entry> > entry = entries.get(name);
+
+  if (entry.isSome()) {
+    return entry.get();
+  }
+
+  // Watch before getting, so that any change after the get is noticed.
+  Future<Nothing> watched = storage->watch(name);
+
+  fetching[name].fetches++;
+
+  return storage->get(name)
+    .onFailed(defer(self(), &Self::fetched, name))
+    .onDiscarded(defer(self(), &Self::fetched, name))
+    .then(defer(self(),
+                &Self::_get,
+                name,
+                fetching[name].generation,
+                watched,
+                lambda::_1));
+}
+
+
+Option<Entry> CachedStorageProcess::_get(
+    const string& name,
+    uint64_t generation,
+    const Future<Nothing>& watched,
+    const Option<Entry>& entry)
+{
+  CHECK(fetching.contains(name));
+
+  if (fetching[name].generation == generation) {
+    cache(name, entry, watched);
+  }
+
+  fetched(name);
+
+  return entry;
+}
+
+
+void CachedStorageProcess::fetched(const string& name)
+{
+  CHECK(fetching.contains(name));
+
+  if (--fetching[name].fetches == 0) {
+    fetching.erase(name);
+  }
+}
+
+
+Future<bool> CachedStorageProcess::set(const Entry& entry, const UUID& uuid)
+{
+  Future<Nothing> watched = storage->watch(entry.name());
+
+  // NOTE: We only satisfy the returned future once the cache got
+  // updated, so that a fetch after a store sees the stored entry.
+  // On failure we don't know whether the entry got changed, so we
+  // invalidate it before the failure gets propagated.
+  return storage->set(entry, uuid)
+    .onFailed(defer(self(), &Self::invalidate, entry.name()))
+    .then(defer(self(), &Self::_set, entry, watched, lambda::_1));
+}
+
+
+bool CachedStorageProcess::_set(
+    const Entry& entry,
+    const Future<Nothing>& watched,
+    bool set)
+{
+  invalidate(entry.name());
+
+  if (set) {
+    cache(entry.name(), entry, watched);
+  }
+
+  return set;
+}
+
+
+Future<bool> CachedStorageProcess::expunge(const Entry& entry)
+{
+  return storage->expunge(entry)
+    .onFailed(defer(self(), &Self::invalidate, entry.name()))
+    .then(defer(self(), &Self::_expunge, entry.name(), lambda::_1));
+}
+
+
+bool CachedStorageProcess::_expunge(const string& name, bool expunged)
+{
+  invalidate(name);
+  return expunged;
+}
+
+
+void CachedStorageProcess::cache(
+    const string& name,
+    const Option<Entry>& entry,
+    const Future<Nothing>& watched)
+{
+  // The entry might have been changed by someone else already.
+  if (!watched.isPending()) {
+    return;
+  }
+
+  entries.put(name, entry);
+
+  watched.onReady(defer(self(), &Self::invalidate, name));
+}
+
+
+void CachedStorageProcess::invalidate(const string& name)
+{
+  entries.erase(name);
+
+  if (fetching.contains(name)) {
+    fetching[name].generation++;
+  }
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,192 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STATE_CACHED_HPP__
+#define __STATE_CACHED_HPP__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include <stout/cache.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/uuid.hpp>
+
+#include "messages/state.hpp"
+
+#include "state/storage.hpp"
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+// Forward declarations.
+class CachedStorageProcess;
+
+
+// A storage that keeps the latest entries of another storage in
+// memory (up to a number of them), so that fetching a variable
+// repeatedly doesn't go to the (possibly remote) storage every
+// time. A cached entry gets invalidated when the variable gets set
+// or expunged through this storage, or when the underlying storage
+// reports that someone else might have changed it (see
+// Storage::watch). Sets and expunges always go to the underlying
+// storage, which performs the actual test-and-set.
+class CachedStorage : public Storage
+{
+public:
+  // Note that the underlying storage is not owned.
+  explicit CachedStorage(Storage* storage);
+  virtual ~CachedStorage();
+
+  // Storage implementation.
+  virtual process::Future<Option<Entry> > get(const std::string& name);
+  virtual process::Future<bool> set(const Entry& entry, const UUID& uuid);
+  virtual process::Future<bool> expunge(const Entry& entry);
+  virtual process::Future<std::vector<std::string> > names();
+  virtual process::Future<Nothing> watch(const std::string& name);
+
+private:
+  Storage* storage;
+  CachedStorageProcess* process;
+};
+
+
+class CachedStorageProcess : public process::Process<CachedStorageProcess>
+{
+public:
+  explicit CachedStorageProcess(Storage* storage);
+  virtual ~CachedStorageProcess();
+
+  // Storage implementation (except for 'names' and 'watch' which go
+  // to the underlying storage directly).
+  process::Future<Option<Entry> > get(const std::string& name);
+  process::Future<bool> set(const Entry& entry, const UUID& uuid);
+  process::Future<bool> expunge(const Entry& entry);
+
+private:
+  // Caches the entry unless it got invalidated in the meantime.
+  Option<Entry> _get(
+      const std::string& name,
+      uint64_t generation,
+      const process::Future<Nothing>& watched,
+      const Option<Entry>& entry);
+
+  // Forgets about a fetch once it completed.
+  void fetched(const std::string& name);
+
+  // Invalidates the entry and caches the new one if the set was
+  // successful (and nobody else changed it since).
+  bool _set(
+      const Entry& entry,
+      const process::Future<Nothing>& watched,
+      bool set);
+
+  // Invalidates the entry.
+  bool _expunge(const std::string& name, bool expunged);
+
+  // Caches an entry until the future gets satisfied.
+  void cache(
+      const std::string& name,
+      const Option<Entry>& entry,
+      const process::Future<Nothing>& watched);
+
+  void invalidate(const std::string& name);
+
+  Storage* storage;
+
+  // The most recently used entries, where none means the variable
+  // doesn't exist.
+  ::cache<std::string, Option<Entry> > entries;
+
+  // The variables being fetched: the number of times the entry got
+  // invalidated during the fetches (used to not cache an entry that
+  // got invalidated while being fetched) and the number of fetches.
+  struct Fetching
+  {
+    Fetching() : generation(0), fetches(0) {}
+
+    uint64_t generation;
+    size_t fetches;
+  };
+
+  hashmap<std::string, Fetching> fetching;
+};
+
+
+inline CachedStorage::CachedStorage(Storage* _storage)
+  : storage(_storage)
+{
+  process = new CachedStorageProcess(storage);
+  process::spawn(process);
+}
+
+
+inline CachedStorage::~CachedStorage()
+{
+  process::terminate(process);
+  process::wait(process);
+  delete process;
+}
+
+
+inline process::Future<Option<Entry> > CachedStorage::get(
+    const std::string& name)
+{
+  return process::dispatch(process, &CachedStorageProcess::get, name);
+}
+
+
+inline process::Future<bool> CachedStorage::set(
+    const Entry& entry,
+    const UUID& uuid)
+{
+  return process::dispatch(process, &CachedStorageProcess::set, entry, uuid);
+}
+
+
+inline process::Future<bool> CachedStorage::expunge(
+    const Entry& entry)
+{
+  return process::dispatch(process, &CachedStorageProcess::expunge, entry);
+}
+
+
+inline process::Future<std::vector<std::string> > CachedStorage::names()
+{
+  return storage->names();
+}
+
+
+inline process::Future<Nothing> CachedStorage::watch(const std::string& name)
+{
+  return storage->watch(name);
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __STATE_CACHED_HPP__
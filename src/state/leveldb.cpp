@@ -1,18 +1,25 @@
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 
 #include <google/protobuf/message.h>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h> // For ArrayInputStream.
 
+#include <deque>
 #include <string>
 #include <vector>
 
+#include <process/async.hpp>
+#include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/process.hpp>
 
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/none.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/some.hpp>
 #include <stout/try.hpp>
@@ -34,12 +41,35 @@ namespace mesos {
 namespace internal {
 namespace state {
 
+// Writes a batch synchronously, executed via 'async'.
+static Try<Nothing> commit(leveldb::DB* db, leveldb::WriteBatch batch)
+{
+  leveldb::WriteOptions options;
+  options.sync = true;
+
+  leveldb::Status status = db->Write(options, &batch);
+
+  if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  return Nothing();
+}
+
+
 LevelDBStorageProcess::LevelDBStorageProcess(const string& _path)
   : path(_path), db(NULL) {}
 
 
 LevelDBStorageProcess::~LevelDBStorageProcess()
 {
+  // The db must outlive the batch that is being written.
+  if (committing.isSome()) {
+    committing.get().await();
+  }
+
+  fail("No longer managing storage");
+
   delete db; // NULL if open failed in LevelDBStorageProcess::initialize.
 }
 
@@ -106,32 +136,35 @@ Future<bool> LevelDBStorageProcess::set(const Entry& entry, const UUID& uuid)
     return Failure(error.get());
   }
 
-  // We do a read first to make sure the version has not changed. This
-  // could be optimized in the future, for now it will probably hit
-  // the cache anyway.
-  Try<Option<Entry> > option = read(entry.name());
+  // The check is done against the version as of the last (possibly
+  // not yet written) set or expunge, which is the version the entry
+  // has by the time this set gets written since the writes are
+  // written in order (and we are the only ones writing to the db).
+  Try<Option<UUID> > current = version(entry.name());
 
-  if (option.isError()) {
-    return Failure(option.error());
+  if (current.isError()) {
+    return Failure(current.error());
   }
 
-  if (option.get().isSome()) {
-    if (UUID::fromBytes(option.get().get().uuid()) != uuid) {
-      return false;
-    }
+  if (current.get().isSome() && current.get().get() != uuid) {
+    return false;
   }
 
-  // Note that the read (i.e., DB::Get) and the write (i.e., DB::Put)
-  // are inherently "atomic" because only one db can be opened at a
-  // time, so there can not be any writes that occur concurrently.
-
-  Try<bool> result = write(entry);
+  string value;
 
-  if (result.isError()) {
-    return Failure(result.error());
+  if (!entry.SerializeToString(&value)) {
+    return Failure("Failed to serialize Entry");
   }
 
-  return result.get();
+  versions[entry.name()] = UUID::fromBytes(entry.uuid());
+
+  Write* write = new Write(entry.name(), value);
+  Future<bool> future = write->promise.future();
+
+  queued.push_back(write);
+  flush();
+
+  return future;
 }
 
 
@@ -141,38 +174,126 @@ Future<bool> LevelDBStorageProcess::expunge(const Entry& entry)
     return Failure(error.get());
   }
 
-  // We do a read first to make sure the version has not changed. This
-  // could be optimized in the future, for now it will probably hit
-  // the cache anyway.
-  Try<Option<Entry> > option = read(entry.name());
+  // See the comment in 'set' above.
+  Try<Option<UUID> > current = version(entry.name());
 
-  if (option.isError()) {
-    return Failure(option.error());
+  if (current.isError()) {
+    return Failure(current.error());
   }
 
-  if (option.get().isNone()) {
+  if (current.get().isNone() ||
+      current.get().get() != UUID::fromBytes(entry.uuid())) {
     return false;
   }
 
-  if (UUID::fromBytes(option.get().get().uuid()) !=
-      UUID::fromBytes(entry.uuid())) {
-    return false;
+  versions[entry.name()] = None();
+
+  Write* write = new Write(entry.name(), None());
+  Future<bool> future = write->promise.future();
+
+  queued.push_back(write);
+  flush();
+
+  return future;
+}
+
+
+void LevelDBStorageProcess::flush()
+{
+  if (committing.isSome() || queued.empty()) {
+    return;
   }
 
-  // Note that the read (i.e., DB::Get) and DB::Delete are inherently
-  // "atomic" because only one db can be opened at a time, so there
-  // can not be any writes that occur concurrently.
+  leveldb::WriteBatch batch;
 
-  leveldb::WriteOptions options;
-  options.sync = true;
+  foreach (Write* write, queued) {
+    if (write->value.isSome()) {
+      batch.Put(write->name, write->value.get());
+    } else {
+      batch.Delete(write->name);
+    }
+  }
 
-  leveldb::Status status = db->Delete(options, entry.name());
+  writing.swap(queued);
 
-  if (!status.ok()) {
-    return Failure(status.ToString());
+  committing = async(&commit, db, batch);
+  committing.get().onAny(defer(self(), &Self::_flush, lambda::_1));
+}
+
+
+void LevelDBStorageProcess::_flush(const Future<Try<Nothing> >& committed)
+{
+  CHECK_SOME(committing);
+
+  committing = None();
+
+  if (!committed.isReady() || committed.get().isError()) {
+    string message;
+    if (committed.isFailed()) {
+      message = committed.failure();
+    } else if (committed.isDiscarded()) {
+      message = "Not expecting discarded future";
+    } else {
+      message = committed.get().error();
+    }
+
+    // The queued writes were checked against versions that never got
+    // written, so they are failed as well.
+    fail("Failed to write to leveldb: " + message);
+    return;
+  }
+
+  while (!writing.empty()) {
+    Write* write = writing.front();
+    writing.pop_front();
+    write->promise.set(true);
+    delete write;
+  }
+
+  flush();
+}
+
+
+void LevelDBStorageProcess::fail(const string& message)
+{
+  foreach (Write* write, writing) {
+    write->promise.fail(message);
+    delete write;
+  }
+  writing.clear();
+
+  foreach (Write* write, queued) {
+    write->promise.fail(message);
+    delete write;
   }
+  queued.clear();
 
-  return true;
+  // Read the versions from the db again.
+  versions.clear();
+}
+
+
+Try<Option<UUID> > LevelDBStorageProcess::version(const string& name)
+{
+  if (versions.contains(name)) {
+    return versions[name];
+  }
+
+  Try<Option<Entry> > entry = read(name);
+
+  if (entry.isError()) {
+    return Error(entry.error());
+  }
+
+  Option<UUID> uuid = None();
+
+  if (entry.get().isSome()) {
+    uuid = UUID::fromBytes(entry.get().get().uuid());
+  }
+
+  versions[name] = uuid;
+
+  return uuid;
 }
 
 
@@ -204,28 +325,6 @@ Try<Option<Entry> > LevelDBStorageProcess::read(const string& name)
 }
 
 
-Try<bool> LevelDBStorageProcess::write(const Entry& entry)
-{
-  CHECK(error.isNone());
-
-  leveldb::WriteOptions options;
-  options.sync = true;
-
-  string value;
-
-  if (!entry.SerializeToString(&value)) {
-    return Error("Failed to serialize Entry");
-  }
-
-  leveldb::Status status = db->Put(options, entry.name(), value);
-
-  if (!status.ok()) {
-    return Error(status.ToString());
-  }
-
-  return true;
-}
-
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
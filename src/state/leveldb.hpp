@@ -1,6 +1,7 @@
 #ifndef __STATE_LEVELDB_HPP__
 #define __STATE_LEVELDB_HPP__
 
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -8,6 +9,8 @@
 #include <process/future.hpp>
 #include <process/process.hpp>
 
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 #include <stout/uuid.hpp>
@@ -40,6 +43,13 @@ public:
   virtual process::Future<bool> expunge(const Entry& entry);
   virtual process::Future<std::vector<std::string> > names();
 
+  // Nobody else can change the variables (leveldb can not be opened
+  // by more than one process), so the future never gets satisfied.
+  virtual process::Future<Nothing> watch(const std::string& name)
+  {
+    return process::Future<Nothing>();
+  }
+
 private:
   LevelDBStorageProcess* process;
 };
@@ -60,14 +70,46 @@ public:
   process::Future<std::vector<std::string> > names();
 
 private:
+  // A set (with the serialized entry) or an expunge (without) that
+  // passed the UUID check and waits to be written.
+  struct Write
+  {
+    Write(const std::string& _name, const Option<std::string>& _value)
+      : name(_name), value(_value) {}
+
+    const std::string name;
+    const Option<std::string> value;
+    process::Promise<bool> promise;
+  };
+
   // Helpers for interacting with leveldb.
   Try<Option<Entry> > read(const std::string& name);
-  Try<bool> write(const Entry& entry);
+
+  // Returns the UUID of the entry (none if there is none) as of the
+  // last set or expunge, which might not have been written yet.
+  Try<Option<UUID> > version(const std::string& name);
+
+  // Writes all of the queued writes in a single (synced) batch, while
+  // the writes that get queued in the meantime form the next batch.
+  void flush();
+  void _flush(const process::Future<Try<Nothing> >& committed);
+
+  // Fails the queued and the writing writes.
+  void fail(const std::string& message);
 
   const std::string path;
   leveldb::DB* db;
 
   Option<std::string> error;
+
+  // The UUIDs of the entries that have been read or set so far.
+  hashmap<std::string, Option<UUID> > versions;
+
+  std::deque<Write*> queued;
+  std::deque<Write*> writing;
+
+  // The batch that is being written, if any.
+  Option<process::Future<Try<Nothing> > > committing;
 };
 
 
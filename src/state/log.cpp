@@ -0,0 +1,507 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <process/async.hpp>
+#include <process/defer.hpp>
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+#include <process/timeout.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
+#include <stout/none.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+#include <stout/uuid.hpp>
+
+#include "logging/logging.hpp"
+
+#include "log/log.hpp"
+
+#include "messages/state.hpp"
+
+#include "state/log.hpp"
+
+using namespace process;
+
+using mesos::internal::log::Log;
+
+using std::list;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+// The (blocking) calls into the log, executed via 'async'.
+
+static Owned<Log::Writer> elect(Log* log, const Duration& timeout)
+{
+  return Owned<Log::Writer>(new Log::Writer(log, timeout));
+}
+
+
+static Try<list<Log::Entry> > read(
+    const Owned<Log::Reader>& reader,
+    const Duration& timeout)
+{
+  const Log::Position beginning = reader->beginning();
+  const Log::Position ending = reader->ending();
+
+  if (ending < beginning) {
+    return list<Log::Entry>();
+  }
+
+  Result<list<Log::Entry> > entries =
+    reader->read(beginning, ending, Timeout::in(timeout));
+
+  if (entries.isNone()) {
+    return Error("Timed out after " + stringify(timeout));
+  } else if (entries.isError()) {
+    return Error(entries.error());
+  }
+
+  return entries.get();
+}
+
+
+static Result<Log::Position> append(
+    const Owned<Log::Writer>& writer,
+    const string& data,
+    const Duration& timeout)
+{
+  return writer->append(data, Timeout::in(timeout));
+}
+
+
+static Result<Log::Position> truncate(
+    const Owned<Log::Writer>& writer,
+    const Log::Position& to,
+    const Duration& timeout)
+{
+  return writer->truncate(to, Timeout::in(timeout));
+}
+
+
+// Returns the failure of an append or truncate.
+static string failure(
+    const Future<Result<Log::Position> >& position,
+    const Duration& timeout)
+{
+  if (position.isFailed()) {
+    return position.failure();
+  } else if (position.isDiscarded()) {
+    return "Not expecting discarded future";
+  } else if (position.get().isError()) {
+    return position.get().error();
+  }
+
+  return "Timed out after " + stringify(timeout);
+}
+
+
+LogStorageProcess::LogStorageProcess(
+    Log* _log,
+    const Duration& _timeout,
+    size_t _interval)
+  : ProcessBase(ID::generate("log-storage")),
+    log(_log),
+    timeout(_timeout),
+    interval(_interval),
+    reader(new Log::Reader(_log)),
+    writing(false),
+    appended(0) {}
+
+
+LogStorageProcess::~LogStorageProcess() {}
+
+
+void LogStorageProcess::finalize()
+{
+  fail("Log storage is being deleted");
+}
+
+
+Future<Option<Entry> > LogStorageProcess::get(const string& name)
+{
+  return start().then(defer(self(), &Self::_get, name));
+}
+
+
+Option<Entry> LogStorageProcess::_get(const string& name)
+{
+  hashmap<string, Snapshot>::const_iterator iterator = snapshots.find(name);
+
+  if (iterator == snapshots.end()) {
+    return None();
+  }
+
+  return iterator->second.entry;
+}
+
+
+Future<bool> LogStorageProcess::set(const Entry& entry, const UUID& uuid)
+{
+  Operation operation;
+  operation.set_type(Operation::SNAPSHOT);
+  operation.mutable_snapshot()->mutable_entry()->CopyFrom(entry);
+
+  Mutation* mutation = new Mutation(operation, uuid);
+  Future<bool> future = mutation->promise.future();
+
+  mutations.push_back(mutation);
+  write();
+
+  return future;
+}
+
+
+Future<bool> LogStorageProcess::expunge(const Entry& entry)
+{
+  Operation operation;
+  operation.set_type(Operation::EXPUNGE);
+  operation.mutable_expunge()->set_name(entry.name());
+
+  Mutation* mutation = new Mutation(operation, UUID::fromBytes(entry.uuid()));
+  Future<bool> future = mutation->promise.future();
+
+  mutations.push_back(mutation);
+  write();
+
+  return future;
+}
+
+
+Future<vector<string> > LogStorageProcess::names()
+{
+  return start().then(defer(self(), &Self::_names));
+}
+
+
+vector<string> LogStorageProcess::_names()
+{
+  vector<string> results;
+  foreachkey (const string& name, snapshots) {
+    results.push_back(name);
+  }
+  return results;
+}
+
+
+Future<Nothing> LogStorageProcess::start()
+{
+  // Try again if we failed to get elected or to recover last time.
+  if (starting.isSome() &&
+      (starting.get().isFailed() || starting.get().isDiscarded())) {
+    reset();
+  }
+
+  if (starting.isNone()) {
+    starting = async(&elect, log, timeout)
+      .then(defer(self(), &Self::_start, lambda::_1));
+  }
+
+  return starting.get();
+}
+
+
+Future<Nothing> LogStorageProcess::_start(const Owned<Log::Writer>& _writer)
+{
+  writer = _writer;
+
+  // Now that we are the writer nobody else can append to the log, so
+  // whatever we read is the latest state.
+  return async(&read, reader, timeout)
+    .then(defer(self(), &Self::__start, lambda::_1));
+}
+
+
+Future<Nothing> LogStorageProcess::__start(
+    const Try<list<Log::Entry> >& entries)
+{
+  if (entries.isError()) {
+    return Failure("Failed to read the log: " + entries.error());
+  }
+
+  snapshots.clear();
+  last = None();
+  compacted = None();
+
+  const list<Log::Entry> operations = entries.get();
+
+  foreach (const Log::Entry& entry, operations) {
+    Operation operation;
+    if (!operation.ParseFromString(entry.data)) {
+      return Failure("Failed to deserialize Operation");
+    }
+
+    if ((operation.type() == Operation::SNAPSHOT &&
+         !operation.has_snapshot()) ||
+        (operation.type() == Operation::EXPUNGE &&
+         !operation.has_expunge())) {
+      return Failure("Malformed Operation");
+    }
+
+    apply(entry.position, operation);
+  }
+
+  // A long log gets compacted after the next append.
+  appended = operations.size();
+
+  LOG(INFO) << "Recovered " << snapshots.size() << " entries from "
+            << operations.size() << " operations in the log";
+
+  return Nothing();
+}
+
+
+void LogStorageProcess::write()
+{
+  if (writing || mutations.empty()) {
+    return;
+  }
+
+  writing = true;
+
+  start().onAny(defer(self(), &Self::_write, lambda::_1));
+}
+
+
+void LogStorageProcess::_write(const Future<Nothing>& started)
+{
+  CHECK(writing);
+
+  if (!started.isReady()) {
+    fail(started.isFailed()
+         ? started.failure()
+         : "Not expecting discarded future");
+    writing = false;
+    return;
+  }
+
+  // Mutations of entries that changed in the meantime are done
+  // without touching the log.
+  while (!mutations.empty() && !check(*mutations.front())) {
+    Mutation* mutation = mutations.front();
+    mutations.pop_front();
+    done(mutation, false);
+  }
+
+  if (mutations.empty()) {
+    writing = false;
+    return;
+  }
+
+  async(&append,
+        writer,
+        mutations.front()->operation.SerializeAsString(),
+        timeout)
+    .onAny(defer(self(), &Self::__write, lambda::_1));
+}
+
+
+void LogStorageProcess::__write(const Future<Result<Log::Position> >& position)
+{
+  CHECK(writing);
+  CHECK(!mutations.empty());
+
+  Mutation* mutation = mutations.front();
+  mutations.pop_front();
+
+  if (!position.isReady() || !position.get().isSome()) {
+    done(mutation,
+         "Failed to append to the log: " + failure(position, timeout));
+
+    // We might not be the writer anymore and the operation might
+    // have been appended anyway, so we get elected and catch up with
+    // the log again before the next mutation.
+    reset();
+    writing = false;
+    write();
+    return;
+  }
+
+  apply(position.get().get(), mutation->operation);
+  done(mutation, true);
+
+  if (++appended >= interval) {
+    compact();
+    return;
+  }
+
+  writing = false;
+  write();
+}
+
+
+void LogStorageProcess::compact()
+{
+  CHECK(writing);
+  CHECK_SOME(last);
+
+  appended = 0;
+
+  // Nothing before the oldest snapshot is needed anymore.
+  Log::Position oldest = last.get();
+  foreachvalue (const Snapshot& snapshot, snapshots) {
+    if (snapshot.position < oldest) {
+      oldest = snapshot.position;
+    }
+  }
+
+  async(&truncate, writer, oldest, timeout)
+    .onAny(defer(self(), &Self::_compact, lambda::_1));
+}
+
+
+void LogStorageProcess::_compact(
+    const Future<Result<Log::Position> >& position)
+{
+  CHECK(writing);
+
+  if (!position.isReady() || !position.get().isSome()) {
+    LOG(WARNING) << "Failed to truncate the log: "
+                 << failure(position, timeout);
+    reset();
+  } else {
+    // Entries that were not set since the last compaction get
+    // snapshotted so that they don't hold back the next truncation,
+    // unless they are queued up to be snapshotted already. They are
+    // queued behind the pending mutations, which would otherwise be
+    // held back by the snapshots of every compaction as soon as
+    // there are more entries than appends between compactions.
+    if (compacted.isSome()) {
+      foreachvalue (const Snapshot& snapshot, snapshots) {
+        const string& name = snapshot.entry.name();
+        if (snapshot.position < compacted.get() &&
+            !resnapshotting.contains(name)) {
+          Operation operation;
+          operation.set_type(Operation::SNAPSHOT);
+          operation.mutable_snapshot()->mutable_entry()->CopyFrom(
+              snapshot.entry);
+
+          mutations.push_back(new Mutation(
+              operation, UUID::fromBytes(snapshot.entry.uuid()), true));
+
+          resnapshotting.insert(name);
+        }
+      }
+    }
+
+    compacted = last;
+  }
+
+  writing = false;
+  write();
+}
+
+
+bool LogStorageProcess::check(const Mutation& mutation)
+{
+  const Operation& operation = mutation.operation;
+
+  const string& name = operation.type() == Operation::SNAPSHOT
+    ? operation.snapshot().entry().name()
+    : operation.expunge().name();
+
+  hashmap<string, Snapshot>::const_iterator iterator = snapshots.find(name);
+
+  if (iterator == snapshots.end()) {
+    // Only existing entries can be expunged.
+    return operation.type() == Operation::SNAPSHOT;
+  }
+
+  return UUID::fromBytes(iterator->second.entry.uuid()) == mutation.uuid;
+}
+
+
+void LogStorageProcess::apply(
+    const Log::Position& position,
+    const Operation& operation)
+{
+  switch (operation.type()) {
+    case Operation::SNAPSHOT: {
+      const Entry& entry = operation.snapshot().entry();
+      snapshots.put(entry.name(), Snapshot(position, entry));
+      break;
+    }
+
+    case Operation::EXPUNGE:
+      snapshots.erase(operation.expunge().name());
+      break;
+
+    default:
+      LOG(FATAL) << "Unknown operation type " << operation.type();
+  }
+
+  last = position;
+}
+
+
+void LogStorageProcess::fail(const string& message)
+{
+  foreach (Mutation* mutation, mutations) {
+    done(mutation, message);
+  }
+  mutations.clear();
+}
+
+
+void LogStorageProcess::done(Mutation* mutation, bool set)
+{
+  if (mutation->resnapshot) {
+    resnapshotting.erase(mutation->operation.snapshot().entry().name());
+  }
+
+  mutation->promise.set(set);
+  delete mutation;
+}
+
+
+void LogStorageProcess::done(Mutation* mutation, const string& message)
+{
+  if (mutation->resnapshot) {
+    resnapshotting.erase(mutation->operation.snapshot().entry().name());
+  }
+
+  mutation->promise.fail(message);
+  delete mutation;
+}
+
+
+void LogStorageProcess::reset()
+{
+  writer.reset();
+  starting = None();
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,251 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STATE_LOG_HPP__
+#define __STATE_LOG_HPP__
+
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/option.hpp>
+#include <stout/result.hpp>
+#include <stout/try.hpp>
+#include <stout/uuid.hpp>
+
+#include "log/log.hpp"
+
+#include "messages/state.hpp"
+
+#include "state/storage.hpp"
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+// Forward declarations.
+class LogStorageProcess;
+
+
+// A storage backed by the replicated log. Every set and expunge gets
+// appended to the log, while all of the entries are kept in memory
+// so that gets and names can be served locally. Every 'interval'
+// appends the log gets truncated up to the oldest entry that is still
+// needed, after entries that have not been set in a while got
+// appended again (i.e., snapshotted) so they don't hold back the
+// truncation forever.
+//
+// Only one LogStorage may be writing to a log at a time (the writer
+// gets elected), a LogStorage that lost its election (e.g., to
+// another LogStorage on a different replica of the log) fails the
+// pending operation and catches up with the log before performing
+// the next one.
+class LogStorage : public Storage
+{
+public:
+  LogStorage(
+      log::Log* log,
+      const Duration& timeout,
+      size_t interval = 1000);
+  virtual ~LogStorage();
+
+  // Storage implementation.
+  virtual process::Future<Option<Entry> > get(const std::string& name);
+  virtual process::Future<bool> set(const Entry& entry, const UUID& uuid);
+  virtual process::Future<bool> expunge(const Entry& entry);
+  virtual process::Future<std::vector<std::string> > names();
+
+private:
+  LogStorageProcess* process;
+};
+
+
+class LogStorageProcess : public process::Process<LogStorageProcess>
+{
+public:
+  LogStorageProcess(
+      log::Log* log,
+      const Duration& timeout,
+      size_t interval);
+  virtual ~LogStorageProcess();
+
+  // Storage implementation.
+  process::Future<Option<Entry> > get(const std::string& name);
+  process::Future<bool> set(const Entry& entry, const UUID& uuid);
+  process::Future<bool> expunge(const Entry& entry);
+  process::Future<std::vector<std::string> > names();
+
+protected:
+  virtual void finalize();
+
+private:
+  // The latest snapshot of an entry and its position in the log.
+  struct Snapshot
+  {
+    Snapshot(const log::Log::Position& _position, const Entry& _entry)
+      : position(_position), entry(_entry) {}
+
+    log::Log::Position position;
+    Entry entry;
+  };
+
+  // A set or an expunge waiting to be appended to the log. The
+  // operation is only appended if the entry still has the expected
+  // version once it is its turn. A compaction queues up mutations
+  // that snapshot unchanged entries again (see 'resnapshotting').
+  struct Mutation
+  {
+    Mutation(
+        const Operation& _operation,
+        const UUID& _uuid,
+        bool _resnapshot = false)
+      : operation(_operation), uuid(_uuid), resnapshot(_resnapshot) {}
+
+    const Operation operation;
+    const UUID uuid;
+    const bool resnapshot;
+    process::Promise<bool> promise;
+  };
+
+  // Gets elected as the writer of the log and recovers the entries
+  // from the log (once, unless the writer fails).
+  process::Future<Nothing> start();
+  process::Future<Nothing> _start(
+      const process::Owned<log::Log::Writer>& writer);
+  process::Future<Nothing> __start(
+      const Try<std::list<log::Log::Entry> >& entries);
+
+  // Continuations.
+  Option<Entry> _get(const std::string& name);
+  std::vector<std::string> _names();
+
+  // Appends the queued mutations to the log one after another.
+  void write();
+  void _write(const process::Future<Nothing>& started);
+  void __write(const process::Future<Result<log::Log::Position> >& position);
+
+  // Truncates the log and snapshots the entries that have not been
+  // set since the last compaction.
+  void compact();
+  void _compact(
+      const process::Future<Result<log::Log::Position> >& position);
+
+  // Returns whether the entry of a mutation has the expected version.
+  bool check(const Mutation& mutation);
+
+  // Applies an operation that got appended at the specified position.
+  void apply(const log::Log::Position& position, const Operation& operation);
+
+  // Fails the queued mutations.
+  void fail(const std::string& message);
+
+  // Completes and deletes a mutation that got dequeued.
+  void done(Mutation* mutation, bool set);
+  void done(Mutation* mutation, const std::string& message);
+
+  // Forgets about the writer so that the next operation gets elected
+  // (again) and catches up with the log.
+  void reset();
+
+  log::Log* log;
+  const Duration timeout;
+  const size_t interval;
+
+  process::Owned<log::Log::Reader> reader;
+  process::Owned<log::Log::Writer> writer;
+
+  Option<process::Future<Nothing> > starting;
+
+  hashmap<std::string, Snapshot> snapshots;
+
+  std::deque<Mutation*> mutations;
+  bool writing;
+
+  // The entries that have a re-snapshot queued up in 'mutations', so
+  // that later compactions don't queue them up again.
+  hashset<std::string> resnapshotting;
+
+  // Number of appends since the last compaction.
+  size_t appended;
+
+  // The last position appended to (or recovered from) the log and
+  // its value during the last compaction.
+  Option<log::Log::Position> last;
+  Option<log::Log::Position> compacted;
+};
+
+
+inline LogStorage::LogStorage(
+    log::Log* log,
+    const Duration& timeout,
+    size_t interval)
+{
+  process = new LogStorageProcess(log, timeout, interval);
+  process::spawn(process);
+}
+
+
+inline LogStorage::~LogStorage()
+{
+  process::terminate(process);
+  process::wait(process);
+  delete process;
+}
+
+
+inline process::Future<Option<Entry> > LogStorage::get(
+    const std::string& name)
+{
+  return process::dispatch(process, &LogStorageProcess::get, name);
+}
+
+
+inline process::Future<bool> LogStorage::set(
+    const Entry& entry,
+    const UUID& uuid)
+{
+  return process::dispatch(process, &LogStorageProcess::set, entry, uuid);
+}
+
+
+inline process::Future<bool> LogStorage::expunge(
+    const Entry& entry)
+{
+  return process::dispatch(process, &LogStorageProcess::expunge, entry);
+}
+
+
+inline process::Future<std::vector<std::string> > LogStorage::names()
+{
+  return process::dispatch(process, &LogStorageProcess::names);
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __STATE_LOG_HPP__
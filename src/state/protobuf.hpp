@@ -24,6 +24,7 @@
 #include <process/future.hpp>
 
 #include <stout/lambda.hpp>
+#include <stout/memory.hpp>
 #include <stout/option.hpp>
 #include <stout/some.hpp>
 #include <stout/try.hpp>
@@ -40,31 +41,59 @@ namespace internal {
 namespace state {
 namespace protobuf {
 
+// A typed variable. Copies of a variable (and of the variables
+// derived from it via 'mutate') share the underlying message, which
+// is never changed once created, so copying a variable is cheap
+// regardless of the size of the message. The serialized form of the
+// message is kept along with it, so storing a variable that was
+// fetched (or stored) without being mutated doesn't serialize it
+// again.
 template <typename T>
 class Variable
 {
 public:
-  T get() const
+  const T& get() const
   {
-    return t;
+    return *t;
   }
 
   Variable mutate(const T& t) const
   {
     Variable variable(*this);
-    variable.t = t;
+    variable.t.reset(new T(t));
+    variable.serialized = false;
+    return variable;
+  }
+
+  // Like 'mutate' above but takes over the contents of the specified
+  // message rather than copying it, leaving it empty.
+  Variable mutate(T* t) const
+  {
+    T* swapped = new T();
+    swapped->Swap(t);
+
+    Variable variable(*this);
+    variable.t.reset(swapped);
+    variable.serialized = false;
     return variable;
   }
 
 private:
   friend class State; // Creates and manages variables.
 
-  Variable(const state::Variable& _variable, const T& _t)
-    : variable(_variable), t(_t)
+  Variable(const state::Variable& _variable,
+           const memory::shared_ptr<const T>& _t)
+    : variable(new state::Variable(_variable)),
+      t(_t),
+      serialized(true)
   {}
 
-  state::Variable variable; // Not const to keep Variable assignable.
-  T t;
+  // Not const to keep Variable assignable.
+  memory::shared_ptr<const state::Variable> variable;
+  memory::shared_ptr<const T> t;
+
+  // Whether the value of 'variable' is the serialized 't'.
+  bool serialized;
 };
 
 
@@ -99,7 +128,7 @@ private:
 
   template <typename T>
   static process::Future<Option<Variable<T> > > _store(
-      const T& t,
+      const memory::shared_ptr<const T>& t,
       const Option<state::Variable>& variable);
 };
 
@@ -121,7 +150,7 @@ process::Future<Variable<T> > State::_fetch(
     return process::Failure(t.error());
   }
 
-  return Variable<T>(variable, t.get());
+  return Variable<T>(variable, memory::shared_ptr<const T>(new T(t.get())));
 }
 
 
@@ -129,20 +158,25 @@ template <typename T>
 process::Future<Option<Variable<T> > > State::store(
     const Variable<T>& variable)
 {
-  Try<std::string> value = messages::serialize(variable.t);
+  if (variable.serialized) {
+    return state::State::store(*variable.variable)
+      .then(lambda::bind(&State::template _store<T>, variable.t, lambda::_1));
+  }
+
+  Try<std::string> value = messages::serialize(*variable.t);
 
   if (value.isError()) {
     return process::Failure(value.error());
   }
 
-  return state::State::store(variable.variable.mutate(value.get()))
+  return state::State::store(variable.variable->mutate(value.get()))
     .then(lambda::bind(&State::template _store<T>, variable.t, lambda::_1));
 }
 
 
 template <typename T>
 process::Future<Option<Variable<T> > > State::_store(
-    const T& t,
+    const memory::shared_ptr<const T>& t,
     const Option<state::Variable>& variable)
 {
   if (variable.isSome()) {
@@ -156,7 +190,7 @@ process::Future<Option<Variable<T> > > State::_store(
 template <typename T>
 process::Future<bool> State::expunge(const Variable<T>& variable)
 {
-  return state::State::expunge(variable.variable);
+  return state::State::expunge(*variable.variable);
 }
 
 } // namespace protobuf {
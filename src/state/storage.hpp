@@ -24,6 +24,7 @@
 
 #include <process/future.hpp>
 
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/uuid.hpp>
 
@@ -51,6 +52,18 @@ public:
 
   // Returns the collection of variable names in the state.
   virtual process::Future<std::vector<std::string> > names() = 0;
+
+  // Returns a future that gets satisfied once the variable might have
+  // been changed by someone other than this storage, e.g., another
+  // client of the same ZooKeeper ensemble. This allows caching the
+  // entries (see CachedStorage). By default the future is already
+  // satisfied, i.e., the variable might change at any time and must
+  // not be cached. Only a storage that is not shared (or that can
+  // notice every change) should override it.
+  virtual process::Future<Nothing> watch(const std::string& name)
+  {
+    return Nothing();
+  }
 };
 
 } // namespace state {
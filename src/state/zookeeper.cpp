@@ -2,20 +2,29 @@
 
 #include <google/protobuf/io/zero_copy_stream_impl.h> // For ArrayInputStream.
 
+#include <list>
 #include <queue>
+#include <set>
 #include <string>
 #include <vector>
 
+#include <process/collect.hpp>
+#include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/process.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/none.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/result.hpp>
 #include <stout/some.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 #include <stout/try.hpp>
 #include <stout/uuid.hpp>
@@ -33,7 +42,9 @@
 
 using namespace process;
 
+using std::list;
 using std::queue;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -56,6 +67,79 @@ void fail(queue<T*>* queue, const string& message)
 }
 
 
+// Helper for failing a set of promises.
+template <typename T>
+void fail(set<T*>* set, const string& message)
+{
+  foreach (T* t, *set) {
+    t->promise.fail(message);
+    delete t;
+  }
+  set->clear();
+}
+
+
+// Helper for queueing a set of operations again.
+template <typename T>
+void requeue(set<T*>* set, queue<T*>* queue)
+{
+  foreach (T* t, *set) {
+    queue->push(t);
+  }
+  set->clear();
+}
+
+
+// Helper for getting the error code of a response.
+template <typename T>
+int status(const ZooKeeper::Response<T>& response)
+{
+  return response.code;
+}
+
+
+// The size of the chunks. Entries that serialize to more than this
+// are stored in chunks. ZooKeeper limits a request (i.e., the data
+// plus the path, the ACL and the header) to just under 1 MB by
+// default ('jute.maxbuffer'), so this leaves plenty of room for the
+// overhead of a request.
+static const size_t CHUNK_SIZE = 512 * 1024;
+
+
+// The child of the storage's znode that holds the chunks.
+static const string CHUNKS = ".chunks";
+
+
+// Helper for creating the manifest of a chunked entry.
+static Entry manifest(const Entry& entry, size_t size)
+{
+  Entry manifest;
+  manifest.set_name(entry.name());
+  manifest.set_uuid(entry.uuid());
+  manifest.set_value("");
+  manifest.set_chunks((size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  return manifest;
+}
+
+
+// Helper for deserializing an Entry.
+static Try<Entry> deserialize(const string& data)
+{
+  google::protobuf::io::ArrayInputStream stream(data.data(), data.size());
+
+  Entry entry;
+
+  if (!entry.ParseFromZeroCopyStream(&stream)) {
+    return Error("Failed to deserialize Entry");
+  }
+
+  return entry;
+}
+
+
+const Duration ZooKeeperStorageProcess::RETRY_INTERVAL = Seconds(2);
+
+
 ZooKeeperStorageProcess::ZooKeeperStorageProcess(
     const string& _servers,
     const Duration& _timeout,
@@ -70,7 +154,8 @@ ZooKeeperStorageProcess::ZooKeeperStorageProcess(
         : ZOO_OPEN_ACL_UNSAFE),
     watcher(NULL),
     zk(NULL),
-    state(DISCONNECTED)
+    state(DISCONNECTED),
+    retrying(false)
 {}
 
 
@@ -79,6 +164,14 @@ ZooKeeperStorageProcess::~ZooKeeperStorageProcess()
   fail(&pending.names, "No longer managing storage");
   fail(&pending.gets, "No longer managing storage");
   fail(&pending.sets, "No longer managing storage");
+  fail(&pending.expunges, "No longer managing storage");
+
+  fail(&outstanding.names, "No longer managing storage");
+  fail(&outstanding.gets, "No longer managing storage");
+  fail(&outstanding.sets, "No longer managing storage");
+  fail(&outstanding.expunges, "No longer managing storage");
+
+  trigger(None());
 
   delete zk;
   delete watcher;
@@ -98,23 +191,18 @@ Future<vector<string> > ZooKeeperStorageProcess::names()
 {
   if (error.isSome()) {
     return Failure(error.get());
-  } else if (state != CONNECTED) {
-    Names* names = new Names();
-    pending.names.push(names);
-    return names->promise.future();
   }
 
-  Result<vector<string> > result = doNames();
+  Names* names = new Names();
+  Future<vector<string> > future = names->promise.future();
 
-  if (result.isNone()) { // Try again later.
-    Names* names = new Names();
+  if (state != CONNECTED) {
     pending.names.push(names);
-    return names->promise.future();
-  } else if (result.isError()) {
-    return Failure(result.error());
+  } else {
+    doNames(names);
   }
 
-  return result.get();
+  return future;
 }
 
 
@@ -122,23 +210,18 @@ Future<Option<Entry> > ZooKeeperStorageProcess::get(const string& name)
 {
   if (error.isSome()) {
     return Failure(error.get());
-  } else if (state != CONNECTED) {
-    Get* get = new Get(name);
-    pending.gets.push(get);
-    return get->promise.future();
   }
 
-  Result<Option<Entry> > result = doGet(name);
+  Get* get = new Get(name);
+  Future<Option<Entry> > future = get->promise.future();
 
-  if (result.isNone()) { // Try again later.
-    Get* get = new Get(name);
+  if (state != CONNECTED) {
     pending.gets.push(get);
-    return get->promise.future();
-  } else if (result.isError()) {
-    return Failure(result.error());
+  } else {
+    doGet(get);
   }
 
-  return result.get();
+  return future;
 }
 
 
@@ -146,23 +229,24 @@ Future<bool> ZooKeeperStorageProcess::set(const Entry& entry, const UUID& uuid)
 {
   if (error.isSome()) {
     return Failure(error.get());
-  } else if (state != CONNECTED) {
-    Set* set = new Set(entry, uuid);
-    pending.sets.push(set);
-    return set->promise.future();
   }
 
-  Result<bool> result = doSet(entry, uuid);
+  string data;
+
+  if (!entry.SerializeToString(&data)) {
+    return Failure("Failed to serialize Entry");
+  }
 
-  if (result.isNone()) { // Try again later.
-    Set* set = new Set(entry, uuid);
+  Set* set = new Set(entry, uuid, data);
+  Future<bool> future = set->promise.future();
+
+  if (state != CONNECTED) {
     pending.sets.push(set);
-    return set->promise.future();
-  } else if (result.isError()) {
-    return Failure(result.error());
+  } else {
+    doSet(set);
   }
 
-  return result.get();
+  return future;
 }
 
 
@@ -170,23 +254,62 @@ Future<bool> ZooKeeperStorageProcess::expunge(const Entry& entry)
 {
   if (error.isSome()) {
     return Failure(error.get());
-  } else if (state != CONNECTED) {
-    Expunge* expunge = new Expunge(entry);
-    pending.expunges.push(expunge);
-    return expunge->promise.future();
   }
 
-  Result<bool> result = doExpunge(entry);
+  Expunge* expunge = new Expunge(entry);
+  Future<bool> future = expunge->promise.future();
 
-  if (result.isNone()) { // Try again later.
-    Expunge* expunge = new Expunge(entry);
+  if (state != CONNECTED) {
     pending.expunges.push(expunge);
-    return expunge->promise.future();
-  } else if (result.isError()) {
-    return Failure(result.error());
+  } else {
+    doExpunge(expunge);
+  }
+
+  return future;
+}
+
+
+Future<Nothing> ZooKeeperStorageProcess::watch(const string& name)
+{
+  if (error.isSome() || state != CONNECTED) {
+    return Nothing(); // We can't tell whether it changes.
+  }
+
+  const string path = znode + "/" + name;
+
+  Promise<Nothing>* promise = new Promise<Nothing>();
+  Future<Nothing> future = promise->future();
+
+  // A single ZooKeeper watch (which gets triggered on creation,
+  // change, and deletion of the znode) serves all of the watches of
+  // a path.
+  if (!watches.contains(path)) {
+    zk->asyncExists(path, true)
+      .onReady(defer(self(),
+                     &Self::_watch,
+                     zk->getSessionId(),
+                     path,
+                     lambda::_1));
+  }
+
+  watches[path].push_back(promise);
+
+  return future;
+}
+
+
+void ZooKeeperStorageProcess::_watch(
+    int64_t session,
+    const string& path,
+    const ZooKeeper::Response<Nothing>& response)
+{
+  if (stale(session)) {
+    return; // All of the watches got triggered on expiration.
   }
 
-  return result.get();
+  if (response.code != ZOK && response.code != ZNONODE) {
+    trigger(path);
+  }
 }
 
 
@@ -198,58 +321,43 @@ void ZooKeeperStorageProcess::connected(bool reconnect)
     if (auth.isSome()) {
       LOG(INFO) << "Authenticating with ZooKeeper using " << auth.get().scheme;
 
-      int code = zk->authenticate(auth.get().scheme, auth.get().credentials);
-
-      if (code != ZOK) { // TODO(benh): Authentication retries?
-        error = "Failed to authenticate with ZooKeeper: " + zk->message(code);
-        return;
-      }
+      zk->asyncAuthenticate(auth.get().scheme, auth.get().credentials)
+        .onReady(defer(self(),
+                       &Self::authenticated,
+                       zk->getSessionId(),
+                       lambda::_1));
+      return;
     }
   }
 
   state = CONNECTED;
 
-  while (!pending.names.empty()) {
-    Names* names = pending.names.front();
-    Result<vector<string> > result = doNames();
-    if (result.isNone()) {
-      return; // Try again later.
-    } else if (result.isError()) {
-      names->promise.fail(result.error());
-    } else {
-      names->promise.set(result.get());
-    }
-    pending.names.pop();
-    delete names;
-  }
+  flush();
+}
 
-  while (!pending.gets.empty()) {
-    Get* get = pending.gets.front();
-    Result<Option<Entry> > result = doGet(get->name);
-    if (result.isNone()) {
-      return; // Try again later.
-    } else if (result.isError()) {
-      get->promise.fail(result.error());
-    } else {
-      get->promise.set(result.get());
-    }
-    pending.gets.pop();
-    delete get;
+
+void ZooKeeperStorageProcess::authenticated(
+    int64_t session,
+    const ZooKeeper::Response<Nothing>& response)
+{
+  if (stale(session)) {
+    return; // We authenticate again once connected.
   }
 
-  while (!pending.sets.empty()) {
-    Set* set = pending.sets.front();
-    Result<bool> result = doSet(set->entry, set->uuid);
-    if (result.isNone()) {
-      return; // Try again later.
-    } else if (result.isError()) {
-      set->promise.fail(result.error());
-    } else {
-      set->promise.set(result.get());
-    }
-    pending.sets.pop();
-    delete set;
+  if (response.code != ZOK) { // TODO(benh): Authentication retries?
+    error = "Failed to authenticate with ZooKeeper: " +
+      zk->message(response.code);
+
+    fail(&pending.names, error.get());
+    fail(&pending.gets, error.get());
+    fail(&pending.sets, error.get());
+    fail(&pending.expunges, error.get());
+    return;
   }
+
+  state = CONNECTED;
+
+  flush();
 }
 
 
@@ -263,6 +371,16 @@ void ZooKeeperStorageProcess::expired()
 {
   state = DISCONNECTED;
 
+  // The outstanding operations might never get a response from the
+  // expired session, so they are started over in the new one.
+  requeue(&outstanding.names, &pending.names);
+  requeue(&outstanding.gets, &pending.gets);
+  requeue(&outstanding.sets, &pending.sets);
+  requeue(&outstanding.expunges, &pending.expunges);
+
+  // The ZooKeeper watches don't survive the session.
+  trigger(None());
+
   delete zk;
   zk = new ZooKeeper(servers, timeout, watcher);
 
@@ -272,224 +390,572 @@ void ZooKeeperStorageProcess::expired()
 
 void ZooKeeperStorageProcess::updated(const string& path)
 {
-  LOG(FATAL) << "Unexpected ZooKeeper event";
+  trigger(path);
 }
 
 
 void ZooKeeperStorageProcess::created(const string& path)
 {
-  LOG(FATAL) << "Unexpected ZooKeeper event";
+  trigger(path);
 }
 
 
 void ZooKeeperStorageProcess::deleted(const string& path)
 {
-  LOG(FATAL) << "Unexpected ZooKeeper event";
+  trigger(path);
 }
 
 
-Result<vector<string> > ZooKeeperStorageProcess::doNames()
+void ZooKeeperStorageProcess::doNames(Names* names)
 {
+  CHECK(error.isNone()) << ": " << error.get();
+  CHECK(state == CONNECTED);
+
+  outstanding.names.insert(names);
+
   // Get all children to determine current memberships.
-  vector<string> results;
+  zk->asyncGetChildren(znode, false)
+    .onReady(defer(self(),
+                   &Self::_names,
+                   zk->getSessionId(),
+                   names,
+                   lambda::_1));
+}
 
-  int code = zk->getChildren(znode, false, &results);
 
-  if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return None(); // Try again later.
-  } else if (code != ZOK) {
-    return Error(
+void ZooKeeperStorageProcess::_names(
+    int64_t session,
+    Names* names,
+    const ZooKeeper::Response<vector<string> >& response)
+{
+  if (stale(session)) {
+    return;
+  }
+
+  outstanding.names.erase(names);
+
+  if (retryable(response.code)) {
+    retry(&pending.names, names);
+    return;
+  } else if (response.code != ZOK) {
+    names->promise.fail(
         "Failed to get children of '" + znode +
-        "' in ZooKeeper: " + zk->message(code));
+        "' in ZooKeeper: " + zk->message(response.code));
+  } else {
+    // TODO(benh): It might make sense to "mangle" the names so that
+    // we can determine when a znode has incorrectly been added that
+    // actually doesn't store an Entry.
+    vector<string> results;
+    foreach (const string& name, response.value) {
+      if (name != CHUNKS) {
+        results.push_back(name);
+      }
+    }
+
+    names->promise.set(results);
   }
 
-  // TODO(benh): It might make sense to "mangle" the names so that we
-  // can determine when a znode has incorrectly been added that
-  // actually doesn't store an Entry.
-  return results;
+  delete names;
 }
 
 
-Result<Option<Entry> > ZooKeeperStorageProcess::doGet(const string& name)
+void ZooKeeperStorageProcess::doGet(Get* get)
 {
   CHECK(error.isNone()) << ": " << error.get();
   CHECK(state == CONNECTED);
 
-  string result;
-  Stat stat;
+  outstanding.gets.insert(get);
 
-  int code = zk->get(znode + "/" + name, false, &result, &stat);
+  zk->asyncGet(znode + "/" + get->name, false)
+    .onReady(defer(self(),
+                   &Self::_get,
+                   zk->getSessionId(),
+                   get,
+                   lambda::_1));
+}
 
-  if (code == ZNONODE) {
-    return Option<Entry>::none();
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return None(); // Try again later.
-  } else if (code != ZOK) {
-    return Error(
-        "Failed to get '" + znode + "/" + name +
-        "' in ZooKeeper: " + zk->message(code));
+
+void ZooKeeperStorageProcess::_get(
+    int64_t session,
+    Get* get,
+    const ZooKeeper::Response<string>& response)
+{
+  if (stale(session)) {
+    return;
   }
 
-  google::protobuf::io::ArrayInputStream stream(result.data(), result.size());
+  if (response.code == ZOK) {
+    Try<Entry> entry = deserialize(response.value);
 
-  Entry entry;
+    if (entry.isSome() && entry.get().has_chunks()) {
+      // Fetch all of the chunks at once.
+      list<Future<ZooKeeper::Response<string> > > futures;
+      foreach (const string& path, chunks(entry.get())) {
+        futures.push_back(zk->asyncGet(path, false));
+      }
 
-  if (!entry.ParseFromZeroCopyStream(&stream)) {
-    return Error("Failed to deserialize Entry");
+      collect(futures)
+        .onReady(defer(self(), &Self::__get, session, get, lambda::_1));
+      return;
+    }
   }
 
-  return Some(entry);
+  outstanding.gets.erase(get);
+
+  if (response.code == ZNONODE) {
+    get->promise.set(Option<Entry>::none());
+  } else if (retryable(response.code)) {
+    retry(&pending.gets, get);
+    return;
+  } else if (response.code != ZOK) {
+    get->promise.fail(
+        "Failed to get '" + znode + "/" + get->name +
+        "' in ZooKeeper: " + zk->message(response.code));
+  } else {
+    Try<Entry> entry = deserialize(response.value);
+
+    if (entry.isError()) {
+      get->promise.fail(entry.error());
+    } else {
+      get->promise.set(Option<Entry>::some(entry.get()));
+    }
+  }
+
+  delete get;
 }
 
 
-Result<bool> ZooKeeperStorageProcess::doSet(const Entry& entry, const UUID& uuid)
+void ZooKeeperStorageProcess::__get(
+    int64_t session,
+    Get* get,
+    const list<ZooKeeper::Response<string> >& chunks)
 {
-  CHECK(error.isNone()) << ": " << error.get();
-  CHECK(state == CONNECTED);
+  if (stale(session)) {
+    return;
+  }
+
+  outstanding.gets.erase(get);
 
-  // Serialize to make sure we're under the 1 MB limit.
   string data;
 
-  if (!entry.SerializeToString(&data)) {
-    return Error("Failed to serialize Entry");
+  foreach (const ZooKeeper::Response<string>& chunk, chunks) {
+    if (chunk.code == ZNONODE) {
+      // The entry got set (or expunged) since we got its manifest,
+      // which removed the chunks, so we start over.
+      if (state == CONNECTED) {
+        doGet(get);
+      } else {
+        pending.gets.push(get);
+      }
+      return;
+    } else if (retryable(chunk.code)) {
+      retry(&pending.gets, get);
+      return;
+    } else if (chunk.code != ZOK) {
+      get->promise.fail(
+          "Failed to get a chunk of '" + znode + "/" + get->name +
+          "' in ZooKeeper: " + zk->message(chunk.code));
+      delete get;
+      return;
+    }
+
+    data.append(chunk.value);
   }
 
-  if (data.size() > 1024 * 1024) { // 1 MB
-    // TODO(benh): Use stout/gzip.hpp for compression.
-    return Error("Serialized data is too big (> 1 MB)");
+  Try<Entry> entry = deserialize(data);
+
+  if (entry.isError()) {
+    get->promise.fail(entry.error());
+  } else {
+    get->promise.set(Option<Entry>::some(entry.get()));
   }
 
-  string result;
-  Stat stat;
+  delete get;
+}
 
-  int code = zk->get(znode + "/" + entry.name(), false, &result, &stat);
 
-  if (code == ZNONODE) {
-    // Create directory path znodes as necessary.
-    CHECK(znode.size() == 0 || znode.at(znode.size() - 1) != '/');
-    size_t index = znode.find("/", 0);
+void ZooKeeperStorageProcess::doSet(Set* set)
+{
+  CHECK(error.isNone()) << ": " << error.get();
+  CHECK(state == CONNECTED);
 
-    while (index < string::npos) {
-      // Get out the prefix to create.
-      index = znode.find("/", index + 1);
-      string prefix = znode.substr(0, index);
+  outstanding.sets.insert(set);
 
-      // Create the znode (even if it already exists).
-      code = zk->create(prefix, "", acl, 0, NULL);
+  zk->asyncGet(znode + "/" + set->entry.name(), false)
+    .onReady(defer(self(),
+                   &Self::_set,
+                   zk->getSessionId(),
+                   set,
+                   lambda::_1));
+}
 
-      if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-        CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-        return None(); // Try again later.
-      } else if (code != ZOK && code != ZNODEEXISTS) {
-        return Error(
-            "Failed to create '" + prefix +
-            "' in ZooKeeper: " + zk->message(code));
-      }
+
+void ZooKeeperStorageProcess::_set(
+    int64_t session,
+    Set* set,
+    const ZooKeeper::Response<string>& response)
+{
+  if (stale(session)) {
+    return;
+  }
+
+  set->version = None();
+  set->current = None();
+
+  if (response.code == ZOK) {
+    Try<Entry> current = deserialize(response.value);
+
+    if (current.isError()) {
+      outstanding.sets.erase(set);
+      set->promise.fail(current.error());
+      delete set;
+      return;
+    } else if (UUID::fromBytes(current.get().uuid()) != set->uuid) {
+      outstanding.sets.erase(set);
+      set->promise.set(false);
+      delete set;
+      return;
     }
 
-    code = zk->create(znode + "/" + entry.name(), data, acl, 0, NULL);
-
-    if (code == ZNODEEXISTS) {
-      return false; // Lost a race with someone else.
-    } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-      CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-      return None(); // Try again later.
-    } else if (code != ZOK) {
-      return Error(
-          "Failed to create '" + znode + "/" + entry.name() +
-          "' in ZooKeeper: " + zk->message(code));
+    set->version = response.stat.version;
+
+    if (current.get().has_chunks()) {
+      set->current = current.get();
     }
+  } else if (response.code != ZNONODE) {
+    outstanding.sets.erase(set);
 
-    return true;
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return None(); // Try again later.
-  } else if (code != ZOK) {
-    return Error(
-        "Failed to get '" + znode + "/" + entry.name() +
-        "' in ZooKeeper: " + zk->message(code));
+    if (retryable(response.code)) {
+      retry(&pending.sets, set);
+    } else {
+      set->promise.fail(
+          "Failed to get '" + znode + "/" + set->entry.name() +
+          "' in ZooKeeper: " + zk->message(response.code));
+      delete set;
+    }
+    return;
   }
 
-  google::protobuf::io::ArrayInputStream stream(result.data(), result.size());
+  if (set->data.size() <= CHUNK_SIZE) {
+    swap(session, set);
+    return;
+  }
 
-  Entry current;
+  // Write all of the chunks at once. They are named after the UUID
+  // of the new entry, so nobody reads them before the manifest gets
+  // swapped in.
+  const vector<string> paths = chunks(manifest(set->entry, set->data.size()));
+
+  list<Future<ZooKeeper::Response<string> > > futures;
+  for (size_t i = 0; i < paths.size(); i++) {
+    futures.push_back(zk->asyncCreate(
+        paths[i],
+        set->data.substr(i * CHUNK_SIZE, CHUNK_SIZE),
+        acl,
+        0,
+        true));
+  }
 
-  if (!current.ParseFromZeroCopyStream(&stream)) {
-    return Error("Failed to deserialize Entry");
+  collect(futures)
+    .onReady(defer(self(), &Self::__set, session, set, lambda::_1));
+}
+
+
+void ZooKeeperStorageProcess::__set(
+    int64_t session,
+    Set* set,
+    const list<ZooKeeper::Response<string> >& chunks)
+{
+  if (stale(session)) {
+    return;
   }
 
-  if (UUID::fromBytes(current.uuid()) != uuid) {
-    return false;
+  foreach (const ZooKeeper::Response<string>& chunk, chunks) {
+    // A chunk might exist from an earlier attempt of this set.
+    if (chunk.code != ZOK && chunk.code != ZNODEEXISTS) {
+      swapped(session, set, chunk.code);
+      return;
+    }
+  }
+
+  swap(session, set);
+}
+
+
+void ZooKeeperStorageProcess::swap(int64_t session, Set* set)
+{
+  const string path = znode + "/" + set->entry.name();
+
+  const string data = set->data.size() <= CHUNK_SIZE
+    ? set->data
+    : manifest(set->entry, set->data.size()).SerializeAsString();
+
+  if (set->version.isNone()) {
+    // Create the znode, including the directory path znodes as
+    // necessary.
+    zk->asyncCreate(path, data, acl, 0, true)
+      .then(lambda::bind(&status<string>, lambda::_1))
+      .onReady(defer(self(), &Self::swapped, session, set, lambda::_1));
+  } else if (set->current.isNone()) {
+    // Okay, do the set, we get atomicity by requiring the version.
+    zk->asyncSet(path, data, set->version.get())
+      .then(lambda::bind(&status<Nothing>, lambda::_1))
+      .onReady(defer(self(), &Self::swapped, session, set, lambda::_1));
+  } else {
+    // Same as above but the chunks of the current entry get removed
+    // atomically with the set.
+    vector<ZooKeeper::Op> ops;
+    ops.push_back(ZooKeeper::Op::set(path, data, set->version.get()));
+
+    foreach (const string& chunk, chunks(set->current.get())) {
+      ops.push_back(ZooKeeper::Op::remove(chunk, -1));
+    }
+
+    zk->asyncMulti(ops)
+      .then(lambda::bind(&status<Nothing>, lambda::_1))
+      .onReady(defer(self(), &Self::swapped, session, set, lambda::_1));
+  }
+}
+
+
+void ZooKeeperStorageProcess::swapped(int64_t session, Set* set, int code)
+{
+  if (stale(session)) {
+    return;
+  }
+
+  outstanding.sets.erase(set);
+
+  if (retryable(code)) {
+    retry(&pending.sets, set);
+    return;
   }
 
-  // Okay, do the set, we get atomicity by requiring 'stat.version'.
-  code = zk->set(znode + "/" + entry.name(), data, stat.version);
+  if (code != ZOK && set->data.size() > CHUNK_SIZE) {
+    // Clean up the chunks that didn't make it (in the background).
+    foreach (const string& chunk,
+             chunks(manifest(set->entry, set->data.size()))) {
+      zk->asyncRemove(chunk, -1);
+    }
+  }
 
-  if (code == ZBADVERSION) {
-    return false;
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return None(); // Try again later.
+  if (code == ZNODEEXISTS || code == ZBADVERSION) {
+    set->promise.set(false); // Lost a race with someone else.
   } else if (code != ZOK) {
-    return Error(
-        "Failed to set '" + znode + "/" + entry.name() +
+    set->promise.fail(
+        "Failed to set '" + znode + "/" + set->entry.name() +
         "' in ZooKeeper: " + zk->message(code));
+  } else {
+    set->promise.set(true);
   }
 
-  return true;
+  delete set;
 }
 
 
-Result<bool> ZooKeeperStorageProcess::doExpunge(const Entry& entry)
+void ZooKeeperStorageProcess::doExpunge(Expunge* expunge)
 {
   CHECK(error.isNone()) << ": " << error.get();
   CHECK(state == CONNECTED);
 
-  string result;
-  Stat stat;
+  outstanding.expunges.insert(expunge);
 
-  int code = zk->get(znode + "/" + entry.name(), false, &result, &stat);
+  zk->asyncGet(znode + "/" + expunge->entry.name(), false)
+    .onReady(defer(self(),
+                   &Self::_expunge,
+                   zk->getSessionId(),
+                   expunge,
+                   lambda::_1));
+}
 
-  if (code == ZNONODE) {
-    return false;
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return None(); // Try again later.
-  } else if (code != ZOK) {
-    return Error(
-        "Failed to get '" + znode + "/" + entry.name() +
-        "' in ZooKeeper: " + zk->message(code));
+
+void ZooKeeperStorageProcess::_expunge(
+    int64_t session,
+    Expunge* expunge,
+    const ZooKeeper::Response<string>& response)
+{
+  if (stale(session)) {
+    return;
   }
 
-  google::protobuf::io::ArrayInputStream stream(result.data(), result.size());
+  outstanding.expunges.erase(expunge);
+
+  const string path = znode + "/" + expunge->entry.name();
+
+  if (response.code == ZNONODE) {
+    expunge->promise.set(false);
+    delete expunge;
+    return;
+  } else if (retryable(response.code)) {
+    retry(&pending.expunges, expunge);
+    return;
+  } else if (response.code != ZOK) {
+    expunge->promise.fail(
+        "Failed to get '" + path +
+        "' in ZooKeeper: " + zk->message(response.code));
+    delete expunge;
+    return;
+  }
 
-  Entry current;
+  Try<Entry> current = deserialize(response.value);
+
+  if (current.isError()) {
+    expunge->promise.fail(current.error());
+    delete expunge;
+    return;
+  } else if (UUID::fromBytes(current.get().uuid()) !=
+             UUID::fromBytes(expunge->entry.uuid())) {
+    expunge->promise.set(false);
+    delete expunge;
+    return;
+  }
 
-  if (!current.ParseFromZeroCopyStream(&stream)) {
-    return Error("Failed to deserialize Entry");
+  outstanding.expunges.insert(expunge);
+
+  if (!current.get().has_chunks()) {
+    // Okay, do the remove, we get atomicity by requiring the version.
+    zk->asyncRemove(path, response.stat.version)
+      .onReady(defer(self(), &Self::__expunge, session, expunge, lambda::_1));
+    return;
+  }
+
+  // Same as above but the chunks get removed atomically with the
+  // manifest.
+  vector<ZooKeeper::Op> ops;
+  ops.push_back(ZooKeeper::Op::remove(path, response.stat.version));
+
+  foreach (const string& chunk, chunks(current.get())) {
+    ops.push_back(ZooKeeper::Op::remove(chunk, -1));
   }
 
-  if (UUID::fromBytes(current.uuid()) != UUID::fromBytes(entry.uuid())) {
-    return false;
+  zk->asyncMulti(ops)
+    .onReady(defer(self(), &Self::__expunge, session, expunge, lambda::_1));
+}
+
+
+void ZooKeeperStorageProcess::__expunge(
+    int64_t session,
+    Expunge* expunge,
+    const ZooKeeper::Response<Nothing>& response)
+{
+  if (stale(session)) {
+    return;
   }
 
-  // Okay, do the remove, we get atomicity by requiring 'stat.version'.
-  code = zk->remove(znode + "/" + entry.name(), stat.version);
+  outstanding.expunges.erase(expunge);
+
+  if (response.code == ZBADVERSION) {
+    expunge->promise.set(false);
+  } else if (retryable(response.code)) {
+    retry(&pending.expunges, expunge);
+    return;
+  } else if (response.code != ZOK) {
+    expunge->promise.fail(
+        "Failed to remove '" + znode + "/" + expunge->entry.name() +
+        "' in ZooKeeper: " + zk->message(response.code));
+  } else {
+    expunge->promise.set(true);
+  }
 
-  if (code == ZBADVERSION) {
-    return false;
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return None(); // Try again later.
-  } else if (code != ZOK) {
-    return Error(
-        "Failed to remove '" + znode + "/" + entry.name() +
-        "' in ZooKeeper: " + zk->message(code));
+  delete expunge;
+}
+
+
+vector<string> ZooKeeperStorageProcess::chunks(const Entry& manifest)
+{
+  CHECK(manifest.has_chunks());
+
+  const string prefix = znode + "/" + CHUNKS + "/" + manifest.name() + "-" +
+    UUID::fromBytes(manifest.uuid()).toString() + "-";
+
+  vector<string> paths;
+  for (uint32_t i = 0; i < manifest.chunks(); i++) {
+    paths.push_back(prefix + stringify(i));
+  }
+
+  return paths;
+}
+
+
+void ZooKeeperStorageProcess::trigger(const Option<string>& path)
+{
+  if (path.isSome()) {
+    if (watches.contains(path.get())) {
+      foreach (Promise<Nothing>* promise, watches[path.get()]) {
+        promise->set(Nothing());
+        delete promise;
+      }
+      watches.erase(path.get());
+    }
+    return;
+  }
+
+  foreachvalue (const list<Promise<Nothing>*>& promises, watches) {
+    foreach (Promise<Nothing>* promise, promises) {
+      promise->set(Nothing());
+      delete promise;
+    }
+  }
+  watches.clear();
+}
+
+
+void ZooKeeperStorageProcess::flush()
+{
+  retrying = false;
+
+  if (error.isSome() || state != CONNECTED) {
+    return; // Try again once connected.
+  }
+
+  while (!pending.names.empty()) {
+    doNames(pending.names.front());
+    pending.names.pop();
+  }
+
+  while (!pending.gets.empty()) {
+    doGet(pending.gets.front());
+    pending.gets.pop();
+  }
+
+  while (!pending.sets.empty()) {
+    doSet(pending.sets.front());
+    pending.sets.pop();
+  }
+
+  while (!pending.expunges.empty()) {
+    doExpunge(pending.expunges.front());
+    pending.expunges.pop();
   }
+}
+
+
+template <typename T>
+void ZooKeeperStorageProcess::retry(queue<T*>* queue, T* t)
+{
+  CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
+
+  queue->push(t);
 
-  return true;
+  // Usually we get disconnected and 'connected' starts the operation
+  // over, but in case we were reconnected before the response arrived
+  // (or never got disconnected) we start it over after a while.
+  if (!retrying) {
+    retrying = true;
+    delay(RETRY_INTERVAL, self(), &Self::flush);
+  }
+}
+
+
+bool ZooKeeperStorageProcess::retryable(int code)
+{
+  return code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code));
+}
+
+
+bool ZooKeeperStorageProcess::stale(int64_t session)
+{
+  return zk->getSessionId() != session;
 }
 
 } // namespace state {
@@ -1,7 +1,9 @@
 #ifndef __STATE_ZOOKEEPER_HPP__
 #define __STATE_ZOOKEEPER_HPP__
 
+#include <list>
 #include <queue>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -10,6 +12,8 @@
 #include <process/process.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
@@ -31,6 +35,11 @@ namespace state {
 class ZooKeeperStorageProcess;
 
 
+// A storage backed by ZooKeeper, where each entry is stored in a
+// znode named after the entry under 'znode'. Entries that are too big
+// for a single znode get split into chunks, which are written (in
+// parallel) to znodes under 'znode/.chunks' before a manifest of the
+// entry (see Entry::chunks) gets swapped into the znode of the entry.
 class ZooKeeperStorage : public Storage
 {
 public:
@@ -48,6 +57,7 @@ public:
   virtual process::Future<bool> set(const Entry& entry, const UUID& uuid);
   virtual process::Future<bool> expunge(const Entry& entry);
   virtual process::Future<std::vector<std::string> > names();
+  virtual process::Future<Nothing> watch(const std::string& name);
 
 private:
   ZooKeeperStorageProcess* process;
@@ -71,6 +81,7 @@ public:
   process::Future<bool> set(const Entry& entry, const UUID& uuid);
   virtual process::Future<bool> expunge(const Entry& entry);
   process::Future<std::vector<std::string> > names();
+  process::Future<Nothing> watch(const std::string& name);
 
   // ZooKeeper events.
   void connected(bool reconnect);
@@ -81,12 +92,6 @@ public:
   void deleted(const std::string& path);
 
 private:
-  // Helpers for getting the names, fetching, and swapping.
-  Result<std::vector<std::string> > doNames();
-  Result<Option<Entry> > doGet(const std::string& name);
-  Result<bool> doSet(const Entry& entry, const UUID& uuid);
-  Result<bool> doExpunge(const Entry& entry);
-
   const std::string servers;
 
   // The session timeout requested by the client.
@@ -122,11 +127,18 @@ private:
 
   struct Set
   {
-    Set(const Entry& _entry, const UUID& _uuid)
-      : entry(_entry), uuid(_uuid) {}
+    Set(const Entry& _entry, const UUID& _uuid, const std::string& _data)
+      : entry(_entry), uuid(_uuid), data(_data) {}
     Entry entry;
     UUID uuid;
+    std::string data; // The serialized entry.
     process::Promise<bool> promise;
+
+    // The version of the znode of the entry (none if there is no
+    // znode yet) and the manifest of the current entry if it is
+    // chunked, as determined by the last attempt.
+    Option<int> version;
+    Option<Entry> current;
   };
 
   struct Expunge
@@ -137,6 +149,86 @@ private:
     process::Promise<bool> promise;
   };
 
+  // Helpers for getting the names, fetching, and swapping. The
+  // requests are sent asynchronously, so independent operations are
+  // performed concurrently. An operation that fails with a retryable
+  // error gets queued and is started over once we're connected.
+  void doNames(Names* names);
+  void _names(
+      int64_t session,
+      Names* names,
+      const ZooKeeper::Response<std::vector<std::string> >& response);
+
+  void doGet(Get* get);
+  void _get(
+      int64_t session,
+      Get* get,
+      const ZooKeeper::Response<std::string>& response);
+  void __get(
+      int64_t session,
+      Get* get,
+      const std::list<ZooKeeper::Response<std::string> >& chunks);
+
+  void doSet(Set* set);
+  void _set(
+      int64_t session,
+      Set* set,
+      const ZooKeeper::Response<std::string>& response);
+  void __set(
+      int64_t session,
+      Set* set,
+      const std::list<ZooKeeper::Response<std::string> >& chunks);
+  void swap(int64_t session, Set* set);
+  void swapped(int64_t session, Set* set, int code);
+
+  void doExpunge(Expunge* expunge);
+  void _expunge(
+      int64_t session,
+      Expunge* expunge,
+      const ZooKeeper::Response<std::string>& response);
+  void __expunge(
+      int64_t session,
+      Expunge* expunge,
+      const ZooKeeper::Response<Nothing>& response);
+
+  // Continuation of watching, the watch gets triggered if it could
+  // not be set.
+  void _watch(
+      int64_t session,
+      const std::string& path,
+      const ZooKeeper::Response<Nothing>& response);
+
+  // Returns the paths of the znodes holding the chunks of an entry
+  // that is too big to be stored in a single znode, given its
+  // manifest (see Entry::chunks).
+  std::vector<std::string> chunks(const Entry& manifest);
+
+  // Triggers the watches of a path (all of them if none).
+  void trigger(const Option<std::string>& path);
+
+  // Continuation of authenticating in 'connected'.
+  void authenticated(
+      int64_t session,
+      const ZooKeeper::Response<Nothing>& response);
+
+  // Starts all of the pending operations (if connected).
+  void flush();
+
+  // Queues an operation to be started over, see 'flush'.
+  template <typename T>
+  void retry(std::queue<T*>* queue, T* t);
+
+  // Returns true if the error code warrants retrying the operation.
+  bool retryable(int code);
+
+  // Returns true if the response is from an expired session, the
+  // operation has been queued again on expiration.
+  bool stale(int64_t session);
+
+  // Time to wait before starting over operations that failed with a
+  // retryable error while we appear to be connected.
+  static const Duration RETRY_INTERVAL;
+
   // TODO(benh): Make pending a single queue of "operations" that can
   // be "invoked" (C++11 lambdas would help).
   struct {
@@ -146,6 +238,20 @@ private:
     std::queue<Expunge*> expunges;
   } pending;
 
+  // Operations that have been sent but not answered yet.
+  struct {
+    std::set<Names*> names;
+    std::set<Get*> gets;
+    std::set<Set*> sets;
+    std::set<Expunge*> expunges;
+  } outstanding;
+
+  // Watches (see Storage::watch) by the path of their znode.
+  hashmap<std::string, std::list<process::Promise<Nothing>*> > watches;
+
+  // Whether 'flush' has been delayed after a retryable error.
+  bool retrying;
+
   Option<std::string> error;
 };
 
@@ -196,6 +302,13 @@ inline process::Future<std::vector<std::string> > ZooKeeperStorage::names()
   return process::dispatch(process, &ZooKeeperStorageProcess::names);
 }
 
+
+inline process::Future<Nothing> ZooKeeperStorage::watch(
+    const std::string& name)
+{
+  return process::dispatch(process, &ZooKeeperStorageProcess::watch, name);
+}
+
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
@@ -18,16 +18,24 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include <mesos/executor.hpp>
 #include <mesos/resources.hpp>
 #include <mesos/scheduler.hpp>
 
+#include <process/clock.hpp>
 #include <process/dispatch.hpp>
 #include <process/gmock.hpp>
 #include <process/owned.hpp>
+#include <process/process.hpp>
 
 #include <stout/nothing.hpp>
 
+#include "master/constants.hpp"
+
+#include "sasl/authenticatee.hpp"
+
 #include "tests/mesos.hpp"
 #include "tests/utils.hpp"
 
@@ -39,6 +47,11 @@ using namespace mesos::internal::tests;
 using namespace process;
 
 using mesos::internal::master::Master;
+using mesos::internal::master::MAX_CONCURRENT_AUTHENTICATIONS;
+
+using mesos::internal::sasl::Authenticatee;
+
+using std::vector;
 
 using testing::_;
 using testing::Eq;
@@ -419,3 +432,88 @@ TEST_F(AuthenticationTest, SchedulerFailover)
 
   Shutdown();
 }
+
+
+// This test verifies that the master queues up authentication
+// requests once MAX_CONCURRENT_AUTHENTICATIONS are in progress, starts
+// a queued up request when an authentication finishes, and uses the
+// latest authenticatee of a framework that re-authenticates while its
+// request is queued up.
+TEST_F(AuthenticationTest, QueuedAuthentication)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  Clock::pause();
+  Clock::settle(); // Wait for the master to get elected.
+
+  // Fill all authentication slots with authenticatees that never
+  // respond. The first one starts a second before the others, so
+  // that it times out (and frees its slot) on its own.
+  vector<UPID> authenticatees;
+  for (uint32_t i = 0; i < MAX_CONCURRENT_AUTHENTICATIONS; i++) {
+    authenticatees.push_back(spawn(new ProcessBase(), true));
+  }
+
+  Future<AuthenticationMechanismsMessage> started = FUTURE_PROTOBUF(
+      AuthenticationMechanismsMessage(), master.get(), authenticatees[0]);
+
+  foreach (const UPID& authenticatee, authenticatees) {
+    AuthenticateMessage message;
+    message.set_pid(authenticatee);
+    process::post(authenticatee, master.get(), message);
+
+    if (authenticatee == authenticatees[0]) {
+      AWAIT_READY(started);
+      Clock::settle();
+      Clock::advance(Seconds(1));
+    }
+  }
+
+  Clock::settle();
+
+  // The authentication of this framework has to wait for a slot.
+  UPID framework = spawn(new ProcessBase(), true);
+  UPID original = spawn(new ProcessBase(), true);
+
+  Future<AuthenticationMechanismsMessage> mechanisms = FUTURE_PROTOBUF(
+      AuthenticationMechanismsMessage(), master.get(), original);
+
+  AuthenticateMessage message;
+  message.set_pid(framework);
+  process::post(original, master.get(), message);
+
+  Clock::settle();
+
+  EXPECT_TRUE(mechanisms.isPending());
+
+  // Re-authenticate the framework while its request is queued up.
+  Authenticatee authenticatee(DEFAULT_CREDENTIAL, framework);
+
+  Future<bool> authenticated = authenticatee.authenticate(master.get());
+
+  Clock::settle();
+
+  EXPECT_TRUE(authenticated.isPending());
+
+  // Time out the first authentication, which frees up its slot for
+  // the queued up request.
+  Clock::advance(Milliseconds(4500));
+  Clock::settle();
+
+  AWAIT_EQ(true, authenticated);
+
+  // The replaced authenticatee never got to authenticate.
+  EXPECT_TRUE(mechanisms.isPending());
+
+  Clock::resume();
+
+  foreach (const UPID& pid, authenticatees) {
+    terminate(pid);
+  }
+
+  terminate(framework);
+  terminate(original);
+
+  Shutdown();
+}
@@ -30,6 +30,7 @@
 
 #include <process/future.hpp>
 #include <process/gmock.hpp>
+#include <process/http.hpp>
 #include <process/owned.hpp>
 #include <process/pid.hpp>
 #include <process/process.hpp>
@@ -197,6 +198,166 @@ TEST_F(FaultToleranceTest, PartitionedSlave)
 }
 
 
+// This test checks that when only one of several slaves is
+// partitioned, only that slave is removed (i.e., the slaves are
+// health checked independently).
+TEST_F(FaultToleranceTest, PartitionedSlaveAmongHealthySlaves)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Future<Message> pong = FUTURE_MESSAGE(Eq("PONG"), _, _);
+
+  Try<PID<Slave> > slave1 = StartSlave();
+  ASSERT_SOME(slave1);
+
+  AWAIT_READY(slaveRegisteredMessage);
+  AWAIT_READY(pong);
+
+  // Drop the PONGs of the second slave to simulate its partition.
+  pong = DROP_MESSAGE(Eq("PONG"), _, _);
+
+  Try<PID<Slave> > slave2 = StartSlave();
+  ASSERT_SOME(slave2);
+
+  AWAIT_READY(pong);
+  ASSERT_EQ(slave2.get(), pong.get().from);
+
+  DROP_MESSAGES(Eq("PONG"), slave2.get(), _);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get(), DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<Nothing> resourceOffers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureSatisfy(&resourceOffers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  EXPECT_CALL(sched, offerRescinded(&driver, _))
+    .Times(AtMost(1));
+
+  // Only the second slave should get lost.
+  Future<SlaveID> slaveLost;
+  EXPECT_CALL(sched, slaveLost(&driver, _))
+    .WillOnce(FutureArg<1>(&slaveLost));
+
+  driver.start();
+
+  AWAIT_READY(resourceOffers);
+
+  Clock::pause();
+
+  // Advance through more PINGs than it takes to remove a slave.
+  for (uint32_t i = 0; i <= master::MAX_SLAVE_PING_TIMEOUTS; i++) {
+    Clock::advance(master::SLAVE_PING_TIMEOUT);
+    Clock::settle();
+  }
+
+  AWAIT_READY(slaveLost);
+  EXPECT_NE(slaveRegisteredMessage.get().slave_id().value(),
+            slaveLost.get().value());
+
+  // The first slave should still be healthy.
+  Clock::advance(master::SLAVE_PING_TIMEOUT);
+  Clock::settle();
+
+  driver.stop();
+  driver.join();
+
+  Shutdown();
+
+  Clock::resume();
+}
+
+
+// Replies to the master's PINGs, standing in for a slave that
+// re-registered from another pid.
+class PongProcess : public process::Process<PongProcess>
+{
+public:
+  PongProcess()
+  {
+    install("PING", &PongProcess::ping);
+  }
+
+private:
+  void ping(const UPID& from, const string& body)
+  {
+    send(from, "PONG");
+  }
+};
+
+
+// This test checks that the master health checks a slave at the pid
+// it re-registered from, rather than at the pid it registered from.
+TEST_F(FaultToleranceTest, ReregisteredSlaveHealthCheck)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  Future<RegisterSlaveMessage> registerSlaveMessage =
+    FUTURE_PROTOBUF(RegisterSlaveMessage(), _, _);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Try<PID<Slave> > slave = StartSlave();
+  ASSERT_SOME(slave);
+
+  // Only the PONGs of the new pid get through.
+  DROP_MESSAGES(Eq("PONG"), slave.get(), _);
+
+  AWAIT_READY(registerSlaveMessage);
+  AWAIT_READY(slaveRegisteredMessage);
+
+  PongProcess pong;
+  process::spawn(pong);
+
+  Future<SlaveReregisteredMessage> slaveReregisteredMessage =
+    FUTURE_PROTOBUF(SlaveReregisteredMessage(), _, pong.self());
+
+  ReregisterSlaveMessage message;
+  message.mutable_slave_id()->MergeFrom(
+      slaveRegisteredMessage.get().slave_id());
+  message.mutable_slave()->MergeFrom(registerSlaveMessage.get().slave());
+
+  process::post(pong.self(), master.get(), message);
+
+  AWAIT_READY(slaveReregisteredMessage);
+
+  Clock::pause();
+
+  // Advance through more PINGs than it takes to remove a slave.
+  for (uint32_t i = 0; i <= master::MAX_SLAVE_PING_TIMEOUTS; i++) {
+    Clock::advance(master::SLAVE_PING_TIMEOUT);
+    Clock::settle();
+  }
+
+  Clock::resume();
+
+  // The slave should still be active.
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "stats.json");
+
+  AWAIT_READY(response);
+  EXPECT_NE(string::npos,
+            response.get().body.find("\"activated_slaves\":1"));
+  EXPECT_NE(string::npos,
+            response.get().body.find("\"deactivated_slaves\":0"));
+
+  process::terminate(pong);
+  process::wait(pong);
+
+  Shutdown();
+}
+
+
 // The purpose of this test is to ensure that when slaves are removed
 // from the master, and then attempt to re-register, we deny the
 // re-registration by sending a ShutdownMessage to the slave.
@@ -213,8 +374,8 @@ TEST_F(FaultToleranceTest, PartitionedSlaveReregistration)
 
   // Allow the master to PING the slave, but drop all PONG messages
   // from the slave. Note that we don't match on the master / slave
-  // PIDs because it's actually the SlaveObserver Process that sends
-  // the pings.
+  // PIDs because it's actually the SlaveHealthChecker Process that
+  // sends the pings.
   Future<Message> ping = FUTURE_MESSAGE(Eq("PING"), _, _);
   DROP_MESSAGES(Eq("PONG"), _, _);
 
@@ -365,8 +526,8 @@ TEST_F(FaultToleranceTest, PartitionedSlaveStatusUpdates)
 
   // Allow the master to PING the slave, but drop all PONG messages
   // from the slave. Note that we don't match on the master / slave
-  // PIDs because it's actually the SlaveObserver Process that sends
-  // the pings.
+  // PIDs because it's actually the SlaveHealthChecker Process that
+  // sends the pings.
   Future<Message> ping = FUTURE_MESSAGE(Eq("PING"), _, _);
   DROP_MESSAGES(Eq("PONG"), _, _);
 
@@ -477,8 +638,8 @@ TEST_F(FaultToleranceTest, PartitionedSlaveExitedExecutor)
 
   // Allow the master to PING the slave, but drop all PONG messages
   // from the slave. Note that we don't match on the master / slave
-  // PIDs because it's actually the SlaveObserver Process that sends
-  // the pings.
+  // PIDs because it's actually the SlaveHealthChecker Process that
+  // sends the pings.
   Future<Message> ping = FUTURE_MESSAGE(Eq("PING"), _, _);
   DROP_MESSAGES(Eq("PONG"), _, _);
 
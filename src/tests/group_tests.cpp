@@ -20,15 +20,19 @@
 
 #include <gmock/gmock.h>
 
+#include <map>
+#include <set>
 #include <string>
 
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
 
 #include "tests/zookeeper.hpp"
 
@@ -197,6 +201,85 @@ TEST_F(GroupTest, GroupWatchWithSessionExpiration)
 }
 
 
+// A join that is outstanding when the session expires gets sent again
+// with the new session (which creates the base path again).
+TEST_F(GroupTest, GroupJoinWithSessionExpiration)
+{
+  Group group(server->connectString(), NO_TIMEOUT, "/test/");
+
+  Future<Group::Membership> membership1 = group.join("hello world");
+
+  AWAIT_READY(membership1);
+
+  Future<Option<int64_t> > session = group.session();
+
+  AWAIT_READY(session);
+  ASSERT_SOME(session.get());
+
+  server->shutdownNetwork();
+
+  Future<Group::Membership> membership2 = group.join("hello again");
+
+  EXPECT_TRUE(membership2.isPending());
+
+  server->expireSession(session.get().get());
+
+  server->startNetwork();
+
+  AWAIT_READY(membership2);
+
+  ASSERT_TRUE(membership1.get().cancelled().isReady());
+  ASSERT_FALSE(membership1.get().cancelled().get());
+
+  Future<std::set<Group::Membership> > memberships = group.watch();
+
+  AWAIT_READY(memberships);
+  EXPECT_EQ(1u, memberships.get().size());
+  EXPECT_EQ(1u, memberships.get().count(membership2.get()));
+
+  Future<std::string> data = group.data(membership2.get());
+
+  AWAIT_EXPECT_EQ("hello again", data);
+}
+
+
+// A cancel that is outstanding when the session expires finds the
+// membership gone with the new session.
+TEST_F(GroupTest, GroupCancelWithSessionExpiration)
+{
+  Group group(server->connectString(), NO_TIMEOUT, "/test/");
+
+  Future<Group::Membership> membership = group.join("hello world");
+
+  AWAIT_READY(membership);
+
+  Future<Option<int64_t> > session = group.session();
+
+  AWAIT_READY(session);
+  ASSERT_SOME(session.get());
+
+  server->shutdownNetwork();
+
+  Future<bool> cancellation = group.cancel(membership.get());
+
+  EXPECT_TRUE(cancellation.isPending());
+
+  server->expireSession(session.get().get());
+
+  server->startNetwork();
+
+  AWAIT_EXPECT_EQ(false, cancellation);
+
+  ASSERT_TRUE(membership.get().cancelled().isReady());
+  ASSERT_FALSE(membership.get().cancelled().get());
+
+  Future<std::set<Group::Membership> > memberships = group.watch();
+
+  AWAIT_READY(memberships);
+  EXPECT_EQ(0u, memberships.get().size());
+}
+
+
 TEST_F(GroupTest, MultipleGroups)
 {
   Group group1(server->connectString(), NO_TIMEOUT, "/test/");
@@ -261,6 +344,55 @@ TEST_F(GroupTest, MultipleGroups)
 }
 
 
+// Verifies that a group serves the data of many memberships (which
+// it fetches at once when it learns about them) and of memberships
+// that joined later.
+TEST_F(GroupTest, GroupDataOfManyMemberships)
+{
+  Group group1(server->connectString(), NO_TIMEOUT, "/test/");
+  Group group2(server->connectString(), NO_TIMEOUT, "/test/");
+
+  std::map<Group::Membership, std::string> joined;
+
+  for (int i = 0; i < 10; i++) {
+    Future<Group::Membership> membership =
+      group1.join("member " + stringify(i));
+
+    AWAIT_READY(membership);
+
+    joined[membership.get()] = "member " + stringify(i);
+  }
+
+  Future<std::set<Group::Membership> > memberships = group2.watch();
+
+  AWAIT_READY(memberships);
+
+  // NOTE: Since 'group1' joining doesn't guarantee that 'group2'
+  // knows about it synchronously, we have to wait until 'group2'
+  // knows about all of the memberships.
+  while (memberships.get().size() < joined.size()) {
+    memberships = group2.watch(memberships.get());
+    AWAIT_READY(memberships);
+  }
+
+  foreach (const Group::Membership& membership, memberships.get()) {
+    AWAIT_EXPECT_EQ(joined[membership], group2.data(membership));
+  }
+
+  // The data of a membership that joins later gets fetched as well.
+  Future<Group::Membership> membership = group1.join("member 10");
+
+  AWAIT_READY(membership);
+
+  memberships = group2.watch(memberships.get());
+
+  AWAIT_READY(memberships);
+  EXPECT_EQ(1u, memberships.get().count(membership.get()));
+
+  AWAIT_EXPECT_EQ("member 10", group2.data(membership.get()));
+}
+
+
 TEST_F(GroupTest, GroupPathWithRestrictivePerms)
 {
   ZooKeeperTest::TestWatcher watcher;
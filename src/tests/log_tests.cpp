@@ -21,6 +21,7 @@
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/clock.hpp>
 #include <process/future.hpp>
@@ -32,6 +33,7 @@
 #include <process/protobuf.hpp>
 #include <process/shared.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
@@ -63,6 +65,7 @@ using namespace process;
 using std::list;
 using std::set;
 using std::string;
+using std::vector;
 
 using testing::_;
 using testing::Eq;
@@ -323,6 +326,148 @@ TEST_F(ReplicaTest, Restore)
 }
 
 
+// A restarted replica only reads the positions after the snapshot of
+// the learned positions but still knows about the positions (holes)
+// that have not been learned.
+TEST_F(ReplicaTest, RestoreSnapshot)
+{
+  const string path = os::getcwd() + "/.log";
+  initializer.flags.path = path;
+  initializer.execute();
+
+  {
+    Replica replica1(path);
+
+    list<Action> actions;
+
+    for (uint64_t position = 0; position <= 12; position++) {
+      if (position == 10 || position == 11) {
+        continue;
+      }
+
+      Action action;
+      action.set_position(position);
+      action.set_promised(1);
+      action.set_performed(1);
+      action.set_learned(true);
+      action.set_type(Action::APPEND);
+      action.mutable_append()->set_bytes(stringify(position));
+      actions.push_back(action);
+    }
+
+    AWAIT_EXPECT_EQ(true, replica1.learn(actions));
+
+    Action action;
+    action.set_position(13);
+    action.set_promised(1);
+    action.set_performed(1);
+    action.set_learned(true);
+    action.set_type(Action::TRUNCATE);
+    action.mutable_truncate()->set_to(3);
+
+    AWAIT_EXPECT_EQ(true, replica1.learn(list<Action>(1, action)));
+  }
+
+  Replica replica2(path);
+
+  AWAIT_EXPECT_EQ(3u, replica2.beginning());
+  AWAIT_EXPECT_EQ(13u, replica2.ending());
+
+  Future<set<uint64_t> > missing = replica2.missing(3, 13);
+  AWAIT_READY(missing);
+
+  set<uint64_t> holes;
+  holes.insert(10);
+  holes.insert(11);
+
+  EXPECT_EQ(holes, missing.get());
+
+  Future<list<Action> > actions = replica2.read(3, 9);
+  AWAIT_READY(actions);
+  ASSERT_EQ(7u, actions.get().size());
+
+  foreach (const Action& action, actions.get()) {
+    EXPECT_TRUE(action.learned());
+    ASSERT_EQ(Action::APPEND, action.type());
+    EXPECT_EQ(stringify(action.position()), action.append().bytes());
+  }
+
+  // Reading across the holes (partly from memory now).
+  actions = replica2.read(8, 13);
+  AWAIT_READY(actions);
+  ASSERT_EQ(4u, actions.get().size());
+
+  list<uint64_t> positions;
+  foreach (const Action& action, actions.get()) {
+    positions.push_back(action.position());
+  }
+
+  list<uint64_t> expected;
+  expected.push_back(8);
+  expected.push_back(9);
+  expected.push_back(12);
+  expected.push_back(13);
+
+  EXPECT_EQ(expected, positions);
+}
+
+
+// Writes to a replica without waiting for the previous writes to be
+// acknowledged, which get persisted together.
+TEST_F(ReplicaTest, ConcurrentWrites)
+{
+  const string path = os::getcwd() + "/.log";
+  initializer.flags.path = path;
+  initializer.execute();
+
+  Replica replica1(path);
+
+  const uint64_t proposal = 1;
+
+  PromiseRequest request1;
+  request1.set_proposal(proposal);
+
+  Future<PromiseResponse> future1 =
+    protocol::promise(replica1.pid(), request1);
+
+  list<Future<WriteResponse> > futures2;
+  for (uint64_t position = 1; position <= 10; position++) {
+    WriteRequest request2;
+    request2.set_proposal(proposal);
+    request2.set_position(position);
+    request2.set_type(Action::APPEND);
+    request2.mutable_append()->set_bytes(stringify(position));
+
+    futures2.push_back(protocol::write(replica1.pid(), request2));
+  }
+
+  AWAIT_READY(future1);
+  EXPECT_TRUE(future1.get().okay());
+
+  uint64_t position = 1;
+  foreach (const Future<WriteResponse>& future2, futures2) {
+    AWAIT_READY(future2);
+    EXPECT_TRUE(future2.get().okay());
+    EXPECT_EQ(proposal, future2.get().proposal());
+    EXPECT_EQ(position++, future2.get().position());
+  }
+
+  Replica replica2(path);
+
+  Future<list<Action> > actions = replica2.read(1, 10);
+
+  AWAIT_READY(actions);
+  ASSERT_EQ(10u, actions.get().size());
+
+  foreach (const Action& action, actions.get()) {
+    EXPECT_EQ(proposal, action.promised());
+    EXPECT_EQ(proposal, action.performed());
+    ASSERT_EQ(Action::APPEND, action.type());
+    EXPECT_EQ(stringify(action.position()), action.append().bytes());
+  }
+}
+
+
 class CoordinatorTest : public TemporaryDirectoryTest
 {
 protected:
@@ -870,6 +1015,60 @@ TEST_F(CoordinatorTest, MultipleAppends)
 }
 
 
+// Appends without waiting for the previous appends to finish, more
+// of them than can be written concurrently.
+TEST_F(CoordinatorTest, ConcurrentAppends)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  initializer.execute();
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  initializer.execute();
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network, 4);
+
+  {
+    Future<Option<uint64_t> > electing = coord.elect();
+    AWAIT_READY_FOR(electing, Seconds(10));
+    ASSERT_SOME(electing.get());
+    EXPECT_EQ(0u, electing.get().get());
+  }
+
+  list<Future<uint64_t> > appendings;
+  for (uint64_t position = 1; position <= 10; position++) {
+    appendings.push_back(coord.append(stringify(position)));
+  }
+
+  uint64_t position = 1;
+  foreach (const Future<uint64_t>& appending, appendings) {
+    AWAIT_READY_FOR(appending, Seconds(10));
+    EXPECT_EQ(position++, appending.get());
+  }
+
+  {
+    Future<list<Action> > actions = replica2->read(1, 10);
+    AWAIT_READY(actions);
+    EXPECT_EQ(10u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+}
+
+
 TEST_F(CoordinatorTest, MultipleAppendsNotLearnedFill)
 {
   const string path1 = os::getcwd() + "/.log1";
@@ -1288,6 +1487,83 @@ TEST_F(RecoverTest, RacingCatchup)
 }
 
 
+// A recovering replica reads the learned actions from the other
+// replicas rather than running Paxos for each of the positions.
+TEST_F(RecoverTest, CatchupRead)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  initializer.execute();
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  initializer.execute();
+
+  const string path3 = os::getcwd() + "/.log3";
+  initializer.flags.path = path3;
+  initializer.execute();
+
+  const string path4 = os::getcwd() + "/.log4";
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+  Shared<Replica> replica3(new Replica(path3));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+  pids.insert(replica3->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord(2, replica1, network1);
+
+  {
+    Future<Option<uint64_t> > electing = coord.elect();
+    AWAIT_READY_FOR(electing, Seconds(10));
+    ASSERT_SOME(electing.get());
+    EXPECT_EQ(0u, electing.get().get());
+  }
+
+  for (uint64_t position = 1; position <= 10; position++) {
+    Future<uint64_t> appending = coord.append(stringify(position));
+    AWAIT_READY_FOR(appending, Seconds(10));
+    EXPECT_EQ(position, appending.get());
+  }
+
+  Future<uint64_t> promised = replica2->promised();
+  AWAIT_READY(promised);
+
+  Owned<Replica> replica4(new Replica(path4));
+
+  pids.insert(replica4->pid());
+
+  Shared<Network> network2(new Network(pids));
+
+  Future<Owned<Replica> > recovering = recover(2, replica4, network2);
+  AWAIT_READY_FOR(recovering, Seconds(10));
+
+  Shared<Replica> shared4 = recovering.get().share();
+
+  {
+    Future<list<Action> > actions = shared4->read(1, 10);
+    AWAIT_READY(actions);
+    EXPECT_EQ(10u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      EXPECT_TRUE(action.learned());
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  // Nobody had to promise anything to a new proposer.
+  AWAIT_EXPECT_EQ(promised.get(), replica1->promised());
+  AWAIT_EXPECT_EQ(promised.get(), replica2->promised());
+  AWAIT_EXPECT_EQ(promised.get(), replica3->promised());
+}
+
+
 class LogTest : public TemporaryDirectoryTest
 {
 protected:
@@ -1332,6 +1608,73 @@ TEST_F(LogTest, WriteRead)
 }
 
 
+TEST_F(LogTest, WriteReadRecords)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  initializer.execute();
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  initializer.execute();
+
+  Replica replica1(path1);
+
+  set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+
+  Log::Writer writer(&log, Seconds(10));
+
+  Result<Log::Position> position1 =
+    writer.append("hello", Timeout::in(Seconds(10)));
+
+  ASSERT_SOME(position1);
+
+  vector<string> records;
+  records.push_back("a");
+  records.push_back("");
+  records.push_back("c");
+
+  Result<Log::Position> position2 =
+    writer.append(records, Timeout::in(Seconds(10)));
+
+  ASSERT_SOME(position2);
+
+  Result<Log::Position> position3 =
+    writer.append("world", Timeout::in(Seconds(10)));
+
+  ASSERT_SOME(position3);
+
+  EXPECT_ERROR(writer.append(vector<string>(), Timeout::in(Seconds(10))));
+
+  Log::Reader reader(&log);
+
+  Result<list<Log::Entry> > entries =
+    reader.read(position1.get(), position3.get(), Timeout::in(Seconds(10)));
+
+  ASSERT_SOME(entries);
+  ASSERT_EQ(5u, entries.get().size());
+
+  const list<Log::Entry> results = entries.get();
+  list<Log::Entry>::const_iterator entry = results.begin();
+
+  EXPECT_EQ(position1.get(), entry->position);
+  EXPECT_EQ("hello", entry->data);
+
+  foreach (const string& record, records) {
+    ++entry;
+    EXPECT_EQ(position2.get(), entry->position);
+    EXPECT_EQ(record, entry->data);
+  }
+
+  ++entry;
+  EXPECT_EQ(position3.get(), entry->position);
+  EXPECT_EQ("world", entry->data);
+}
+
+
 TEST_F(LogTest, Position)
 {
   const string path1 = os::getcwd() + "/.log1";
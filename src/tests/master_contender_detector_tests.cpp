@@ -39,6 +39,7 @@
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/try.hpp>
 
 #include "master/contender.hpp"
@@ -633,6 +634,74 @@ TEST_F(ZooKeeperMasterContenderDetectorTest,
 }
 
 
+// Measures how long it takes a detector to learn about the new
+// leading master once the session of the leading master expires.
+// Detection only waits for the ZooKeeper watch to fire, which should
+// take about one tick of the ZooKeeper server. The test allows two
+// ticks, since the server runs in real time.
+TEST_F(ZooKeeperMasterContenderDetectorTest, MasterDetectorFailoverLatency)
+{
+  Try<zookeeper::URL> url = zookeeper::URL::parse(
+      "zk://" + server->connectString() + "/mesos");
+
+  ASSERT_SOME(url);
+
+  PID<Master> leader;
+  leader.ip = 10000000;
+  leader.port = 10000;
+
+  // Create the group instance so we can expire its session.
+  Owned<zookeeper::Group> group(
+      new Group(url.get(), MASTER_CONTENDER_ZK_SESSION_TIMEOUT));
+
+  ZooKeeperMasterContender leaderContender(group);
+  leaderContender.initialize(leader);
+
+  Future<Future<Nothing> > leaderContended = leaderContender.contend();
+  AWAIT_READY(leaderContended);
+
+  PID<Master> follower;
+  follower.ip = 10000001;
+  follower.port = 10001;
+
+  ZooKeeperMasterContender followerContender(url.get());
+  followerContender.initialize(follower);
+
+  Future<Future<Nothing> > followerContended = followerContender.contend();
+  AWAIT_READY(followerContended);
+
+  ZooKeeperMasterDetector detector(url.get());
+
+  Future<Option<UPID> > detected = detector.detect();
+  AWAIT_READY(detected);
+  EXPECT_SOME_EQ(leader, detected.get());
+
+  detected = detector.detect(detected.get());
+
+  Future<Option<int64_t> > session = group->session();
+  AWAIT_READY(session);
+  ASSERT_SOME(session.get());
+
+  const Duration bound = server->getTickTime() * 2;
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  server->expireSession(session.get().get());
+
+  // Wait longer than the bound, so that a slow detection still gets
+  // measured (and reported) below.
+  AWAIT_READY_FOR(detected, MASTER_DETECTOR_ZK_SESSION_TIMEOUT * 2);
+  EXPECT_SOME_EQ(follower, detected.get());
+
+  Duration elapsed = stopwatch.elapsed();
+
+  LOG(INFO) << "Detected the new leading master in " << elapsed;
+
+  EXPECT_LT(elapsed, bound);
+}
+
+
 // Tests whether a slave correctly DOES NOT disconnect from the
 // master when its ZooKeeper session is expired, but the master still
 // stays the leader when the slave re-connects with the ZooKeeper.
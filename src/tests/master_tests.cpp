@@ -30,6 +30,7 @@
 #include <process/clock.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
+#include <process/http.hpp>
 #include <process/owned.hpp>
 #include <process/pid.hpp>
 
@@ -1099,3 +1100,607 @@ TEST_F(MasterTest, ReconcileTaskTest)
 
   Shutdown(); // Must shutdown before 'isolator' gets deallocated.
 }
+
+
+// This test ensures that the slave's attributes are included in the
+// offers sent to a framework, since the master adds them to each
+// offer from a pre-serialized copy kept with the slave.
+TEST_F(MasterTest, OfferAttributes)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.attributes = Option<string>("rack:abc;host:1");
+
+  Try<PID<Slave> > slave = StartSlave(flags);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get(), DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  Future<vector<Offer> > offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_EQ(1u, offers.get().size());
+
+  Offer offer = offers.get()[0];
+  EXPECT_NE("", offer.hostname());
+  EXPECT_NE(0, offer.resources().size());
+  ASSERT_EQ(2, offer.attributes_size());
+  EXPECT_EQ("rack", offer.attributes(0).name());
+  EXPECT_EQ("abc", offer.attributes(0).text().value());
+  EXPECT_EQ("host", offer.attributes(1).name());
+  EXPECT_EQ(1, offer.attributes(1).scalar().value());
+
+  driver.stop();
+  driver.join();
+
+  Shutdown();
+}
+
+
+// This test verifies that '/master/state-diff.json' only returns the
+// slaves and frameworks that changed after the requested version.
+TEST_F(MasterTest, StateDiff)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Try<PID<Slave> > slave = StartSlave();
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(slaveRegisteredMessage);
+  const string slaveId = slaveRegisteredMessage.get().slave_id().value();
+
+  // Everything changed since version 0.
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "state-diff.json", "since=0");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
+
+  string body = response.get().body;
+  EXPECT_NE(string::npos, body.find("\"full\":0"));
+  EXPECT_NE(string::npos, body.find(slaveId));
+
+  // Nothing changed since the current version.
+  size_t index = body.find("\"version\":");
+  ASSERT_NE(string::npos, index);
+  index += strlen("\"version\":");
+
+  const string version =
+    body.substr(index, body.find_first_of(",}", index) - index);
+
+  index = body.find("\"id\":\"");
+  ASSERT_NE(string::npos, index);
+  index += strlen("\"id\":\"");
+
+  const string masterId = body.substr(index, body.find('"', index) - index);
+
+  response = process::http::get(
+      master.get(), "state-diff.json", "since=" + version);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
+
+  body = response.get().body;
+  EXPECT_NE(string::npos, body.find("\"slaves\":[]"));
+  EXPECT_EQ(string::npos, body.find(slaveId));
+
+  // A version this master has not reached yet requires a full state.
+  response = process::http::get(
+      master.get(), "state-diff.json", "since=1000000");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
+
+  body = response.get().body;
+  EXPECT_NE(string::npos, body.find("\"full\":1"));
+  EXPECT_NE(string::npos, body.find(slaveId));
+
+  // A version of this master is only incremental for its own id.
+  response = process::http::get(
+      master.get(),
+      "state-diff.json",
+      "id=" + masterId + "&since=" + version);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
+
+  body = response.get().body;
+  EXPECT_NE(string::npos, body.find("\"full\":0"));
+  EXPECT_EQ(string::npos, body.find(slaveId));
+
+  // A version of another (e.g., a failed over) master requires a
+  // full state, even if this master already reached that version.
+  response = process::http::get(
+      master.get(),
+      "state-diff.json",
+      "id=other&since=" + version);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
+
+  body = response.get().body;
+  EXPECT_NE(string::npos, body.find("\"full\":1"));
+  EXPECT_NE(string::npos, body.find(slaveId));
+
+  response = process::http::get(master.get(), "state-diff.json", "since=a");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::BadRequest().status, response);
+
+  Shutdown();
+}
+
+
+// Returns the body of the given endpoint of the master.
+static string getBody(
+    const PID<Master>& master,
+    const string& path,
+    const string& query = "")
+{
+  Future<process::http::Response> response =
+    process::http::get(master, path, query);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(process::http::OK().status, response);
+
+  return response.isReady() ? response.get().body : "";
+}
+
+
+// Returns the 'state_version' of the master's '/master/state.json'.
+static string stateVersion(const string& state)
+{
+  size_t index = state.find("\"state_version\":");
+  EXPECT_NE(string::npos, index);
+  index += strlen("\"state_version\":");
+
+  return state.substr(index, state.find_first_of(",}", index) - index);
+}
+
+
+// This test verifies that the offers exported over HTTP are up to
+// date, even though they are versioned separately from the rest of
+// the state.
+TEST_F(MasterTest, OffersInState)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  Try<PID<Slave> > slave = StartSlave();
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get(), DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  Future<vector<Offer> > offers1;
+  Future<vector<Offer> > offers2;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers1))
+    .WillOnce(FutureArg<1>(&offers2))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers1);
+  ASSERT_EQ(1u, offers1.get().size());
+
+  const string offerId1 = offers1.get()[0].id().value();
+
+  string state = getBody(master.get(), "state.json");
+  EXPECT_NE(string::npos, state.find(offerId1));
+
+  const string version = stateVersion(state);
+
+  // Decline the offer so that the resources get offered again.
+  Filters filters;
+  filters.set_refuse_seconds(0);
+  driver.declineOffer(offers1.get()[0].id(), filters);
+
+  AWAIT_READY(offers2);
+  ASSERT_EQ(1u, offers2.get().size());
+
+  const string offerId2 = offers2.get()[0].id().value();
+  EXPECT_NE(offerId1, offerId2);
+
+  state = getBody(master.get(), "state.json");
+  EXPECT_EQ(string::npos, state.find(offerId1));
+  EXPECT_NE(string::npos, state.find(offerId2));
+  EXPECT_NE(version, stateVersion(state));
+
+  // The framework and the slave with the new offer are part of the
+  // changes since the first offer.
+  const string diff =
+    getBody(master.get(), "state-diff.json", "since=" + version);
+  EXPECT_NE(string::npos, diff.find("\"full\":0"));
+  EXPECT_EQ(string::npos, diff.find(offerId1));
+  EXPECT_NE(string::npos, diff.find(offerId2));
+  EXPECT_NE(string::npos, diff.find(offers2.get()[0].slave_id().value()));
+
+  driver.stop();
+  driver.join();
+
+  Shutdown();
+}
+
+
+// This test ensures that the master keeps track of the slaves that
+// are running tasks or executors of a framework: a failed over
+// scheduler must reach a slave where only the framework's executor
+// (but no task) is left, and a removed slave must not be kept around
+// for the framework.
+TEST_F(MasterTest, FrameworkSlaves)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+
+  Try<PID<Slave> > slave = StartSlave(&exec);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched1;
+  MesosSchedulerDriver driver1(
+      &sched1, DEFAULT_FRAMEWORK_INFO, master.get(), DEFAULT_CREDENTIAL);
+
+  Future<FrameworkID> frameworkId;
+  EXPECT_CALL(sched1, registered(&driver1, _, _))
+    .WillOnce(FutureArg<1>(&frameworkId));
+
+  Future<vector<Offer> > offers;
+  EXPECT_CALL(sched1, resourceOffers(&driver1, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver1.start();
+
+  AWAIT_READY(frameworkId);
+
+  AWAIT_READY(offers);
+  EXPECT_NE(0u, offers.get().size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers.get()[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers.get()[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  Future<ExecutorDriver*> execDriver;
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .WillOnce(FutureArg<0>(&execDriver));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<TaskStatus> status1;
+  Future<TaskStatus> status2;
+  EXPECT_CALL(sched1, statusUpdate(&driver1, _))
+    .WillOnce(FutureArg<1>(&status1))
+    .WillOnce(FutureArg<1>(&status2));
+
+  driver1.launchTasks(offers.get()[0].id(), tasks);
+
+  AWAIT_READY(execDriver);
+
+  AWAIT_READY(status1);
+  EXPECT_EQ(TASK_RUNNING, status1.get().state());
+
+  // Finish the task so that only the executor is left on the slave.
+  TaskStatus finished;
+  finished.mutable_task_id()->MergeFrom(task.task_id());
+  finished.set_state(TASK_FINISHED);
+
+  execDriver.get()->sendStatusUpdate(finished);
+
+  AWAIT_READY(status2);
+  EXPECT_EQ(TASK_FINISHED, status2.get().state());
+
+  // Now fail over the scheduler. The slave is still running the
+  // executor, hence it should be told about the new scheduler.
+  MockScheduler sched2;
+
+  FrameworkInfo framework2; // Bug in gcc 4.1.*, must assign on next line.
+  framework2 = DEFAULT_FRAMEWORK_INFO;
+  framework2.mutable_id()->MergeFrom(frameworkId.get());
+
+  MesosSchedulerDriver driver2(
+      &sched2, framework2, master.get(), DEFAULT_CREDENTIAL);
+
+  Future<Nothing> sched2Registered;
+  EXPECT_CALL(sched2, registered(&driver2, frameworkId.get(), _))
+    .WillOnce(FutureSatisfy(&sched2Registered));
+
+  EXPECT_CALL(sched2, resourceOffers(&driver2, _))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched2, offerRescinded(&driver2, _))
+    .Times(AtMost(1));
+
+  EXPECT_CALL(sched1, offerRescinded(&driver1, _))
+    .Times(AtMost(1));
+
+  Future<Nothing> sched1Error;
+  EXPECT_CALL(sched1, error(&driver1, "Framework failed over"))
+    .WillOnce(FutureSatisfy(&sched1Error));
+
+  Future<UpdateFrameworkMessage> updateFrameworkMessage =
+    FUTURE_PROTOBUF(UpdateFrameworkMessage(), master.get(), slave.get());
+
+  driver2.start();
+
+  AWAIT_READY(sched2Registered);
+  AWAIT_READY(sched1Error);
+
+  AWAIT_READY(updateFrameworkMessage);
+  EXPECT_EQ(frameworkId.get(), updateFrameworkMessage.get().framework_id());
+
+  // The slave now knows about the new scheduler, so messages from
+  // the executor should reach it.
+  Future<string> schedData;
+  EXPECT_CALL(sched2, frameworkMessage(&driver2, _, _, _))
+    .WillOnce(FutureArg<3>(&schedData));
+
+  execDriver.get()->sendFrameworkMessage("world");
+
+  AWAIT_READY(schedData);
+  EXPECT_EQ("world", schedData.get());
+
+  // Stop the slave. The master removes it since it is not
+  // checkpointing, which should also remove it from the slaves of
+  // the framework.
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  Future<Nothing> slaveLost;
+  EXPECT_CALL(sched2, slaveLost(&driver2, _))
+    .WillOnce(FutureSatisfy(&slaveLost));
+
+  Stop(slave.get());
+
+  AWAIT_READY(slaveLost);
+
+  // Fail over the scheduler once more. The master would crash when
+  // sending an UpdateFrameworkMessage to the (now unknown) slave if
+  // it had been left behind for the framework.
+  MockScheduler sched3;
+  MesosSchedulerDriver driver3(
+      &sched3, framework2, master.get(), DEFAULT_CREDENTIAL);
+
+  Future<Nothing> sched3Registered;
+  EXPECT_CALL(sched3, registered(&driver3, frameworkId.get(), _))
+    .WillOnce(FutureSatisfy(&sched3Registered));
+
+  EXPECT_CALL(sched3, resourceOffers(&driver3, _))
+    .WillRepeatedly(Return());
+
+  Future<Nothing> sched2Error;
+  EXPECT_CALL(sched2, error(&driver2, "Framework failed over"))
+    .WillOnce(FutureSatisfy(&sched2Error));
+
+  driver3.start();
+
+  AWAIT_READY(sched3Registered);
+  AWAIT_READY(sched2Error);
+
+  EXPECT_EQ(DRIVER_STOPPED, driver3.stop());
+  EXPECT_EQ(DRIVER_STOPPED, driver3.join());
+
+  EXPECT_EQ(DRIVER_ABORTED, driver2.stop());
+  EXPECT_EQ(DRIVER_STOPPED, driver2.join());
+
+  EXPECT_EQ(DRIVER_ABORTED, driver1.stop());
+  EXPECT_EQ(DRIVER_STOPPED, driver1.join());
+
+  Shutdown();
+}
+
+
+// Stands in for a slave that re-registers with a failed over master.
+class SpoofedSlave : public process::Process<SpoofedSlave> {};
+
+
+// Returns a re-registration of a slave that is running a task (and
+// its executor) of a framework that has not re-registered yet.
+static ReregisterSlaveMessage createReregisterSlaveMessage()
+{
+  Resources resources = Resources::parse("cpus:1;mem:512").get();
+
+  ReregisterSlaveMessage message;
+  message.mutable_slave_id()->set_value("slave");
+
+  SlaveInfo* slaveInfo = message.mutable_slave();
+  slaveInfo->mutable_id()->set_value("slave");
+  slaveInfo->set_hostname("host");
+  slaveInfo->mutable_resources()->MergeFrom(resources);
+
+  ExecutorInfo* executorInfo = message.add_executor_infos();
+  executorInfo->MergeFrom(DEFAULT_EXECUTOR_INFO);
+  executorInfo->mutable_framework_id()->set_value("framework");
+
+  Task* task = message.add_tasks();
+  task->set_name("");
+  task->mutable_task_id()->set_value("task");
+  task->mutable_framework_id()->set_value("framework");
+  task->mutable_executor_id()->MergeFrom(executorInfo->executor_id());
+  task->mutable_slave_id()->set_value("slave");
+  task->set_state(TASK_RUNNING);
+  task->mutable_resources()->MergeFrom(resources);
+
+  return message;
+}
+
+
+// This test ensures that a slave that re-registers again while its
+// re-registration with a failed over master is queued up gets
+// re-added (and acknowledged) only once.
+TEST_F(MasterTest, DuplicateQueuedReregistration)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  SpoofedSlave slave;
+  process::spawn(slave);
+
+  // Keep the re-registration queued up until the duplicate arrives.
+  Future<Nothing> _reregisterSlaves =
+    DROP_DISPATCH(master.get(), &Master::_reregisterSlaves);
+
+  Future<SlaveReregisteredMessage> slaveReregisteredMessage =
+    FUTURE_PROTOBUF(SlaveReregisteredMessage(), master.get(), slave.self());
+
+  const ReregisterSlaveMessage message = createReregisterSlaveMessage();
+
+  process::post(slave.self(), master.get(), message);
+
+  AWAIT_READY(_reregisterSlaves);
+
+  process::post(slave.self(), master.get(), message);
+
+  process::dispatch(master.get(), &Master::_reregisterSlaves);
+
+  AWAIT_READY(slaveReregisteredMessage);
+
+  // The duplicate must not be acknowledged (or re-added) again.
+  Future<SlaveReregisteredMessage> duplicate =
+    FUTURE_PROTOBUF(SlaveReregisteredMessage(), master.get(), slave.self());
+
+  Clock::pause();
+  Clock::settle();
+
+  EXPECT_TRUE(duplicate.isPending());
+
+  Clock::resume();
+
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "stats.json");
+
+  AWAIT_READY(response);
+  EXPECT_NE(string::npos,
+            response.get().body.find("\"activated_slaves\":1"));
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  Shutdown();
+}
+
+
+// This test ensures that a (non-checkpointing) slave that exits while
+// its re-registration with a failed over master is queued up gets
+// removed once it is re-added.
+TEST_F(MasterTest, SlaveExitsWhileReregistrationQueued)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  SpoofedSlave slave;
+  process::spawn(slave);
+
+  // Keep the re-registration queued up until the slave exited.
+  Future<Nothing> _reregisterSlaves =
+    DROP_DISPATCH(master.get(), &Master::_reregisterSlaves);
+
+  process::post(slave.self(), master.get(), createReregisterSlaveMessage());
+
+  AWAIT_READY(_reregisterSlaves);
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::dispatch(master.get(), &Master::_reregisterSlaves);
+
+  // Wait for the slave to be re-added and removed again.
+  Clock::pause();
+  Clock::settle();
+  Clock::resume();
+
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "stats.json");
+
+  AWAIT_READY(response);
+  EXPECT_NE(string::npos,
+            response.get().body.find("\"activated_slaves\":0"));
+  EXPECT_NE(string::npos,
+            response.get().body.find("\"deactivated_slaves\":1"));
+
+  Shutdown();
+}
+
+
+// This test ensures that a slave that re-registers from another pid
+// (e.g., after a restart) while its re-registration with a failed
+// over master is queued up gets re-added at its new pid.
+TEST_F(MasterTest, ReregistrationFromNewPidWhileQueued)
+{
+  Try<PID<Master> > master = StartMaster();
+  ASSERT_SOME(master);
+
+  SpoofedSlave slave1;
+  process::spawn(slave1);
+
+  // Keep the re-registration queued up until the slave restarted.
+  Future<Nothing> _reregisterSlaves =
+    DROP_DISPATCH(master.get(), &Master::_reregisterSlaves);
+
+  const ReregisterSlaveMessage message = createReregisterSlaveMessage();
+
+  process::post(slave1.self(), master.get(), message);
+
+  AWAIT_READY(_reregisterSlaves);
+
+  // The restarted slave has a new pid.
+  SpoofedSlave slave2;
+  process::spawn(slave2);
+
+  Future<SlaveReregisteredMessage> slaveReregisteredMessage =
+    FUTURE_PROTOBUF(SlaveReregisteredMessage(), master.get(), slave2.self());
+
+  Future<SlaveReregisteredMessage> stale =
+    FUTURE_PROTOBUF(SlaveReregisteredMessage(), master.get(), slave1.self());
+
+  process::post(slave2.self(), master.get(), message);
+
+  process::dispatch(master.get(), &Master::_reregisterSlaves);
+
+  AWAIT_READY(slaveReregisteredMessage);
+
+  // The old pid exiting must not remove the slave.
+  process::terminate(slave1);
+  process::wait(slave1);
+
+  Clock::pause();
+  Clock::settle();
+
+  EXPECT_TRUE(stale.isPending());
+
+  Clock::resume();
+
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "stats.json");
+
+  AWAIT_READY(response);
+  EXPECT_NE(string::npos,
+            response.get().body.find("\"activated_slaves\":1"));
+
+  process::terminate(slave2);
+  process::wait(slave2);
+
+  Shutdown();
+}
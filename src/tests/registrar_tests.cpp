@@ -18,12 +18,17 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
 #include <process/pid.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
+
+#include "master/constants.hpp"
 #include "master/registrar.hpp"
 
 #include "state/leveldb.hpp"
@@ -37,6 +42,7 @@ using namespace process;
 
 using std::map;
 using std::string;
+using std::vector;
 
 using testing::_;
 using testing::Eq;
@@ -149,6 +155,40 @@ TEST_F(RegistrarTest, remove)
   AWAIT_EQ(true, registrar.remove(info2));
 }
 
+
+TEST_F(RegistrarTest, recover)
+{
+  // Enough slaves for the changes to get stored as all of the slaves
+  // (at least) once.
+  const uint32_t count = MAX_REGISTRY_CHANGES * 2 + 1;
+
+  vector<SlaveInfo> infos;
+  for (uint32_t i = 0; i < count; i++) {
+    SlaveInfo info;
+    info.set_hostname("localhost");
+    info.mutable_id()->set_value(stringify(i));
+    infos.push_back(info);
+  }
+
+  {
+    Registrar registrar(state);
+
+    foreach (const SlaveInfo& info, infos) {
+      AWAIT_EQ(true, registrar.admit(info.id(), info));
+    }
+
+    for (uint32_t i = 0; i < count; i += 3) {
+      AWAIT_EQ(true, registrar.remove(infos[i]));
+    }
+  }
+
+  Registrar registrar(state);
+
+  for (uint32_t i = 0; i < count; i++) {
+    AWAIT_EQ(i % 3 != 0, registrar.readmit(infos[i]));
+  }
+}
+
 } // namespace master {
 } // namespace internal {
 } // namespace mesos {
@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 
+#include <list>
 #include <map>
 #include <string>
 
@@ -24,11 +25,16 @@
 #include <process/pid.hpp>
 #include <process/process.hpp>
 
+#include <stout/gtest.hpp>
+#include <stout/multimap.hpp>
+
 #include "sasl/authenticatee.hpp"
 #include "sasl/authenticator.hpp"
+#include "sasl/auxprop.hpp"
 
 using namespace process;
 
+using std::list;
 using std::map;
 using std::string;
 
@@ -142,6 +148,58 @@ TEST(SASL, failed2)
   terminate(pid);
 }
 
+
+// The in-memory auxiliary property plugin should look up properties
+// by user and name, and the first property with a given name wins.
+TEST(SASL, auxprop)
+{
+  Multimap<string, Property> properties;
+
+  Property property;
+  property.name = "userPassword";
+  property.values.push_back("secret");
+  properties.put("benh", property);
+
+  property.values.clear();
+  property.values.push_back("other");
+  properties.put("benh", property);
+
+  property.name = "cmusaslsecretCRAM-MD5";
+  property.values.clear();
+  properties.put("benh", property);
+
+  property.name = "userPassword";
+  property.values.push_back("password");
+  properties.put("vinod", property);
+
+  InMemoryAuxiliaryPropertyPlugin::load(properties);
+
+  Option<list<string> > values =
+    InMemoryAuxiliaryPropertyPlugin::lookup("benh", "userPassword");
+
+  ASSERT_SOME(values);
+  ASSERT_EQ(1u, values.get().size());
+  EXPECT_EQ("secret", values.get().front());
+
+  values = InMemoryAuxiliaryPropertyPlugin::lookup(
+      "benh", "cmusaslsecretCRAM-MD5");
+
+  ASSERT_SOME(values);
+  EXPECT_TRUE(values.get().empty());
+
+  values = InMemoryAuxiliaryPropertyPlugin::lookup("vinod", "userPassword");
+
+  ASSERT_SOME(values);
+  ASSERT_EQ(1u, values.get().size());
+  EXPECT_EQ("password", values.get().front());
+
+  values = InMemoryAuxiliaryPropertyPlugin::lookup("benh", "unknown");
+  EXPECT_NONE(values);
+
+  values = InMemoryAuxiliaryPropertyPlugin::lookup("unknown", "userPassword");
+  EXPECT_NONE(values);
+}
+
 } // namespace sasl {
 } // namespace internal {
 } // namespace mesos {
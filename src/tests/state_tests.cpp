@@ -18,30 +18,44 @@
 
 #include <gmock/gmock.h>
 
+#include <list>
 #include <set>
 #include <string>
 #include <vector>
 
 #include <mesos/mesos.hpp>
 
+#include <process/collect.hpp>
 #include <process/future.hpp>
 #include <process/gtest.hpp>
+#include <process/pid.hpp>
 #include <process/protobuf.hpp>
+#include <process/timeout.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
 #include <stout/try.hpp>
 
 #include "common/type_utils.hpp"
 
+#include "log/log.hpp"
+#include "log/replica.hpp"
+#include "log/tool/initialize.hpp"
+
 #include "master/registry.hpp"
 
+#include "state/cached.hpp"
 #include "state/leveldb.hpp"
+#include "state/log.hpp"
 #include "state/protobuf.hpp"
 #include "state/storage.hpp"
 #include "state/zookeeper.hpp"
 
+#include "tests/utils.hpp"
 #ifdef MESOS_HAS_JAVA
 #include "tests/zookeeper.hpp"
 #endif
@@ -54,6 +68,9 @@ using namespace process;
 using mesos::internal::registry::Slaves;
 using mesos::internal::registry::Slave;
 
+using mesos::internal::tests::TemporaryDirectoryTest;
+
+using state::CachedStorage;
 using state::LevelDBStorage;
 using state::Storage;
 #ifdef MESOS_HAS_JAVA
@@ -63,6 +80,10 @@ using state::ZooKeeperStorage;
 using state::protobuf::State;
 using state::protobuf::Variable;
 
+using std::list;
+using std::set;
+using std::string;
+
 
 void FetchAndStoreAndFetch(State* state)
 {
@@ -304,6 +325,95 @@ void Names(State* state)
 }
 
 
+// Fetches and stores many variables at once, without waiting for
+// one before the next.
+void ConcurrentFetchAndStore(State* state)
+{
+  const size_t count = 100;
+
+  list<Future<Variable<Slaves> > > fetches;
+  for (size_t i = 0; i < count; i++) {
+    fetches.push_back(state->fetch<Slaves>("slaves" + stringify(i)));
+  }
+
+  Future<list<Variable<Slaves> > > fetched = collect(fetches);
+  AWAIT_READY(fetched);
+
+  list<Future<Option<Variable<Slaves> > > > stores;
+  size_t i = 0;
+  foreach (const Variable<Slaves>& variable, fetched.get()) {
+    Slaves slaves = variable.get();
+    EXPECT_TRUE(slaves.slaves().size() == 0);
+
+    Slave* slave = slaves.add_slaves();
+    slave->mutable_info()->set_hostname("host" + stringify(i++));
+
+    stores.push_back(state->store(variable.mutate(slaves)));
+  }
+
+  Future<list<Option<Variable<Slaves> > > > stored = collect(stores);
+  AWAIT_READY(stored);
+
+  foreach (const Option<Variable<Slaves> >& variable, stored.get()) {
+    EXPECT_SOME(variable);
+  }
+
+  fetches.clear();
+  for (i = 0; i < count; i++) {
+    fetches.push_back(state->fetch<Slaves>("slaves" + stringify(i)));
+  }
+
+  fetched = collect(fetches);
+  AWAIT_READY(fetched);
+
+  i = 0;
+  foreach (const Variable<Slaves>& variable, fetched.get()) {
+    Slaves slaves = variable.get();
+    ASSERT_TRUE(slaves.slaves().size() == 1);
+    EXPECT_EQ("host" + stringify(i++), slaves.slaves(0).info().hostname());
+  }
+
+  Future<std::vector<std::string> > names = state->names();
+  AWAIT_READY(names);
+  EXPECT_EQ(count, names.get().size());
+}
+
+
+// Stores two mutations of the same version of a variable at once,
+// only the first one may succeed.
+void FetchAndStoreAndStoreConcurrently(State* state)
+{
+  Future<Variable<Slaves> > future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable = future1.get();
+
+  Slaves slaves1 = variable.get();
+  slaves1.add_slaves()->mutable_info()->set_hostname("localhost1");
+
+  Slaves slaves2 = variable.get();
+  slaves2.add_slaves()->mutable_info()->set_hostname("localhost2");
+
+  Future<Option<Variable<Slaves> > > future2 =
+    state->store(variable.mutate(slaves1));
+
+  Future<Option<Variable<Slaves> > > future3 =
+    state->store(variable.mutate(slaves2));
+
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  AWAIT_READY(future3);
+  EXPECT_NONE(future3.get());
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  ASSERT_EQ(1, future1.get().get().slaves().size());
+  EXPECT_EQ("localhost1", future1.get().get().slaves(0).info().hostname());
+}
+
+
 class LevelDBStateTest : public ::testing::Test
 {
 public:
@@ -377,6 +487,452 @@ TEST_F(LevelDBStateTest, Names)
 }
 
 
+TEST_F(LevelDBStateTest, ConcurrentFetchAndStore)
+{
+  ConcurrentFetchAndStore(state);
+}
+
+
+TEST_F(LevelDBStateTest, FetchAndStoreAndStoreConcurrently)
+{
+  FetchAndStoreAndStoreConcurrently(state);
+}
+
+
+TEST_F(LevelDBStateTest, MutateWithoutCopying)
+{
+  Future<Variable<Slaves> > future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable1 = future1.get();
+
+  Slaves slaves;
+  slaves.add_slaves()->mutable_info()->set_hostname("localhost");
+
+  // The contents of 'slaves' get taken over by the new variable,
+  // while the original variable is left unchanged.
+  Variable<Slaves> variable2 = variable1.mutate(&slaves);
+  EXPECT_EQ(0, slaves.slaves().size());
+  EXPECT_EQ(0, variable1.get().slaves().size());
+  ASSERT_EQ(1, variable2.get().slaves().size());
+
+  // Copies share the same message.
+  Variable<Slaves> variable3 = variable2;
+  EXPECT_EQ(&variable2.get(), &variable3.get());
+
+  Future<Option<Variable<Slaves> > > future2 = state->store(variable2);
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  // Storing a variable that was not mutated reuses its serialized
+  // value (the version still changes).
+  future2 = state->store(future2.get().get());
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  ASSERT_EQ(1, future1.get().get().slaves().size());
+  EXPECT_EQ("localhost", future1.get().get().slaves(0).info().hostname());
+}
+
+
+class CachedStateTest : public ::testing::Test
+{
+public:
+  CachedStateTest()
+    : storage(NULL),
+      cached(NULL),
+      state(NULL),
+      path(os::getcwd() + "/.state") {}
+
+protected:
+  virtual void SetUp()
+  {
+    os::rmdir(path);
+    storage = new state::LevelDBStorage(path);
+    cached = new state::CachedStorage(storage);
+    state = new State(cached);
+  }
+
+  virtual void TearDown()
+  {
+    delete state;
+    delete cached;
+    delete storage;
+    os::rmdir(path);
+  }
+
+  state::Storage* storage;
+  state::Storage* cached;
+  State* state;
+
+private:
+  const std::string path;
+};
+
+
+TEST_F(CachedStateTest, FetchAndStoreAndFetch)
+{
+  FetchAndStoreAndFetch(state);
+}
+
+
+TEST_F(CachedStateTest, FetchAndStoreAndStoreAndFetch)
+{
+  FetchAndStoreAndStoreAndFetch(state);
+}
+
+
+TEST_F(CachedStateTest, FetchAndStoreAndStoreFailAndFetch)
+{
+  FetchAndStoreAndStoreFailAndFetch(state);
+}
+
+
+TEST_F(CachedStateTest, FetchAndStoreAndExpungeAndFetch)
+{
+  FetchAndStoreAndExpungeAndFetch(state);
+}
+
+
+TEST_F(CachedStateTest, FetchAndStoreAndExpungeAndExpunge)
+{
+  FetchAndStoreAndExpungeAndExpunge(state);
+}
+
+
+TEST_F(CachedStateTest, FetchAndStoreAndExpungeAndStoreAndFetch)
+{
+  FetchAndStoreAndExpungeAndStoreAndFetch(state);
+}
+
+
+TEST_F(CachedStateTest, Names)
+{
+  Names(state);
+}
+
+
+// Checks that a stale cached entry doesn't break the test-and-set
+// semantics and gets invalidated by a failed store.
+TEST_F(CachedStateTest, StaleStoreFails)
+{
+  Future<Variable<Slaves> > future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable = future1.get();
+
+  // Change the variable behind the cache's back (the LevelDB storage
+  // never reports changes, since it is not shared).
+  State other(storage);
+
+  Future<Variable<Slaves> > future2 = other.fetch<Slaves>("slaves");
+  AWAIT_READY(future2);
+
+  Slaves slaves1 = future2.get().get();
+  slaves1.add_slaves()->mutable_info()->set_hostname("localhost");
+
+  Future<Option<Variable<Slaves> > > future3 =
+    other.store(future2.get().mutate(slaves1));
+  AWAIT_READY(future3);
+  ASSERT_SOME(future3.get());
+
+  // The cache still has the old entry.
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  EXPECT_EQ(0, future1.get().get().slaves().size());
+
+  // But storing it fails, and invalidates the cached entry.
+  Slaves slaves2 = future1.get().get();
+  slaves2.add_slaves()->mutable_info()->set_hostname("remotehost");
+
+  future3 = state->store(future1.get().mutate(slaves2));
+  AWAIT_READY(future3);
+  EXPECT_NONE(future3.get());
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  ASSERT_EQ(1, future1.get().get().slaves().size());
+  EXPECT_EQ("localhost", future1.get().get().slaves(0).info().hostname());
+}
+
+
+class LogStateTest : public TemporaryDirectoryTest
+{
+public:
+  LogStateTest()
+    : storage(NULL),
+      state(NULL),
+      replica2(NULL),
+      log(NULL) {}
+
+protected:
+  virtual void SetUp()
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    // For initializing the replicas.
+    log::tool::Initialize initializer;
+
+    const string path1 = os::getcwd() + "/.log1";
+    initializer.flags.path = path1;
+    initializer.execute();
+
+    const string path2 = os::getcwd() + "/.log2";
+    initializer.flags.path = path2;
+    initializer.execute();
+
+    // Only create the replica for 'path2' (i.e., the second replica)
+    // as the first replica will be created when we create a Log.
+    replica2 = new log::Replica(path2);
+
+    set<UPID> pids;
+    pids.insert(replica2->pid());
+
+    log = new log::Log(2, path1, pids);
+    storage = new state::LogStorage(log, Seconds(10), 3);
+    state = new State(storage);
+  }
+
+  virtual void TearDown()
+  {
+    delete state;
+    delete storage;
+    delete log;
+    delete replica2;
+
+    TemporaryDirectoryTest::TearDown();
+  }
+
+  state::Storage* storage;
+  State* state;
+
+  log::Replica* replica2;
+  log::Log* log;
+};
+
+
+TEST_F(LogStateTest, FetchAndStoreAndFetch)
+{
+  FetchAndStoreAndFetch(state);
+}
+
+
+TEST_F(LogStateTest, FetchAndStoreAndStoreAndFetch)
+{
+  FetchAndStoreAndStoreAndFetch(state);
+}
+
+
+TEST_F(LogStateTest, FetchAndStoreAndStoreFailAndFetch)
+{
+  FetchAndStoreAndStoreFailAndFetch(state);
+}
+
+
+TEST_F(LogStateTest, FetchAndStoreAndExpungeAndFetch)
+{
+  FetchAndStoreAndExpungeAndFetch(state);
+}
+
+
+TEST_F(LogStateTest, FetchAndStoreAndExpungeAndExpunge)
+{
+  FetchAndStoreAndExpungeAndExpunge(state);
+}
+
+
+TEST_F(LogStateTest, FetchAndStoreAndExpungeAndStoreAndFetch)
+{
+  FetchAndStoreAndExpungeAndStoreAndFetch(state);
+}
+
+
+TEST_F(LogStateTest, Names)
+{
+  Names(state);
+}
+
+
+// The log is shared with other replicas, so its entries never get
+// cached by a CachedStorage (see Storage::watch).
+TEST_F(LogStateTest, Uncached)
+{
+  state::CachedStorage cached(storage);
+  State state1(&cached);
+
+  Future<Variable<Slaves> > future1 = state1.fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  EXPECT_EQ(0, future1.get().get().slaves().size());
+
+  // Change the variable behind the cache's back.
+  Slaves slaves = future1.get().get();
+  slaves.add_slaves()->mutable_info()->set_hostname("localhost");
+
+  Future<Option<Variable<Slaves> > > future2 =
+    state->store(future1.get().mutate(slaves));
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  future1 = state1.fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  ASSERT_EQ(1, future1.get().get().slaves().size());
+  EXPECT_EQ("localhost", future1.get().get().slaves(0).info().hostname());
+}
+
+
+// Stores one variable once and another one many times, which makes
+// the storage truncate the log (and snapshot the first variable),
+// and checks that a new storage recovers both variables.
+TEST_F(LogStateTest, Truncate)
+{
+  Future<Variable<Slaves> > future1 = state->fetch<Slaves>("slaves1");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable1 = future1.get();
+
+  Slaves slaves = variable1.get();
+  slaves.add_slaves()->mutable_info()->set_hostname("localhost1");
+
+  Future<Option<Variable<Slaves> > > future2 =
+    state->store(variable1.mutate(slaves));
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  future1 = state->fetch<Slaves>("slaves2");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable2 = future1.get();
+
+  for (int i = 0; i < 20; i++) {
+    slaves = variable2.get();
+    slaves.add_slaves()->mutable_info()->set_hostname("localhost2");
+
+    future2 = state->store(variable2.mutate(slaves));
+    AWAIT_READY(future2);
+    ASSERT_SOME(future2.get());
+
+    variable2 = future2.get().get();
+  }
+
+  delete state;
+  delete storage;
+
+  // At most two compaction intervals (of 3 appends) and the
+  // snapshots of the variables are left in the log.
+  {
+    // The local replica might not have learned the last append (or
+    // truncation) yet, getting elected makes sure it does.
+    log::Log::Writer writer(log, Seconds(10));
+
+    log::Log::Reader reader(log);
+
+    Result<list<log::Log::Entry> > entries = reader.read(
+        reader.beginning(),
+        reader.ending(),
+        Timeout::in(Seconds(10)));
+
+    ASSERT_SOME(entries);
+    EXPECT_GE(8u, entries.get().size());
+  }
+
+  storage = new state::LogStorage(log, Seconds(10), 3);
+  state = new State(storage);
+
+  future1 = state->fetch<Slaves>("slaves1");
+  AWAIT_READY(future1);
+
+  slaves = future1.get().get();
+  ASSERT_EQ(1, slaves.slaves().size());
+  EXPECT_EQ("localhost1", slaves.slaves(0).info().hostname());
+
+  future1 = state->fetch<Slaves>("slaves2");
+  AWAIT_READY(future1);
+
+  slaves = future1.get().get();
+  EXPECT_EQ(20, slaves.slaves().size());
+}
+
+
+// Stores more variables than there are appends between compactions,
+// which makes each compaction snapshot most of them again, and checks
+// that they don't get queued up more than once (which would hold
+// back the other stores and grow the log).
+TEST_F(LogStateTest, TruncateManyVariables)
+{
+  const int variables = 10;
+
+  for (int i = 0; i < variables; i++) {
+    Future<Variable<Slaves> > future1 =
+      state->fetch<Slaves>("slaves" + stringify(i));
+    AWAIT_READY(future1);
+
+    Slaves slaves = future1.get().get();
+    slaves.add_slaves()->mutable_info()->set_hostname(
+        "localhost" + stringify(i));
+
+    Future<Option<Variable<Slaves> > > future2 =
+      state->store(future1.get().mutate(slaves));
+    AWAIT_READY(future2);
+    ASSERT_SOME(future2.get());
+  }
+
+  Future<Variable<Slaves> > future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable = future1.get();
+
+  for (int i = 0; i < 20; i++) {
+    Slaves slaves = variable.get();
+    slaves.add_slaves()->mutable_info()->set_hostname("localhost");
+
+    Future<Option<Variable<Slaves> > > future2 =
+      state->store(variable.mutate(slaves));
+    AWAIT_READY(future2);
+    ASSERT_SOME(future2.get());
+
+    variable = future2.get().get();
+  }
+
+  delete state;
+  delete storage;
+
+  // Each variable is snapshotted (at most) once more per compaction
+  // interval (of 3 appends).
+  {
+    log::Log::Writer writer(log, Seconds(10));
+
+    log::Log::Reader reader(log);
+
+    Result<list<log::Log::Entry> > entries = reader.read(
+        reader.beginning(),
+        reader.ending(),
+        Timeout::in(Seconds(10)));
+
+    ASSERT_SOME(entries);
+    EXPECT_GE(2u * (variables + 1) + 6u, entries.get().size());
+  }
+
+  storage = new state::LogStorage(log, Seconds(10), 3);
+  state = new State(storage);
+
+  for (int i = 0; i < variables; i++) {
+    future1 = state->fetch<Slaves>("slaves" + stringify(i));
+    AWAIT_READY(future1);
+
+    Slaves slaves = future1.get().get();
+    ASSERT_EQ(1, slaves.slaves().size());
+    EXPECT_EQ("localhost" + stringify(i), slaves.slaves(0).info().hostname());
+  }
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  EXPECT_EQ(20, future1.get().get().slaves().size());
+}
+
+
 #ifdef MESOS_HAS_JAVA
 class ZooKeeperStateTest : public tests::ZooKeeperTest
 {
@@ -448,4 +1004,154 @@ TEST_F(ZooKeeperStateTest, Names)
 {
   Names(state);
 }
+
+
+TEST_F(ZooKeeperStateTest, ConcurrentFetchAndStore)
+{
+  ConcurrentFetchAndStore(state);
+}
+
+
+// Stores, fetches, shrinks, and expunges an entry that is too big
+// for a single znode.
+TEST_F(ZooKeeperStateTest, LargeEntry)
+{
+  Future<Variable<Slaves> > future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable = future1.get();
+
+  // About 3 MB.
+  Slaves slaves1 = variable.get();
+  for (int i = 0; i < 3000; i++) {
+    Slave* slave = slaves1.add_slaves();
+    slave->mutable_info()->set_hostname(
+        string(1000, 'a' + i % 26) + stringify(i));
+  }
+
+  Future<Option<Variable<Slaves> > > future2 =
+    state->store(variable.mutate(slaves1));
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  variable = future1.get();
+
+  Slaves slaves2 = variable.get();
+  ASSERT_EQ(3000, slaves2.slaves().size());
+  EXPECT_EQ(slaves1.SerializeAsString(), slaves2.SerializeAsString());
+
+  // The chunks are not variables.
+  Future<std::vector<std::string> > names = state->names();
+  AWAIT_READY(names);
+  ASSERT_EQ(1u, names.get().size());
+  EXPECT_EQ("slaves", names.get()[0]);
+
+  // Shrink the entry so that it fits into a single znode again.
+  slaves2.mutable_slaves()->DeleteSubrange(1, 2999);
+
+  future2 = state->store(variable.mutate(slaves2));
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  variable = future2.get().get();
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  ASSERT_EQ(1, future1.get().get().slaves().size());
+  EXPECT_EQ(slaves1.slaves(0).info().hostname(),
+            future1.get().get().slaves(0).info().hostname());
+
+  // Grow it again and expunge it.
+  future2 = state->store(variable.mutate(slaves1));
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  Future<bool> expunged = state->expunge(future2.get().get());
+  AWAIT_READY(expunged);
+  EXPECT_TRUE(expunged.get());
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  EXPECT_EQ(0, future1.get().get().slaves().size());
+}
+
+
+// Entries just under 1 MB exceed ZooKeeper's default limit on the
+// size of a request once the overhead of the request is added, so
+// they need to be stored in chunks as well.
+TEST_F(ZooKeeperStateTest, EntryJustUnderOneMegabyte)
+{
+  Future<Variable<Slaves> > future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  Variable<Slaves> variable = future1.get();
+
+  Slaves slaves1 = variable.get();
+  Slave* slave = slaves1.add_slaves();
+  slave->mutable_info()->set_hostname(string(1024 * 1024 - 64, 'a'));
+
+  ASSERT_LT(slaves1.ByteSize(), 1024 * 1024);
+
+  Future<Option<Variable<Slaves> > > future2 =
+    state->store(variable.mutate(slaves1));
+  AWAIT_READY(future2);
+  ASSERT_SOME(future2.get());
+
+  future1 = state->fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+
+  Slaves slaves2 = future1.get().get();
+  ASSERT_EQ(1, slaves2.slaves().size());
+  EXPECT_EQ(slaves1.SerializeAsString(), slaves2.SerializeAsString());
+}
+
+
+// Checks that a cached entry gets invalidated when the variable is
+// changed by another client of the ZooKeeper ensemble.
+TEST_F(ZooKeeperStateTest, CachedInvalidation)
+{
+  state::CachedStorage cached(storage);
+  State state1(&cached);
+
+  Future<Variable<Slaves> > future1 = state1.fetch<Slaves>("slaves");
+  AWAIT_READY(future1);
+  EXPECT_EQ(0, future1.get().get().slaves().size());
+
+  state::ZooKeeperStorage storage2(
+      server->connectString(),
+      NO_TIMEOUT,
+      "/state/");
+  State state2(&storage2);
+
+  Future<Variable<Slaves> > future2 = state2.fetch<Slaves>("slaves");
+  AWAIT_READY(future2);
+
+  Slaves slaves = future2.get().get();
+  slaves.add_slaves()->mutable_info()->set_hostname("localhost");
+
+  Future<Option<Variable<Slaves> > > future3 =
+    state2.store(future2.get().mutate(slaves));
+  AWAIT_READY(future3);
+  ASSERT_SOME(future3.get());
+
+  // The watch gets triggered asynchronously.
+  Duration waited = Duration::zero();
+  do {
+    future1 = state1.fetch<Slaves>("slaves");
+    AWAIT_READY(future1);
+
+    if (future1.get().get().slaves().size() == 1) {
+      break;
+    }
+
+    os::sleep(Milliseconds(10));
+    waited += Milliseconds(10);
+  } while (waited < Seconds(10));
+
+  ASSERT_EQ(1, future1.get().get().slaves().size());
+  EXPECT_EQ("localhost", future1.get().get().slaves(0).info().hostname());
+}
 #endif // MESOS_HAS_JAVA
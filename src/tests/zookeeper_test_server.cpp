@@ -105,6 +105,12 @@ Duration ZooKeeperTestServer::getMinSessionTimeout() const
 }
 
 
+Duration ZooKeeperTestServer::getTickTime() const
+{
+  return Milliseconds(zooKeeperServer->getTickTime());
+}
+
+
 std::string ZooKeeperTestServer::connectString() const
 {
   CHECK(port > 0) << "Illegal state, must call startNetwork first!";
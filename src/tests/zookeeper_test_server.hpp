@@ -72,6 +72,10 @@ public:
   Duration getMinSessionTimeout() const;
   Duration getMaxSessionTimeout() const;
 
+  // Gets the length of a tick of the server, the unit of time in
+  // which it checks sessions (and, e.g., expires them).
+  Duration getTickTime() const;
+
 private:
   org::apache::zookeeper::server::ZooKeeperServer* zooKeeperServer;
   org::apache::zookeeper::server::NIOServerCnxnFactory* connectionFactory;
@@ -141,6 +141,50 @@ TEST_F(ZooKeeperTest, Create)
 }
 
 
+TEST_F(ZooKeeperTest, AsyncCreateRecursive)
+{
+  ZooKeeperTest::TestWatcher watcher;
+
+  ZooKeeper zk(server->connectString(), NO_TIMEOUT, &watcher);
+  watcher.awaitSessionEvent(ZOO_CONNECTED_STATE);
+
+  Future<ZooKeeper::Response<std::string> > create =
+    zk.asyncCreate("/foo/bar/baz", "42", ZOO_OPEN_ACL_UNSAFE, 0, true);
+
+  AWAIT_READY(create);
+  EXPECT_EQ(ZOK, create.get().code);
+  EXPECT_EQ("/foo/bar/baz", create.get().value);
+  ASSERT_ZK_GET("42", &zk, "/foo/bar/baz");
+
+  create = zk.asyncCreate("/foo/bar/baz", "", ZOO_OPEN_ACL_UNSAFE, 0, true);
+
+  AWAIT_READY(create);
+  EXPECT_EQ(ZNODEEXISTS, create.get().code);
+}
+
+
+// Deleting a ZooKeeper instance must answer its outstanding recursive
+// creates rather than leaving their continuations to run on the
+// deleted instance.
+TEST_F(ZooKeeperTest, AsyncCreateRecursiveWithClose)
+{
+  ZooKeeperTest::TestWatcher watcher;
+
+  ZooKeeper* zk = new ZooKeeper(server->connectString(), NO_TIMEOUT, &watcher);
+  watcher.awaitSessionEvent(ZOO_CONNECTED_STATE);
+
+  server->shutdownNetwork();
+
+  Future<ZooKeeper::Response<std::string> > create =
+    zk->asyncCreate("/foo/bar/baz", "", ZOO_OPEN_ACL_UNSAFE, 0, true);
+
+  delete zk;
+
+  AWAIT_READY(create);
+  EXPECT_NE(ZOK, create.get().code);
+}
+
+
 TEST_F(ZooKeeperTest, LeaderDetector)
 {
   Group group(server->connectString(), NO_TIMEOUT, "/test/");
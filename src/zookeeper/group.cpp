@@ -1,8 +1,12 @@
+#include <stdlib.h>
+
 #include <algorithm>
+#include <list>
 #include <queue>
 #include <utility>
 #include <vector>
 
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/process.hpp>
@@ -10,7 +14,10 @@
 #include <stout/check.hpp>
 #include <stout/duration.hpp>
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/none.hpp>
+#include <stout/nothing.hpp>
 #include <stout/numify.hpp>
 #include <stout/os.hpp>
 #include <stout/result.hpp>
@@ -28,6 +35,7 @@ using namespace process;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
+using std::list;
 using std::make_pair;
 using std::queue;
 using std::set;
@@ -54,6 +62,18 @@ void fail(queue<T*>* queue, const string& message)
 }
 
 
+// Returns the path of the znode of a membership. Example:
+// "/path/to/znode" => "/path/to/znode/0000000131".
+static string path(const string& znode, int32_t sequence)
+{
+  Try<string> basename = strings::format("%.*d", 10, sequence);
+
+  CHECK_SOME(basename);
+
+  return znode + "/" + basename.get();
+}
+
+
 // Helper for discarding a queue of promises.
 template <typename T>
 void discard(queue<T*>* queue)
@@ -82,7 +102,10 @@ GroupProcess::GroupProcess(
     watcher(NULL),
     zk(NULL),
     state(CONNECTING),
-    retrying(false)
+    retrying(false),
+    syncing(false),
+    caching(false),
+    outdated(false)
 {}
 
 
@@ -101,7 +124,10 @@ GroupProcess::GroupProcess(
     watcher(NULL),
     zk(NULL),
     state(CONNECTING),
-    retrying(false)
+    retrying(false),
+    syncing(false),
+    caching(false),
+    outdated(false)
 {}
 
 
@@ -112,6 +138,13 @@ GroupProcess::~GroupProcess()
   discard(&pending.datas);
   discard(&pending.watches);
 
+  foreachvalue (const list<Data*>& datas, fetching) {
+    foreach (Data* data, datas) {
+      data->promise.future().discard();
+      delete data;
+    }
+  }
+
   delete zk;
   delete watcher;
 }
@@ -131,35 +164,24 @@ Future<Group::Membership> GroupProcess::join(const string& data)
 {
   if (error.isSome()) {
     return Failure(error.get());
-  } else if (state != READY) {
-    Join* join = new Join(data);
-    pending.joins.push(join);
-    return join->promise.future();
   }
 
   // TODO(benh): Write a test to see how ZooKeeper fails setting znode
   // data when the data is larger than 1 MB so we know whether or not
   // to check for that here.
 
-  // TODO(benh): Only attempt if the pending queue is empty so that a
-  // client can assume a happens-before ordering of operations (i.e.,
-  // the first request will happen before the second, etc).
-
-  Result<Group::Membership> membership = doJoin(data);
+  // Joins (and cancels) are performed one after another, in order,
+  // by 'sync' so that a client can assume a happens-before ordering
+  // of operations (i.e., the first request will happen before the
+  // second, etc).
+  Join* join = new Join(data);
+  pending.joins.push(join);
 
-  if (membership.isNone()) { // Try again later.
-    if (!retrying) {
-      delay(RETRY_INTERVAL, self(), &GroupProcess::retry, RETRY_INTERVAL);
-      retrying = true;
-    }
-    Join* join = new Join(data);
-    pending.joins.push(join);
-    return join->promise.future();
-  } else if (membership.isError()) {
-    return Failure(membership.error());
+  if (state == READY) {
+    sync(RETRY_INTERVAL);
   }
 
-  return membership.get();
+  return join->promise.future();
 }
 
 
@@ -176,31 +198,14 @@ Future<bool> GroupProcess::cancel(const Group::Membership& membership)
     return false;
   }
 
-  if (state != READY) {
-    Cancel* cancel = new Cancel(membership);
-    pending.cancels.push(cancel);
-    return cancel->promise.future();
-  }
-
-  // TODO(benh): Only attempt if the pending queue is empty so that a
-  // client can assume a happens-before ordering of operations (i.e.,
-  // the first request will happen before the second, etc).
-
-  Result<bool> cancellation = doCancel(membership);
+  Cancel* cancel = new Cancel(membership);
+  pending.cancels.push(cancel);
 
-  if (cancellation.isNone()) { // Try again later.
-    if (!retrying) {
-      delay(RETRY_INTERVAL, self(), &GroupProcess::retry, RETRY_INTERVAL);
-      retrying = true;
-    }
-    Cancel* cancel = new Cancel(membership);
-    pending.cancels.push(cancel);
-    return cancel->promise.future();
-  } else if (cancellation.isError()) {
-    return Failure(cancellation.error());
+  if (state == READY) {
+    sync(RETRY_INTERVAL);
   }
 
-  return cancellation.get();
+  return cancel->promise.future();
 }
 
 
@@ -208,27 +213,19 @@ Future<string> GroupProcess::data(const Group::Membership& membership)
 {
   if (error.isSome()) {
     return Failure(error.get());
-  } else if (state != READY) {
-    Data* data = new Data(membership);
-    pending.datas.push(data);
-    return data->promise.future();
+  } else if (contents.count(membership.id()) > 0) {
+    return contents[membership.id()];
   }
 
-  // TODO(benh): Only attempt if the pending queue is empty so that a
-  // client can assume a happens-before ordering of operations (i.e.,
-  // the first request will happen before the second, etc).
+  Data* data = new Data(membership);
 
-  Result<string> result = doData(membership);
-
-  if (result.isNone()) { // Try again later.
-    Data* data = new Data(membership);
+  if (state != READY) {
     pending.datas.push(data);
-    return data->promise.future();
-  } else if (result.isError()) {
-    return Failure(result.error());
+  } else {
+    fetch(data);
   }
 
-  return result.get();
+  return data->promise.future();
 }
 
 
@@ -254,35 +251,19 @@ Future<set<Group::Membership> > GroupProcess::watch(
   // membership "roll call" for each watch in order to make sure all
   // causal relationships are satisfied.
 
-  if (memberships.isNone()) {
-    Try<bool> cached = cache();
-
-    if (cached.isError()) {
-      // Non-retryable error.
-      return Failure(cached.error());
-    } else if (!cached.get()) {
-      CHECK(memberships.isNone());
-
-      // Try again later.
-      if (!retrying) {
-        delay(RETRY_INTERVAL, self(), &GroupProcess::retry, RETRY_INTERVAL);
-        retrying = true;
-      }
-      Watch* watch = new Watch(expected);
-      pending.watches.push(watch);
-      return watch->promise.future();
-    }
+  if (memberships.isSome() && memberships.get() != expected) {
+    return memberships.get();
   }
 
-  CHECK_SOME(memberships);
+  // Wait for the memberships to get cached (or updated).
+  Watch* watch = new Watch(expected);
+  pending.watches.push(watch);
 
-  if (memberships.get() == expected) { // Just wait for updates.
-    Watch* watch = new Watch(expected);
-    pending.watches.push(watch);
-    return watch->promise.future();
+  if (memberships.isNone() && !caching) {
+    cache();
   }
 
-  return memberships.get();
+  return watch->promise.future();
 }
 
 
@@ -316,37 +297,42 @@ void GroupProcess::connected(bool reconnect)
   }
 
   // Sync group operations (and set up the group on ZK).
-  Try<bool> synced = sync();
-
-  if (synced.isError()) {
-    // Non-retryable error. Abort.
-    abort(synced.error());
-  } else if (!synced.get()) {
-    // Retryable error.
-    if (!retrying) {
-      delay(RETRY_INTERVAL, self(), &GroupProcess::retry, RETRY_INTERVAL);
-      retrying = true;
-    }
-  }
+  sync(RETRY_INTERVAL);
 }
 
 
-Try<bool> GroupProcess::authenticate()
+Future<bool> GroupProcess::authenticate()
 {
   CHECK_EQ(state, CONNECTED);
 
   // Authenticate if necessary.
-  if (auth.isSome()) {
-    LOG(INFO) << "Authenticating with ZooKeeper using " << auth.get().scheme;
+  if (auth.isNone()) {
+    state = AUTHENTICATED;
+    return true;
+  }
 
-    int code = zk->authenticate(auth.get().scheme, auth.get().credentials);
+  LOG(INFO) << "Authenticating with ZooKeeper using " << auth.get().scheme;
 
-    if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-      return false;
-    } else if (code != ZOK) {
-      return Error(
-          "Failed to authenticate with ZooKeeper: " + zk->message(code));
-    }
+  return zk->asyncAuthenticate(auth.get().scheme, auth.get().credentials)
+    .then(defer(self(), &Self::_authenticate, zk->getSessionId(), lambda::_1));
+}
+
+
+Future<bool> GroupProcess::_authenticate(
+    int64_t session,
+    const ZooKeeper::Response<Nothing>& response)
+{
+  if (stale(session) || state != CONNECTED) {
+    return false;
+  }
+
+  int code = response.code;
+
+  if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
+    return false;
+  } else if (code != ZOK) {
+    return Failure(
+        "Failed to authenticate with ZooKeeper: " + zk->message(code));
   }
 
   state = AUTHENTICATED;
@@ -354,7 +340,7 @@ Try<bool> GroupProcess::authenticate()
 }
 
 
-Try<bool> GroupProcess::create()
+Future<bool> GroupProcess::create()
 {
   CHECK_EQ(state, AUTHENTICATED);
 
@@ -363,7 +349,20 @@ Try<bool> GroupProcess::create()
 
   LOG(INFO) << "Trying to create path '" << znode << "' in ZooKeeper";
 
-  int code = zk->create(znode, "", acl, 0, NULL, true);
+  return zk->asyncCreate(znode, "", acl, 0, true)
+    .then(defer(self(), &Self::_create, zk->getSessionId(), lambda::_1));
+}
+
+
+Future<bool> GroupProcess::_create(
+    int64_t session,
+    const ZooKeeper::Response<string>& response)
+{
+  if (stale(session) || state != AUTHENTICATED) {
+    return false;
+  }
+
+  int code = response.code;
 
   // We fail all non-retryable return codes except ZNONODEEXISTS (
   // since that means the path we were trying to create exists) and
@@ -379,7 +378,7 @@ Try<bool> GroupProcess::create()
     CHECK_NE(zk->getState(), ZOO_AUTH_FAILED_STATE);
     return false;
   } else if (code != ZOK && code != ZNODEEXISTS && code != ZNOAUTH) {
-    return Error(
+    return Failure(
         "Failed to create '" + znode + "' in ZooKeeper: " + zk->message(code));
   }
 
@@ -457,11 +456,27 @@ void GroupProcess::expired()
   foreachpair (int32_t sequence, Promise<bool>* cancelled, utils::copy(owned)) {
     cancelled->set(false); // Since this was not requested.
     owned.erase(sequence); // Okay since iterating over a copy.
+    contents.erase(sequence);
     delete cancelled;
   }
 
   CHECK(owned.empty());
 
+  // Requests sent during the expired session might never get
+  // answered, so we stop waiting for them. The pending joins and
+  // cancels are still queued and the data requests get queued
+  // again, they will all be sent once we have a new session.
+  syncing = false;
+  caching = false;
+
+  foreachvalue (const list<Data*>& datas, fetching) {
+    foreach (Data* data, datas) {
+      pending.datas.push(data);
+    }
+  }
+
+  fetching.clear();
+
   // Note that we DO NOT clear unowned. The next time we try and cache
   // the memberships we'll trigger any cancelled unowned memberships
   // then. We could imagine doing this for owned memberships too, but
@@ -484,21 +499,7 @@ void GroupProcess::updated(const string& path)
 
   CHECK_EQ(znode, path);
 
-  Try<bool> cached = cache(); // Update cache (will invalidate first).
-
-  if (cached.isError()) {
-    abort(cached.error()); // Cancel everything pending.
-  } else if (!cached.get()) {
-    CHECK(memberships.isNone());
-
-    // Try again later.
-    if (!retrying) {
-      delay(RETRY_INTERVAL, self(), &GroupProcess::retry, RETRY_INTERVAL);
-      retrying = true;
-    }
-  } else {
-    update(); // Update any pending watches.
-  }
+  cache(); // Update cache (will invalidate first).
 }
 
 
@@ -514,16 +515,10 @@ void GroupProcess::deleted(const string& path)
 }
 
 
-Result<Group::Membership> GroupProcess::doJoin(const string& data)
+Result<Group::Membership> GroupProcess::doJoin(
+    const ZooKeeper::Response<string>& response)
 {
-  CHECK_EQ(state, READY);
-
-  // Create a new ephemeral node to represent a new member and use the
-  // the specified data as it's contents.
-  string result;
-
-  int code = zk->create(znode + "/", data, acl,
-                        ZOO_SEQUENCE | ZOO_EPHEMERAL, &result);
+  int code = response.code;
 
   if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
     CHECK_NE(zk->getState(), ZOO_AUTH_FAILED_STATE);
@@ -536,11 +531,11 @@ Result<Group::Membership> GroupProcess::doJoin(const string& data)
 
   // Invalidate the cache (it will/should get immediately populated
   // via the 'updated' callback of our ZooKeeper watcher).
-  memberships = None();
+  invalidate();
 
   // Save the sequence number but only grab the basename. Example:
   // "/path/to/znode/0000000131" => "0000000131".
-  Try<string> basename = os::basename(result);
+  Try<string> basename = os::basename(response.value);
   if (basename.isError()) {
     return Error("Failed to get the sequence number: " + basename.error());
   }
@@ -555,20 +550,11 @@ Result<Group::Membership> GroupProcess::doJoin(const string& data)
 }
 
 
-Result<bool> GroupProcess::doCancel(const Group::Membership& membership)
+Result<bool> GroupProcess::doCancel(
+    const Group::Membership& membership,
+    const ZooKeeper::Response<Nothing>& response)
 {
-  CHECK_EQ(state, READY);
-
-  Try<string> sequence = strings::format("%.*d", 10, membership.sequence);
-
-  CHECK_SOME(sequence);
-
-  string path = znode + "/" + sequence.get();
-
-  LOG(INFO) << "Trying to remove '" << path << "' in ZooKeeper";
-
-  // Remove ephemeral node.
-  int code = zk->remove(path, -1);
+  int code = response.code;
 
   if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
     CHECK_NE(zk->getState(), ZOO_AUTH_FAILED_STATE);
@@ -579,77 +565,200 @@ Result<bool> GroupProcess::doCancel(const Group::Membership& membership)
     return false;
   } else if (code != ZOK) {
     return Error(
-        "Failed to remove ephemeral node '" + path +
+        "Failed to remove ephemeral node '" + path(znode, membership.id()) +
         "' in ZooKeeper: " + zk->message(code));
   }
 
   // Invalidate the cache (it will/should get immediately populated
   // via the 'updated' callback of our ZooKeeper watcher).
-  memberships = None();
+  invalidate();
 
   // Let anyone waiting know the membership has been cancelled.
   CHECK(owned.count(membership.id()) == 1);
   Promise<bool>* cancelled = owned[membership.id()];
   cancelled->set(true);
   owned.erase(membership.id());
+  contents.erase(membership.id());
   delete cancelled;
 
   return true;
 }
 
 
-Result<string> GroupProcess::doData(const Group::Membership& membership)
+Result<string> GroupProcess::doData(
+    int32_t sequence,
+    const ZooKeeper::Response<string>& response)
+{
+  int code = response.code;
+
+  if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
+    CHECK_NE(zk->getState(), ZOO_AUTH_FAILED_STATE);
+    return None();
+  } else if (code != ZOK) {
+    return Error(
+        "Failed to get data for ephemeral node '" + path(znode, sequence) +
+        "' in ZooKeeper: " + zk->message(code));
+  }
+
+  return response.value;
+}
+
+
+void GroupProcess::fetch(Data* data)
+{
+  const int32_t sequence = data->membership.id();
+
+  // The data might have been cached while this request was queued.
+  if (contents.count(sequence) > 0) {
+    data->promise.set(contents[sequence]);
+    delete data;
+    return;
+  }
+
+  fetch(sequence);
+
+  fetching[sequence].push_back(data);
+}
+
+
+void GroupProcess::fetch(int32_t sequence)
 {
   CHECK_EQ(state, READY);
 
-  Try<string> sequence = strings::format("%.*d", 10, membership.sequence);
+  if (fetching.count(sequence) > 0) {
+    return; // Wait for the outstanding request.
+  }
 
-  CHECK_SOME(sequence);
+  fetching[sequence] = list<Data*>();
 
-  string path = znode + "/" + sequence.get();
+  const string path = zookeeper::path(znode, sequence);
 
   LOG(INFO) << "Trying to get '" << path << "' in ZooKeeper";
 
   // Get data associated with ephemeral node.
-  string result;
+  zk->asyncGet(path, false)
+    .onReady(defer(self(),
+                   &Self::_data,
+                   zk->getSessionId(),
+                   sequence,
+                   lambda::_1));
+}
 
-  int code = zk->get(path, false, &result, NULL);
 
-  if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK_NE(zk->getState(), ZOO_AUTH_FAILED_STATE);
-    return None();
-  } else if (code != ZOK) {
-    return Error(
-        "Failed to get data for ephemeral node '" + path +
-        "' in ZooKeeper: " + zk->message(code));
+void GroupProcess::_data(
+    int64_t session,
+    int32_t sequence,
+    const ZooKeeper::Response<string>& response)
+{
+  if (stale(session)) {
+    return; // The waiting data requests got queued again (or failed).
   }
 
-  return result;
+  CHECK(fetching.count(sequence) > 0);
+
+  const list<Data*> datas = fetching[sequence];
+  fetching.erase(sequence);
+
+  // TODO(benh): Ignore if future has been discarded?
+  Result<string> result = doData(sequence, response);
+
+  if (result.isNone()) {
+    // Try again later. Note that the data of a new membership that
+    // nobody asked for yet only gets fetched again once requested.
+    foreach (Data* data, datas) {
+      pending.datas.push(data);
+    }
+
+    if (!datas.empty()) {
+      retryLater(RETRY_INTERVAL);
+    }
+    return;
+  }
+
+  // Only cache the data of memberships that are still part of the
+  // group, i.e., that will get removed from the cache once they're
+  // cancelled.
+  if (result.isSome() &&
+      (owned.count(sequence) > 0 || unowned.count(sequence) > 0)) {
+    contents[sequence] = result.get();
+  }
+
+  foreach (Data* data, datas) {
+    if (result.isError()) {
+      data->promise.fail(result.error());
+    } else {
+      data->promise.set(result.get());
+    }
+    delete data;
+  }
 }
 
 
-Try<bool> GroupProcess::cache()
+void GroupProcess::invalidate()
 {
-  // Invalidate first (if it's not already).
   memberships = None();
 
+  if (caching) {
+    outdated = true;
+  }
+}
+
+
+void GroupProcess::cache()
+{
+  // Invalidate first (if it's not already).
+  invalidate();
+
+  if (caching) {
+    return; // We'll ask again once the outstanding request returns.
+  }
+
+  caching = true;
+  outdated = false;
+
   // Get all children to determine current memberships.
-  vector<string> results;
+  zk->asyncGetChildren(znode, true) // Sets the watch!
+    .onReady(defer(self(), &Self::_cache, zk->getSessionId(), lambda::_1));
+}
 
-  int code = zk->getChildren(znode, true, &results); // Sets the watch!
+
+void GroupProcess::_cache(
+    int64_t session,
+    const ZooKeeper::Response<vector<string> >& response)
+{
+  if (stale(session)) {
+    return;
+  }
+
+  CHECK(caching);
+  caching = false;
+
+  // The memberships might have changed since the request was sent.
+  if (outdated) {
+    cache();
+    return;
+  }
+
+  int code = response.code;
 
   if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
     CHECK_NE(zk->getState(), ZOO_AUTH_FAILED_STATE);
-    return false;
+    CHECK(memberships.isNone());
+
+    // Try again later.
+    retryLater(RETRY_INTERVAL);
+    return;
   } else if (code != ZOK) {
-    return Error("Non-retryable error attempting to get children of '" + znode +
-                 "' in ZooKeeper: " + zk->message(code));
+    // Non-retryable error, cancel everything pending.
+    abort("Non-retryable error attempting to get children of '" + znode +
+          "' in ZooKeeper: " + zk->message(code));
+    return;
   }
 
   // Convert results to sequence numbers.
   set<int32_t> sequences;
 
-  foreach (const string& result, results) {
+  foreach (const string& result, response.value) {
     Try<int32_t> sequence = numify<int32_t>(result);
 
     // Skip it if it couldn't be converted to a number.
@@ -669,6 +778,7 @@ Try<bool> GroupProcess::cache()
     if (sequences.count(sequence) == 0) {
       cancelled->set(false);
       owned.erase(sequence); // Okay since iterating over a copy.
+      contents.erase(sequence);
       delete cancelled;
     } else {
       current.insert(Group::Membership(sequence, cancelled->future()));
@@ -680,6 +790,7 @@ Try<bool> GroupProcess::cache()
     if (sequences.count(sequence) == 0) {
       cancelled->set(false);
       unowned.erase(sequence); // Okay since iterating over a copy.
+      contents.erase(sequence);
       delete cancelled;
     } else {
       current.insert(Group::Membership(sequence, cancelled->future()));
@@ -696,7 +807,17 @@ Try<bool> GroupProcess::cache()
 
   memberships = current;
 
-  return true;
+  // Fetch the data of all of the new memberships at once (rather than
+  // one after another when a client asks for it).
+  if (state == READY) {
+    foreach (int32_t sequence, sequences) {
+      if (contents.count(sequence) == 0) {
+        fetch(sequence);
+      }
+    }
+  }
+
+  update(); // Update any pending watches.
 }
 
 
@@ -719,75 +840,104 @@ void GroupProcess::update()
 }
 
 
-Try<bool> GroupProcess::sync()
+void GroupProcess::sync(const Duration& backoff)
 {
+  CHECK_NE(state, CONNECTING);
+
+  if (syncing) {
+    return; // The outstanding sync will pick up any pending operations.
+  }
+
   LOG(INFO)
     << "Syncing group operations: queue size (joins, cancels, datas) = ("
     << pending.joins.size() << ", " << pending.cancels.size() << ", "
     << pending.datas.size() << ")";
 
-  CHECK_NE(state, CONNECTING);
+  syncing = true;
+
+  _sync()
+    .onAny(defer(self(),
+                 &Self::synced,
+                 zk->getSessionId(),
+                 backoff,
+                 lambda::_1));
+}
+
+
+void GroupProcess::synced(
+    int64_t session,
+    const Duration& backoff,
+    const Future<bool>& done)
+{
+  if (stale(session)) {
+    return; // A new sync gets started once we have a new session.
+  }
+
+  CHECK(syncing);
+  syncing = false;
+
+  if (!done.isReady()) {
+    // Non-retryable error. Abort.
+    abort(done.isFailed() ? done.failure() : "Not expecting discarded future");
+  } else if (!done.get()) {
+    // Retryable error.
+    retryLater(backoff);
+  }
+}
+
+
+Future<bool> GroupProcess::_sync()
+{
+  // We might have lost the connection in the meantime, in which case
+  // we'll sync again once we're reconnected.
+  if (state == CONNECTING) {
+    return false;
+  }
+
+  const int64_t session = zk->getSessionId();
 
-  // Authenticate with ZK if not already created.
+  // Authenticate with ZK if not already authenticated.
   if (state == CONNECTED) {
-    Try<bool> authenticated = authenticate();
-    if (authenticated.isError() || !authenticated.get()) {
-      return authenticated;
-    }
+    return authenticate()
+      .then(defer(self(), &Self::__sync, session, lambda::_1));
   }
 
   // Create group base path if not already created.
   if (state == AUTHENTICATED) {
-    Try<bool> created = create();
-    if (created.isError() || !created.get()) {
-      return created;
-    }
+    return create()
+      .then(defer(self(), &Self::__sync, session, lambda::_1));
   }
 
   // Do joins.
-  while (!pending.joins.empty()) {
-    Join* join = pending.joins.front();
-    Result<Group::Membership> membership = doJoin(join->data);
-    if (membership.isNone()) {
-      return false; // Try again later.
-    } else if (membership.isError()) {
-      join->promise.fail(membership.error());
-    } else {
-      join->promise.set(membership.get());
-    }
-    pending.joins.pop();
-    delete join;
+  if (!pending.joins.empty()) {
+    // Create a new ephemeral node to represent a new member and use
+    // the specified data as it's contents.
+    return zk->asyncCreate(
+        znode + "/",
+        pending.joins.front()->data,
+        acl,
+        ZOO_SEQUENCE | ZOO_EPHEMERAL)
+      .then(defer(self(), &Self::_join, session, lambda::_1));
   }
 
   // Do cancels.
-  while (!pending.cancels.empty()) {
-    Cancel* cancel = pending.cancels.front();
-    Result<bool> cancellation = doCancel(cancel->membership);
-    if (cancellation.isNone()) {
-      return false; // Try again later.
-    } else if (cancellation.isError()) {
-      cancel->promise.fail(cancellation.error());
-    } else {
-      cancel->promise.set(cancellation.get());
-    }
-    pending.cancels.pop();
-    delete cancel;
+  if (!pending.cancels.empty()) {
+    const string path =
+      zookeeper::path(znode, pending.cancels.front()->membership.id());
+
+    LOG(INFO) << "Trying to remove '" << path << "' in ZooKeeper";
+
+    // Remove ephemeral node.
+    return zk->asyncRemove(path, -1)
+      .then(defer(self(), &Self::_cancel, session, lambda::_1));
   }
 
-  // Do datas.
+  // Do datas. These don't depend on each other so they all get sent
+  // at once (and get retried individually).
   while (!pending.datas.empty()) {
     Data* data = pending.datas.front();
-    // TODO(benh): Ignore if future has been discarded?
-    Result<string> result = doData(data->membership);
-    if (result.isNone()) {
-      return false; // Try again later.
-    } else if (result.isError()) {
-      data->promise.fail(result.error());
-    } else {
-      data->promise.set(result.get());
-    }
     pending.datas.pop();
-    delete data;
+    fetch(data);
   }
 
   // Get cache of memberships if we don't have one. Note that we do
@@ -796,20 +946,84 @@ Try<bool> GroupProcess::sync()
   // end. The side-effect here is that users will learn of joins and
   // cancels first through any explicit futures for them rather than
   // watches.
-  if (memberships.isNone()) {
-    Try<bool> cached = cache();
-    if (cached.isError() || !cached.get()) {
-      CHECK(memberships.isNone());
-      return cached;
-    } else {
-      update(); // Update any pending watches.
-    }
+  if (memberships.isNone() && !caching) {
+    cache();
   }
 
   return true;
 }
 
 
+Future<bool> GroupProcess::__sync(int64_t session, bool done)
+{
+  if (stale(session) || !done) {
+    return false;
+  }
+
+  return _sync();
+}
+
+
+Future<bool> GroupProcess::_join(
+    int64_t session,
+    const ZooKeeper::Response<string>& response)
+{
+  if (stale(session)) {
+    return false;
+  }
+
+  CHECK(!pending.joins.empty());
+
+  Join* join = pending.joins.front();
+  Result<Group::Membership> membership = doJoin(response);
+  if (membership.isNone()) {
+    return false; // Try again later.
+  } else if (membership.isError()) {
+    join->promise.fail(membership.error());
+  } else {
+    // We already know the data of our own membership.
+    contents[membership.get().id()] = join->data;
+    join->promise.set(membership.get());
+  }
+  pending.joins.pop();
+  delete join;
+
+  return _sync();
+}
+
+
+Future<bool> GroupProcess::_cancel(
+    int64_t session,
+    const ZooKeeper::Response<Nothing>& response)
+{
+  if (stale(session)) {
+    return false;
+  }
+
+  CHECK(!pending.cancels.empty());
+
+  Cancel* cancel = pending.cancels.front();
+  Result<bool> cancellation = doCancel(cancel->membership, response);
+  if (cancellation.isNone()) {
+    return false; // Try again later.
+  } else if (cancellation.isError()) {
+    cancel->promise.fail(cancellation.error());
+  } else {
+    cancel->promise.set(cancellation.get());
+  }
+  pending.cancels.pop();
+  delete cancel;
+
+  return _sync();
+}
+
+
+bool GroupProcess::stale(int64_t session)
+{
+  return error.isSome() || zk->getSessionId() != session;
+}
+
+
 void GroupProcess::retry(const Duration& duration)
 {
   CHECK(retrying);
@@ -824,17 +1038,27 @@ void GroupProcess::retry(const Duration& duration)
     return;
   }
 
-  Try<bool> synced = sync();
+  // Backoff and keep retrying if the sync fails again.
+  sync(std::min(duration * 2, Duration(Seconds(60))));
+}
+
 
-  if (synced.isError()) {
-    // Non-retryable error. Abort.
-    abort(synced.error());
-  } else if (!synced.get()) {
-    // Backoff and keep retrying.
-    retrying = true;
-    Seconds seconds = std::min(duration * 2, Duration(Seconds(60)));
-    delay(seconds, self(), &GroupProcess::retry, seconds);
+void GroupProcess::retryLater(const Duration& duration)
+{
+  if (retrying) {
+    return; // The scheduled retry will pick up everything pending.
   }
+
+  // Retry after a random fraction (between one half and one) of the
+  // duration so that the groups that failed at the same time (e.g.,
+  // all the contenders and detectors when the ZooKeeper server they
+  // were using went away) don't all retry at once. Note that we
+  // never wait longer than 'duration' (which the tests rely on when
+  // advancing the clock).
+  Duration d = duration * (0.5 + 0.5 * (double) ::random() / RAND_MAX);
+
+  delay(d, self(), &GroupProcess::retry, duration);
+  retrying = true;
 }
 
 
@@ -848,6 +1072,16 @@ void GroupProcess::abort(const string& message)
   fail(&pending.datas, message);
   fail(&pending.watches, message);
 
+  foreachvalue (const list<Data*>& datas, fetching) {
+    foreach (Data* data, datas) {
+      data->promise.fail(message);
+      delete data;
+    }
+  }
+
+  fetching.clear();
+  contents.clear();
+
   // Set all owned memberships as cancelled.
   foreachvalue (Promise<bool>* cancelled, owned) {
     cancelled->set(false); // Since this was not requested.
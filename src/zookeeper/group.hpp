@@ -1,22 +1,23 @@
 #ifndef __ZOOKEEPER_GROUP_HPP__
 #define __ZOOKEEPER_GROUP_HPP__
 
+#include <list>
 #include <map>
 #include <set>
+#include <string>
 
 #include "process/future.hpp"
 #include "process/timer.hpp"
 
 #include <stout/duration.hpp>
 #include <stout/none.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
+#include <stout/result.hpp>
 
 #include "zookeeper/authentication.hpp"
 #include "zookeeper/url.hpp"
-
-// Forward declarations.
-class Watcher;
-class ZooKeeper;
+#include "zookeeper/zookeeper.hpp"
 
 namespace zookeeper {
 
@@ -167,29 +168,87 @@ public:
   void deleted(const std::string& path);
 
 private:
-  Result<Group::Membership> doJoin(const std::string& data);
-  Result<bool> doCancel(const Group::Membership& membership);
-  Result<std::string> doData(const Group::Membership& membership);
-
-  // Returns true if authentication is successful, false if the
-  // failure is retryable and Error otherwise.
-  Try<bool> authenticate();
+  struct Data; // Forward declaration (see below).
+
+  // Interpret the responses to a join, cancel and data request. Each
+  // returns None if the failure is retryable.
+  Result<Group::Membership> doJoin(
+      const ZooKeeper::Response<std::string>& response);
+  Result<bool> doCancel(
+      const Group::Membership& membership,
+      const ZooKeeper::Response<Nothing>& response);
+  Result<std::string> doData(
+      int32_t sequence,
+      const ZooKeeper::Response<std::string>& response);
+
+  // Authenticates with ZooKeeper. Returns true if authentication is
+  // successful, false if the failure is retryable and a failure
+  // otherwise.
+  process::Future<bool> authenticate();
+  process::Future<bool> _authenticate(
+      int64_t session,
+      const ZooKeeper::Response<Nothing>& response);
 
   // Creates the group (which means creating its base path) on ZK.
   // Returns true if successful, false if the failure is retryable
-  // and Error otherwise.
-  Try<bool> create();
-
-  // Attempts to cache the current set of memberships.
-  // Returns true if successful, false if the failure is retryable
-  // and Error otherwise.
-  Try<bool> cache();
-
-  // Synchronizes pending operations with ZooKeeper and also attempts
-  // to cache the current set of memberships if necessary.
-  // Returns true if successful, false if the failure is retryable
-  // and Error otherwise.
-  Try<bool> sync();
+  // and a failure otherwise.
+  process::Future<bool> create();
+  process::Future<bool> _create(
+      int64_t session,
+      const ZooKeeper::Response<std::string>& response);
+
+  // Attempts to cache the current set of memberships, the response
+  // is handled in '_cache' which updates any pending watches (or
+  // retries later, or aborts).
+  void cache();
+  void _cache(
+      int64_t session,
+      const ZooKeeper::Response<std::vector<std::string> >& response);
+
+  // Invalidates the cache of memberships, including the memberships
+  // of an outstanding request (which might not reflect the change
+  // that caused the invalidation).
+  void invalidate();
+
+  // Gets the data of a membership from the cache or waits for it to
+  // be fetched.
+  void fetch(Data* data);
+
+  // Sends the request for the data of a membership unless there is
+  // one outstanding already, the response is handled in '_data'.
+  void fetch(int32_t sequence);
+  void _data(
+      int64_t session,
+      int32_t sequence,
+      const ZooKeeper::Response<std::string>& response);
+
+  // Synchronizes pending operations with ZooKeeper (unless already
+  // doing so) and also attempts to cache the current set of
+  // memberships if necessary. A retryable failure gets retried after
+  // 'backoff' while a non-retryable failure aborts the group.
+  void sync(const Duration& backoff);
+  void synced(
+      int64_t session,
+      const Duration& backoff,
+      const process::Future<bool>& done);
+
+  // The steps of a sync. Each returns true once there is nothing
+  // left to do, false if the failure is retryable and a failure
+  // otherwise.
+  process::Future<bool> _sync();
+  process::Future<bool> __sync(int64_t session, bool done);
+  process::Future<bool> _join(
+      int64_t session,
+      const ZooKeeper::Response<std::string>& response);
+  process::Future<bool> _cancel(
+      int64_t session,
+      const ZooKeeper::Response<Nothing>& response);
+
+  // Returns true if a response belongs to a previous session (or the
+  // group got aborted since the request was sent), in which case the
+  // response must be ignored. Note that the ZooKeeper client might
+  // never answer the requests of a closed session.
+  bool stale(int64_t session);
 
   // Updates any pending watches.
   void update();
@@ -200,6 +259,10 @@ private:
   // memberships if necessary).
   void retry(const Duration& duration);
 
+  // Schedules a retry (unless one is already scheduled) after a
+  // randomized delay of at most the specified duration.
+  void retryLater(const Duration& duration);
+
   void timedout(int64_t sessionId);
 
   // Aborts the group instance and fails all pending operations.
@@ -273,6 +336,24 @@ private:
   // Indicates there is a pending delayed retry.
   bool retrying;
 
+  // Indicates there is an outstanding sync.
+  bool syncing;
+
+  // Indicates there is an outstanding request for the memberships
+  // and whether the memberships got invalidated since it was sent.
+  bool caching;
+  bool outdated;
+
+  // The data of memberships keyed by sequence number. Since the data
+  // of a membership never changes it gets cached for as long as the
+  // membership is part of the group.
+  std::map<int32_t, std::string> contents;
+
+  // The sequence numbers of memberships whose data has been requested
+  // from ZooKeeper but not yet been answered, along with the data
+  // requests that are waiting for it.
+  std::map<int32_t, std::list<Data*> > fetching;
+
   // Expected ZooKeeper sequence numbers (either owned/created by this
   // group instance or not) and the promise we associate with their
   // "cancellation" (i.e., no longer part of the group).
@@ -20,29 +20,31 @@
 
 #include <iostream>
 #include <map>
+#include <set>
 
-#include <boost/tuple/tuple.hpp>
-
+#include <process/defer.hpp>
 #include <process/dispatch.hpp>
+#include <process/id.hpp>
 #include <process/once.hpp>
 #include <process/process.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/fatal.hpp>
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
+#include <stout/nothing.hpp>
 #include <stout/path.hpp>
 #include <stout/strings.hpp>
 
 #include "zookeeper/zookeeper.hpp"
 
-using boost::tuple;
-
 using process::Future;
 using process::PID;
 using process::Process;
 using process::Promise;
 
 using std::map;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -157,6 +159,122 @@ Watcher::~Watcher()
 }
 
 
+// Performs the recursive creates of a ZooKeeper instance. Its
+// continuations run on this process rather than on the ZooKeeper
+// completion thread, and the process gets terminated before the
+// ZooKeeper connection gets closed, so they never use a ZooKeeper
+// instance that is being (or has been) deleted. The creates that are
+// still outstanding at that point are answered with ZCLOSING.
+class CreateProcess : public Process<CreateProcess>
+{
+public:
+  explicit CreateProcess(ZooKeeper* _zk)
+    : ProcessBase(process::ID::generate("zookeeper-create")),
+      zk(_zk) {}
+
+  virtual ~CreateProcess() {}
+
+  Future<ZooKeeper::Response<string> > create(
+      const string& path,
+      const string& data,
+      const ACL_vector& acl,
+      int flags)
+  {
+    Promise<ZooKeeper::Response<string> >* promise =
+      new Promise<ZooKeeper::Response<string> >();
+
+    promises.insert(promise);
+
+    // First check if the path exists.
+    zk->asyncExists(path, false)
+      .then(defer(self(), &Self::_create, path, data, acl, flags, lambda::_1))
+      .onAny(defer(self(), &Self::created, promise, lambda::_1));
+
+    return promise->future();
+  }
+
+protected:
+  virtual void finalize()
+  {
+    foreach (Promise<ZooKeeper::Response<string> >* promise, promises) {
+      promise->set(ZooKeeper::Response<string>(ZCLOSING));
+      delete promise;
+    }
+
+    promises.clear();
+  }
+
+private:
+  Future<ZooKeeper::Response<string> > _create(
+      const string& path,
+      const string& data,
+      const ACL_vector& acl,
+      int flags,
+      const ZooKeeper::Response<Nothing>& exists)
+  {
+    if (exists.code == ZOK) {
+      return ZooKeeper::Response<string>(ZNODEEXISTS);
+    } else if (exists.code != ZNONODE) {
+      return ZooKeeper::Response<string>(exists.code);
+    }
+
+    // Now recursively create the parent path.
+    // NOTE: We don't use 'dirname()' to get the parent path here
+    // because, it doesn't return the expected path when a path ends
+    // with "/". For example, to create path "/a/b/", we want to
+    // recursively create "/a/b", instead of just creating "/a".
+    const string parent = path.substr(0, path.find_last_of("/"));
+
+    if (parent.empty()) {
+      return zk->asyncCreate(path, data, acl, flags);
+    }
+
+    return create(parent, "", acl, 0)
+      .then(defer(self(), &Self::__create, path, data, acl, flags, lambda::_1));
+  }
+
+  Future<ZooKeeper::Response<string> > __create(
+      const string& path,
+      const string& data,
+      const ACL_vector& acl,
+      int flags,
+      const ZooKeeper::Response<string>& parent)
+  {
+    if (parent.code != ZOK && parent.code != ZNODEEXISTS) {
+      return ZooKeeper::Response<string>(parent.code);
+    }
+
+    // TODO(vinod): Delete any intermediate nodes created if this
+    // fails. This requires synchronization because the deletion might
+    // affect other callers (different threads/processes) acting on
+    // this path.
+    return zk->asyncCreate(path, data, acl, flags);
+  }
+
+  void created(
+      Promise<ZooKeeper::Response<string> >* promise,
+      const Future<ZooKeeper::Response<string> >& future)
+  {
+    CHECK(promises.count(promise) > 0);
+
+    if (future.isReady()) {
+      promise->set(future.get());
+    } else {
+      promise->fail(
+          future.isFailed() ? future.failure() : "Discarded future");
+    }
+
+    promises.erase(promise);
+    delete promise;
+  }
+
+  ZooKeeper* zk;
+
+  // The outstanding creates.
+  set<Promise<ZooKeeper::Response<string> >*> promises;
+};
+
+
 class ZooKeeperImpl
 {
 public:
@@ -194,10 +312,20 @@ public:
     if (zh == NULL) {
       PLOG(FATAL) << "Failed to create ZooKeeper, zookeeper_init";
     }
+
+    process = new CreateProcess(zk);
+    process::spawn(process);
   }
 
   ~ZooKeeperImpl()
   {
+    // Stop the recursive creates before closing the connection (see
+    // CreateProcess). Note that we don't inject the termination so
+    // that the creates that have already been dispatched get answered.
+    process::terminate(process, false);
+    process::wait(process);
+    delete process;
+
     int ret = zookeeper_close(zh);
     if (ret != ZOK) {
       LOG(FATAL) << "Failed to cleanup ZooKeeper, zookeeper_close: "
@@ -205,152 +333,199 @@ public:
     }
   }
 
-  Future<int> authenticate(const string& scheme, const string& credentials)
+  Future<ZooKeeper::Response<Nothing> > authenticate(
+      const string& scheme,
+      const string& credentials)
   {
-    Promise<int>* promise = new Promise<int>();
+    Promise<ZooKeeper::Response<Nothing> >* promise =
+      new Promise<ZooKeeper::Response<Nothing> >();
 
-    Future<int> future = promise->future();
-
-    tuple<Promise<int>*>* args = new tuple<Promise<int>*>(promise);
+    Future<ZooKeeper::Response<Nothing> > future = promise->future();
 
     int ret = zoo_add_auth(zh, scheme.c_str(), credentials.data(),
-                           credentials.size(), voidCompletion, args);
+                           credentials.size(), voidCompletion, promise);
 
     if (ret != ZOK) {
       delete promise;
-      delete args;
-      return ret;
+      return ZooKeeper::Response<Nothing>(ret);
     }
 
     return future;
   }
 
-  Future<int> create(const string& path, const string& data,
-                     const ACL_vector& acl, int flags, string* result)
+  Future<ZooKeeper::Response<string> > create(
+      const string& path,
+      const string& data,
+      const ACL_vector& acl,
+      int flags)
   {
-    Promise<int>* promise = new Promise<int>();
-
-    Future<int> future = promise->future();
+    Promise<ZooKeeper::Response<string> >* promise =
+      new Promise<ZooKeeper::Response<string> >();
 
-    tuple<Promise<int>*, string*>* args =
-      new tuple<Promise<int>*, string*>(promise, result);
+    Future<ZooKeeper::Response<string> > future = promise->future();
 
     int ret = zoo_acreate(zh, path.c_str(), data.data(), data.size(), &acl,
-                          flags, stringCompletion, args);
+                          flags, stringCompletion, promise);
 
     if (ret != ZOK) {
       delete promise;
-      delete args;
-      return ret;
+      return ZooKeeper::Response<string>(ret);
     }
 
     return future;
   }
 
-  Future<int> remove(const string& path, int version)
+  Future<ZooKeeper::Response<Nothing> > remove(const string& path, int version)
   {
-    Promise<int>* promise = new Promise<int>();
-
-    Future<int> future = promise->future();
+    Promise<ZooKeeper::Response<Nothing> >* promise =
+      new Promise<ZooKeeper::Response<Nothing> >();
 
-    tuple<Promise<int>*>* args = new tuple<Promise<int>*>(promise);
+    Future<ZooKeeper::Response<Nothing> > future = promise->future();
 
-    int ret = zoo_adelete(zh, path.c_str(), version, voidCompletion, args);
+    int ret = zoo_adelete(zh, path.c_str(), version, voidCompletion, promise);
 
     if (ret != ZOK) {
       delete promise;
-      delete args;
-      return ret;
+      return ZooKeeper::Response<Nothing>(ret);
     }
 
     return future;
   }
 
-  Future<int> exists(const string& path, bool watch, Stat* stat)
+  Future<ZooKeeper::Response<Nothing> > exists(const string& path, bool watch)
   {
-    Promise<int>* promise = new Promise<int>();
+    Promise<ZooKeeper::Response<Nothing> >* promise =
+      new Promise<ZooKeeper::Response<Nothing> >();
 
-    Future<int> future = promise->future();
+    Future<ZooKeeper::Response<Nothing> > future = promise->future();
 
-    tuple<Promise<int>*, Stat*>* args =
-      new tuple<Promise<int>*, Stat*>(promise, stat);
-
-    int ret = zoo_aexists(zh, path.c_str(), watch, statCompletion, args);
+    int ret = zoo_aexists(zh, path.c_str(), watch, statCompletion, promise);
 
     if (ret != ZOK) {
       delete promise;
-      delete args;
-      return ret;
+      return ZooKeeper::Response<Nothing>(ret);
     }
 
     return future;
   }
 
-  Future<int> get(const string& path, bool watch, string* result, Stat* stat)
+  Future<ZooKeeper::Response<string> > get(const string& path, bool watch)
   {
-    Promise<int>* promise = new Promise<int>();
-
-    Future<int> future = promise->future();
+    Promise<ZooKeeper::Response<string> >* promise =
+      new Promise<ZooKeeper::Response<string> >();
 
-    tuple<Promise<int>*, string*, Stat*>* args =
-      new tuple<Promise<int>*, string*, Stat*>(promise, result, stat);
+    Future<ZooKeeper::Response<string> > future = promise->future();
 
-    int ret = zoo_aget(zh, path.c_str(), watch, dataCompletion, args);
+    int ret = zoo_aget(zh, path.c_str(), watch, dataCompletion, promise);
 
     if (ret != ZOK) {
       delete promise;
-      delete args;
-      return ret;
+      return ZooKeeper::Response<string>(ret);
     }
 
     return future;
   }
 
-  Future<int> getChildren(const string& path,
-                          bool watch,
-                          vector<string>* results)
+  Future<ZooKeeper::Response<vector<string> > > getChildren(
+      const string& path,
+      bool watch)
   {
-    Promise<int>* promise = new Promise<int>();
-
-    Future<int> future = promise->future();
+    Promise<ZooKeeper::Response<vector<string> > >* promise =
+      new Promise<ZooKeeper::Response<vector<string> > >();
 
-    tuple<Promise<int>*, vector<string>*>* args =
-      new tuple<Promise<int>*, vector<string>*>(promise, results);
+    Future<ZooKeeper::Response<vector<string> > > future = promise->future();
 
     int ret = zoo_aget_children(zh, path.c_str(), watch, stringsCompletion,
-                                args);
+                                promise);
 
     if (ret != ZOK) {
       delete promise;
-      delete args;
-      return ret;
+      return ZooKeeper::Response<vector<string> >(ret);
     }
 
     return future;
   }
 
-  Future<int> set(const string& path, const string& data, int version)
+  Future<ZooKeeper::Response<Nothing> > set(
+      const string& path,
+      const string& data,
+      int version)
   {
-    Promise<int>* promise = new Promise<int>();
+    Promise<ZooKeeper::Response<Nothing> >* promise =
+      new Promise<ZooKeeper::Response<Nothing> >();
 
-    Future<int> future = promise->future();
-
-    tuple<Promise<int>*, Stat*>* args =
-      new tuple<Promise<int>*, Stat*>(promise, NULL);
+    Future<ZooKeeper::Response<Nothing> > future = promise->future();
 
     int ret = zoo_aset(zh, path.c_str(), data.data(), data.size(),
-                       version, statCompletion, args);
+                       version, statCompletion, promise);
 
     if (ret != ZOK) {
       delete promise;
-      delete args;
-      return ret;
+      return ZooKeeper::Response<Nothing>(ret);
+    }
+
+    return future;
+  }
+
+  Future<ZooKeeper::Response<Nothing> > multi(
+      const vector<ZooKeeper::Op>& ops)
+  {
+    if (ops.empty()) {
+      return ZooKeeper::Response<Nothing>(ZOK);
+    }
+
+    // The operations get serialized right away, but the results get
+    // written on completion.
+    vector<zoo_op_t> _ops(ops.size());
+
+    for (size_t i = 0; i < ops.size(); i++) {
+      const ZooKeeper::Op& op = ops[i];
+
+      switch (op.type) {
+        case ZOO_CREATE_OP:
+          zoo_create_op_init(&_ops[i], op.path.c_str(), op.data.data(),
+                             op.data.size(), &op.acl, op.flags, NULL, 0);
+          break;
+        case ZOO_DELETE_OP:
+          zoo_delete_op_init(&_ops[i], op.path.c_str(), op.version);
+          break;
+        case ZOO_SETDATA_OP:
+          zoo_set_op_init(&_ops[i], op.path.c_str(), op.data.data(),
+                          op.data.size(), op.version, NULL);
+          break;
+        case ZOO_CHECK_OP:
+          zoo_check_op_init(&_ops[i], op.path.c_str(), op.version);
+          break;
+        default:
+          LOG(FATAL) << "Unknown ZooKeeper operation type " << op.type;
+      }
+    }
+
+    Multi* multi = new Multi(ops.size());
+
+    Future<ZooKeeper::Response<Nothing> > future = multi->promise.future();
+
+    int ret = zoo_amulti(zh, _ops.size(), &_ops[0], &multi->results[0],
+                         multiCompletion, multi);
+
+    if (ret != ZOK) {
+      delete multi;
+      return ZooKeeper::Response<Nothing>(ret);
     }
 
     return future;
   }
 
 private:
+  // The promise and the results of the operations of a multi.
+  struct Multi
+  {
+    explicit Multi(size_t size) : results(size) {}
+
+    Promise<ZooKeeper::Response<Nothing> > promise;
+    vector<zoo_op_result_t> results;
+  };
+
   static void event(
       zhandle_t* zh,
       int type,
@@ -369,59 +544,55 @@ private:
   }
 
 
-  static void voidCompletion(int ret, const void *data)
-  {
-    const tuple<Promise<int>*>* args =
-      reinterpret_cast<const tuple<Promise<int>*>*>(data);
+  // The completions below get invoked (on the ZooKeeper completion
+  // thread) with the promise that was passed as 'data' when the
+  // request was sent and take ownership of it.
 
-    Promise<int>* promise = (*args).get<0>();
+  static void voidCompletion(int ret, const void* data)
+  {
+    Promise<ZooKeeper::Response<Nothing> >* promise =
+      static_cast<Promise<ZooKeeper::Response<Nothing> >*>(
+          const_cast<void*>(data));
 
-    promise->set(ret);
+    promise->set(ZooKeeper::Response<Nothing>(ret));
 
     delete promise;
-    delete args;
   }
 
 
   static void stringCompletion(int ret, const char* value, const void* data)
   {
-    const tuple<Promise<int>*, string*> *args =
-      reinterpret_cast<const tuple<Promise<int>*, string*>*>(data);
+    Promise<ZooKeeper::Response<string> >* promise =
+      static_cast<Promise<ZooKeeper::Response<string> >*>(
+          const_cast<void*>(data));
 
-    Promise<int>* promise = (*args).get<0>();
-    string* result = (*args).get<1>();
+    ZooKeeper::Response<string> response(ret);
 
     if (ret == 0) {
-      if (result != NULL) {
-        result->assign(value);
-      }
+      response.value.assign(value);
     }
 
-    promise->set(ret);
+    promise->set(response);
 
     delete promise;
-    delete args;
   }
 
 
   static void statCompletion(int ret, const Stat* stat, const void* data)
   {
-    const tuple<Promise<int>*, Stat*>* args =
-      reinterpret_cast<const tuple<Promise<int>*, Stat*>*>(data);
+    Promise<ZooKeeper::Response<Nothing> >* promise =
+      static_cast<Promise<ZooKeeper::Response<Nothing> >*>(
+          const_cast<void*>(data));
 
-    Promise<int>* promise = (*args).get<0>();
-    Stat *stat_result = (*args).get<1>();
+    ZooKeeper::Response<Nothing> response(ret);
 
     if (ret == 0) {
-      if (stat_result != NULL) {
-        *stat_result = *stat;
-      }
+      response.stat = *stat;
     }
 
-    promise->set(ret);
+    promise->set(response);
 
     delete promise;
-    delete args;
   }
 
 
@@ -432,27 +603,30 @@ private:
       const Stat* stat,
       const void* data)
   {
-    const tuple<Promise<int>*, string*, Stat*>* args =
-      reinterpret_cast<const tuple<Promise<int>*, string*, Stat*>*>(data);
+    Promise<ZooKeeper::Response<string> >* promise =
+      static_cast<Promise<ZooKeeper::Response<string> >*>(
+          const_cast<void*>(data));
 
-    Promise<int>* promise = (*args).get<0>();
-    string* result = (*args).get<1>();
-    Stat* stat_result = (*args).get<2>();
+    ZooKeeper::Response<string> response(ret);
 
     if (ret == 0) {
-      if (result != NULL) {
-        result->assign(value, value_len);
-      }
-
-      if (stat_result != NULL) {
-        *stat_result = *stat;
-      }
+      response.value.assign(value, value_len);
+      response.stat = *stat;
     }
 
-    promise->set(ret);
+    promise->set(response);
 
     delete promise;
-    delete args;
+  }
+
+
+  static void multiCompletion(int ret, const void* data)
+  {
+    Multi* multi = static_cast<Multi*>(const_cast<void*>(data));
+
+    multi->promise.set(ZooKeeper::Response<Nothing>(ret));
+
+    delete multi;
   }
 
 
@@ -461,24 +635,21 @@ private:
       const String_vector* values,
       const void* data)
   {
-    const tuple<Promise<int>*, vector<string>*>* args =
-      reinterpret_cast<const tuple<Promise<int>*, vector<string>*>*>(data);
+    Promise<ZooKeeper::Response<vector<string> > >* promise =
+      static_cast<Promise<ZooKeeper::Response<vector<string> > >*>(
+          const_cast<void*>(data));
 
-    Promise<int>* promise = (*args).get<0>();
-    vector<string>* results = (*args).get<1>();
+    ZooKeeper::Response<vector<string> > response(ret);
 
     if (ret == 0) {
-      if (results != NULL) {
-        for (int i = 0; i < values->count; i++) {
-          results->push_back(values->data[i]);
-        }
+      for (int i = 0; i < values->count; i++) {
+        response.value.push_back(values->data[i]);
       }
     }
 
-    promise->set(ret);
+    promise->set(response);
 
     delete promise;
-    delete args;
   }
 
 private:
@@ -491,6 +662,8 @@ private:
 
   Watcher* watcher; // Associated Watcher instance.
   PID<WatcherProcess> pid; // PID of WatcherProcess that invokes Watcher.
+
+  CreateProcess* process; // Performs the recursive creates.
 };
 
 
@@ -532,7 +705,7 @@ Duration ZooKeeper::getSessionTimeout() const
 
 int ZooKeeper::authenticate(const string& scheme, const string& credentials)
 {
-  return impl->authenticate(scheme, credentials).get();
+  return asyncAuthenticate(scheme, credentials).get().code;
 }
 
 
@@ -544,65 +717,205 @@ int ZooKeeper::create(
     string* result,
     bool recursive)
 {
-  if (!recursive) {
-    return impl->create(path, data, acl, flags, result).get();
-  }
-
-  // First check if the path exists.
-  int code = impl->exists(path, false, NULL).get();
-  if (code == ZOK) {
-    return ZNODEEXISTS;
-  }
+  const Response<string> response =
+    asyncCreate(path, data, acl, flags, recursive).get();
 
-  // Now recursively create the parent path.
-  // NOTE: We don't use 'dirname()' to get the parent path here
-  // because, it doesn't return the expected path when a path ends
-  // with "/". For example, to create path "/a/b/", we want to
-  // recursively create "/a/b", instead of just creating "/a".
-  const string& parent = path.substr(0, path.find_last_of("/"));
-  if (!parent.empty()) {
-    code = create(parent, "", acl, 0, result, true);
-    if (code != ZOK && code != ZNODEEXISTS) {
-      return code;
-    }
+  if (response.code == ZOK && result != NULL) {
+    *result = response.value;
   }
 
-  // Finally create the path.
-  // TODO(vinod): Delete any intermediate nodes created if this fails.
-  // This requires synchronization because the deletion might affect
-  // other callers (different threads/processes) acting on this path.
-  return impl->create(path, data, acl, flags, result).get();
+  return response.code;
 }
 
 
 int ZooKeeper::remove(const string& path, int version)
 {
-  return impl->remove(path, version).get();
+  return asyncRemove(path, version).get().code;
 }
 
 
 int ZooKeeper::exists(const string& path, bool watch, Stat* stat)
 {
-  return impl->exists(path, watch, stat).get();
+  const Response<Nothing> response = asyncExists(path, watch).get();
+
+  if (response.code == ZOK && stat != NULL) {
+    *stat = response.stat;
+  }
+
+  return response.code;
 }
 
 
 int ZooKeeper::get(const string& path, bool watch, string* result, Stat* stat)
 {
-  return impl->get(path, watch, result, stat).get();
+  const Response<string> response = asyncGet(path, watch).get();
+
+  if (response.code == ZOK) {
+    if (result != NULL) {
+      *result = response.value;
+    }
+
+    if (stat != NULL) {
+      *stat = response.stat;
+    }
+  }
+
+  return response.code;
 }
 
 
 int ZooKeeper::getChildren(const string& path, bool watch,
                            vector<string>* results)
 {
-  return impl->getChildren(path, watch, results).get();
+  const Response<vector<string> > response =
+    asyncGetChildren(path, watch).get();
+
+  if (response.code == ZOK && results != NULL) {
+    results->insert(
+        results->end(), response.value.begin(), response.value.end());
+  }
+
+  return response.code;
 }
 
 
 int ZooKeeper::set(const string& path, const string& data, int version)
 {
-  return impl->set(path, data, version).get();
+  return asyncSet(path, data, version).get().code;
+}
+
+
+Future<ZooKeeper::Response<Nothing> > ZooKeeper::asyncAuthenticate(
+    const string& scheme,
+    const string& credentials)
+{
+  return impl->authenticate(scheme, credentials);
+}
+
+
+Future<ZooKeeper::Response<string> > ZooKeeper::asyncCreate(
+    const string& path,
+    const string& data,
+    const ACL_vector& acl,
+    int flags,
+    bool recursive)
+{
+  if (!recursive) {
+    return impl->create(path, data, acl, flags);
+  }
+
+  return process::dispatch(
+      impl->process,
+      &CreateProcess::create,
+      path,
+      data,
+      acl,
+      flags);
+}
+
+
+Future<ZooKeeper::Response<Nothing> > ZooKeeper::asyncRemove(
+    const string& path,
+    int version)
+{
+  return impl->remove(path, version);
+}
+
+
+Future<ZooKeeper::Response<Nothing> > ZooKeeper::asyncExists(
+    const string& path,
+    bool watch)
+{
+  return impl->exists(path, watch);
+}
+
+
+Future<ZooKeeper::Response<string> > ZooKeeper::asyncGet(
+    const string& path,
+    bool watch)
+{
+  return impl->get(path, watch);
+}
+
+
+Future<ZooKeeper::Response<vector<string> > > ZooKeeper::asyncGetChildren(
+    const string& path,
+    bool watch)
+{
+  return impl->getChildren(path, watch);
+}
+
+
+Future<ZooKeeper::Response<Nothing> > ZooKeeper::asyncSet(
+    const string& path,
+    const string& data,
+    int version)
+{
+  return impl->set(path, data, version);
+}
+
+
+Future<ZooKeeper::Response<Nothing> > ZooKeeper::asyncMulti(
+    const vector<Op>& ops)
+{
+  return impl->multi(ops);
+}
+
+
+ZooKeeper::Op ZooKeeper::Op::create(
+    const string& path,
+    const string& data,
+    const ACL_vector& acl,
+    int flags)
+{
+  Op op;
+  op.type = ZOO_CREATE_OP;
+  op.path = path;
+  op.data = data;
+  op.acl = acl;
+  op.flags = flags;
+  op.version = -1;
+  return op;
+}
+
+
+ZooKeeper::Op ZooKeeper::Op::remove(const string& path, int version)
+{
+  Op op;
+  op.type = ZOO_DELETE_OP;
+  op.path = path;
+  op.acl = ZOO_OPEN_ACL_UNSAFE;
+  op.flags = 0;
+  op.version = version;
+  return op;
+}
+
+
+ZooKeeper::Op ZooKeeper::Op::set(
+    const string& path,
+    const string& data,
+    int version)
+{
+  Op op;
+  op.type = ZOO_SETDATA_OP;
+  op.path = path;
+  op.data = data;
+  op.acl = ZOO_OPEN_ACL_UNSAFE;
+  op.flags = 0;
+  op.version = version;
+  return op;
+}
+
+
+ZooKeeper::Op ZooKeeper::Op::check(const string& path, int version)
+{
+  Op op;
+  op.type = ZOO_CHECK_OP;
+  op.path = path;
+  op.acl = ZOO_OPEN_ACL_UNSAFE;
+  op.flags = 0;
+  op.version = version;
+  return op;
 }
 
 
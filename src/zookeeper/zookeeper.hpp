@@ -31,7 +31,10 @@
 #include <string>
 #include <vector>
 
+#include <process/future.hpp>
+
 #include <stout/duration.hpp>
+#include <stout/nothing.hpp>
 
 
 /* Forward declarations of classes we are using. */
@@ -298,6 +301,105 @@ public:
    */
   int set(const std::string &path, const std::string &data, int version);
 
+  /**
+   * \brief the outcome of an asynchronous operation.
+   *
+   * The code is one of the return codes of the corresponding
+   * synchronous operation above. The value (e.g., the path of a
+   * created node or the data of a node) and the stat (for 'exists',
+   * 'get' and 'set') are only valid if the code is ZOK.
+   */
+  template <typename T>
+  struct Response
+  {
+    explicit Response(int _code = ZOK) : code(_code), value(), stat() {}
+
+    int code;
+    T value;
+    Stat stat;
+  };
+
+  /**
+   * \brief asynchronous versions of the operations above.
+   *
+   * Rather than blocking the calling thread for a round trip to
+   * ZooKeeper these return a future that gets satisfied with the
+   * response once ZooKeeper has answered (or the request could not
+   * be sent). The futures are never failed nor discarded. Note that
+   * the callbacks of these futures get invoked on the ZooKeeper
+   * completion thread, so a libprocess process should 'defer' its
+   * continuations rather than doing any work in that thread.
+   */
+  process::Future<Response<Nothing> > asyncAuthenticate(
+      const std::string& scheme,
+      const std::string& credentials);
+
+  process::Future<Response<std::string> > asyncCreate(
+      const std::string& path,
+      const std::string& data,
+      const ACL_vector& acl,
+      int flags,
+      bool recursive = false);
+
+  process::Future<Response<Nothing> > asyncRemove(
+      const std::string& path,
+      int version);
+
+  process::Future<Response<Nothing> > asyncExists(
+      const std::string& path,
+      bool watch);
+
+  process::Future<Response<std::string> > asyncGet(
+      const std::string& path,
+      bool watch);
+
+  process::Future<Response<std::vector<std::string> > > asyncGetChildren(
+      const std::string& path,
+      bool watch);
+
+  process::Future<Response<Nothing> > asyncSet(
+      const std::string& path,
+      const std::string& data,
+      int version);
+
+  /**
+   * \brief an operation that is part of a multi (see 'asyncMulti').
+   */
+  struct Op
+  {
+    static Op create(
+        const std::string& path,
+        const std::string& data,
+        const ACL_vector& acl,
+        int flags);
+
+    static Op remove(const std::string& path, int version);
+
+    static Op set(
+        const std::string& path,
+        const std::string& data,
+        int version);
+
+    static Op check(const std::string& path, int version);
+
+    int type; // One of ZOO_CREATE_OP, ZOO_DELETE_OP, etc.
+    std::string path;
+    std::string data;
+    ACL_vector acl;
+    int flags;
+    int version;
+  };
+
+  /**
+   * \brief atomically perform all of the operations, i.e., either
+   * all of them succeed or none of them is applied.
+   *
+   * The code of the response is that of the first operation that
+   * failed (e.g., ZBADVERSION), or ZOK. Note that the whole request
+   * is subject to the (1 MB) size limit of a single request.
+   */
+  process::Future<Response<Nothing> > asyncMulti(const std::vector<Op>& ops);
+
   /**
    * \brief return a message describing the return code.
    *